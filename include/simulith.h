@@ -14,8 +14,14 @@
 
 // Include hardware interface headers
 #include "simulith_can.h"
+#include "simulith_crc.h"
+#include "simulith_flash.h"
 #include "simulith_gpio.h"
 #include "simulith_i2c.h"
+#include "simulith_pty.h"
+#include "simulith_regmap.h"
+#include "simulith_sensor.h"
+#include "simulith_socketcan.h"
 #include "simulith_spi.h"
 #include "simulith_uart.h"
 
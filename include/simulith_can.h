@@ -1,6 +1,7 @@
 #ifndef SIMULITH_CAN_H
 #define SIMULITH_CAN_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -21,6 +22,18 @@ extern "C"
         uint8_t  data[8];     /**< Message data */
     } simulith_can_message_t;
 
+    /**
+     * @brief CAN FD message structure
+     */
+    typedef struct
+    {
+        uint32_t id;          /**< Message ID (11-bit standard or 29-bit extended) */
+        uint8_t  is_extended; /**< 0 for standard ID, 1 for extended ID */
+        uint8_t  flags;       /**< SIMULITH_CAN_FLAG_* bits (BRS, ESI on send; FDF also set on receive) */
+        uint8_t  len;         /**< Payload length (0-8, 12, 16, 20, 24, 32, 48 or 64 bytes) */
+        uint8_t  data[64];    /**< Message data */
+    } simulith_can_fd_message_t;
+
     /**
      * @brief CAN filter structure
      */
@@ -39,8 +52,23 @@ extern "C"
         uint32_t bitrate;      /**< Bitrate in bits/second */
         uint8_t  sample_point; /**< Sample point in percent (0-100) */
         uint8_t  sync_jump;    /**< Synchronization Jump Width (1-4) */
+        uint32_t data_bitrate; /**< CAN FD data phase bitrate in bits/second (0 for classic CAN only) */
     } simulith_can_config_t;
 
+    /**
+     * @brief Bus load statistics, see simulith_can_set_timing
+     */
+    typedef struct
+    {
+        uint64_t time_ns;          /**< Bus time since timing was enabled */
+        uint64_t busy_ns;          /**< Time spent transmitting frames */
+        uint64_t frames;           /**< Number of frames transmitted */
+        uint64_t max_latency_ns;   /**< Longest time from send to end of transmission */
+        uint32_t pending;          /**< Frames waiting for or holding the bus */
+        double   utilization;      /**< busy_ns / time_ns */
+        double   last_utilization; /**< Utilization over the last simulith_can_advance interval */
+    } simulith_can_bus_stats_t;
+
     /**
      * @brief Callback function type for CAN receive operations
      * @param bus_id Bus identifier
@@ -49,15 +77,68 @@ extern "C"
      */
     typedef int (*simulith_can_rx_callback)(uint8_t bus_id, const simulith_can_message_t *msg);
 
+    /**
+     * @brief Callback function type for frames matching a filter
+     * @param bus_id Bus identifier
+     * @param msg Pointer to received message (classic frames have SIMULITH_CAN_FLAG_FDF clear)
+     * @param ctx Context pointer given to simulith_can_add_filter_callback
+     * @return 0 on success, -1 on failure
+     */
+    typedef int (*simulith_can_filter_callback)(uint8_t bus_id, const simulith_can_fd_message_t *msg, void *ctx);
+
+    /**
+     * @brief How received frames reach their callbacks
+     */
+    typedef enum
+    {
+        SIMULITH_CAN_DISPATCH_POLL,      /**< Queue all frames for simulith_can_receive (default) */
+        SIMULITH_CAN_DISPATCH_IMMEDIATE, /**< Call the callback from within the send that delivered the frame */
+        SIMULITH_CAN_DISPATCH_DEFERRED   /**< Queue frames until simulith_can_dispatch is called */
+    } simulith_can_dispatch_mode_t;
+
     /**
      * @brief Initialize a CAN bus
      * @param bus_id Bus identifier (0-7)
      * @param config CAN configuration structure
-     * @param rx_cb Callback function for receive operations (NULL if not used)
+     * @param rx_cb Callback function for receive operations (NULL if not used), see simulith_can_set_dispatch_mode
      * @return 0 on success, -1 on failure
      */
     int simulith_can_init(uint8_t bus_id, const simulith_can_config_t *config, simulith_can_rx_callback rx_cb);
 
+    /**
+     * @brief Attach an additional node to a CAN bus
+     *
+     * Each node has its own filters, dispatch mode and receive queue. A frame sent on the bus is
+     * stored once and delivered by reference to every node that accepts it. A node accepts all
+     * frames if it has a callback, otherwise only frames matching one of its filters.
+     * Attached nodes do not receive their own frames. The endpoint created by simulith_can_init
+     * is node 0, which the bus-level functions operate on and which also receives its own frames.
+     *
+     * A node that does not keep up with the traffic only loses its own frames once its queue is
+     * full, see simulith_can_node_get_dropped. The frames it has queued stay in the shared frame
+     * pool until it receives them, and the pool is sized for every node to do so at once, so a
+     * lagging node does not stall the senders. Only more than 64 threads sending at the same
+     * time can find the pool empty.
+     *
+     * Any number of threads may send on a bus while one thread per node receives from it and one
+     * thread calls simulith_can_dispatch; node queues and the frame pool are lock-free. Setup calls
+     * (init, attach, detach, filters, dispatch and timing modes) and simulith_can_advance must not
+     * run concurrently with traffic, and with timing enabled sends must come from a single thread.
+     *
+     * @param bus_id Bus identifier
+     * @param rx_cb Callback function for receive operations (NULL if not used)
+     * @return Node ID on success (>= 1), -1 on failure
+     */
+    int simulith_can_attach(uint8_t bus_id, simulith_can_rx_callback rx_cb);
+
+    /**
+     * @brief Detach a node from a CAN bus, discarding its queued frames
+     * @param bus_id Bus identifier
+     * @param node_id Node identifier returned by simulith_can_attach
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_can_detach(uint8_t bus_id, int node_id);
+
     /**
      * @brief Add a message filter
      * @param bus_id Bus identifier
@@ -66,6 +147,33 @@ extern "C"
      */
     int simulith_can_add_filter(uint8_t bus_id, const simulith_can_filter_t *filter);
 
+    /**
+     * @brief Add a message filter with its own receive callback
+     *
+     * Outside SIMULITH_CAN_DISPATCH_POLL mode, frames matching the filter go to this callback
+     * instead of the bus callback. If several filters match, the lowest filter ID wins.
+     *
+     * @param bus_id Bus identifier
+     * @param filter Filter configuration
+     * @param callback Callback for matching frames (NULL behaves like simulith_can_add_filter)
+     * @param ctx Context pointer passed to the callback
+     * @return Filter ID on success (>= 0), -1 on failure
+     */
+    int simulith_can_add_filter_callback(uint8_t bus_id, const simulith_can_filter_t *filter,
+                                         simulith_can_filter_callback callback, void *ctx);
+
+    /**
+     * @brief Add a message filter to a node, see simulith_can_add_filter_callback
+     * @param bus_id Bus identifier
+     * @param node_id Node identifier
+     * @param filter Filter configuration
+     * @param callback Callback for matching frames (NULL for an acceptance-only filter)
+     * @param ctx Context pointer passed to the callback
+     * @return Filter ID on success (>= 0), -1 on failure
+     */
+    int simulith_can_node_add_filter(uint8_t bus_id, int node_id, const simulith_can_filter_t *filter,
+                                     simulith_can_filter_callback callback, void *ctx);
+
     /**
      * @brief Remove a message filter
      * @param bus_id Bus identifier
@@ -74,6 +182,15 @@ extern "C"
      */
     int simulith_can_remove_filter(uint8_t bus_id, int filter_id);
 
+    /**
+     * @brief Remove a message filter from a node
+     * @param bus_id Bus identifier
+     * @param node_id Node identifier
+     * @param filter_id Filter identifier returned by simulith_can_node_add_filter
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_can_node_remove_filter(uint8_t bus_id, int node_id, int filter_id);
+
     /**
      * @brief Send a CAN message
      * @param bus_id Bus identifier
@@ -86,10 +203,171 @@ extern "C"
      * @brief Receive a CAN message (non-blocking)
      * @param bus_id Bus identifier
      * @param msg Buffer to store received message
-     * @return 1 if message received, 0 if no message available, -1 on failure
+     * @return 1 if message received, 0 if no message available, -1 on failure or if the next frame is CAN FD
      */
     int simulith_can_receive(uint8_t bus_id, simulith_can_message_t *msg);
 
+    /**
+     * @brief Send a CAN FD message
+     *
+     * The bus must have been initialized with a non-zero data_bitrate.
+     *
+     * @param bus_id Bus identifier
+     * @param msg Message to send
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_can_send_fd(uint8_t bus_id, const simulith_can_fd_message_t *msg);
+
+    /**
+     * @brief Receive a CAN or CAN FD message (non-blocking)
+     *
+     * Classic frames are returned with SIMULITH_CAN_FLAG_FDF clear and len set to their DLC.
+     *
+     * @param bus_id Bus identifier
+     * @param msg Buffer to store received message
+     * @return 1 if message received, 0 if no message available, -1 on failure
+     */
+    int simulith_can_receive_fd(uint8_t bus_id, simulith_can_fd_message_t *msg);
+
+    /**
+     * @brief Send a CAN or CAN FD message from a node
+     *
+     * The frame is CAN FD if SIMULITH_CAN_FLAG_FDF is set, otherwise classic (len 0-8, RTR allowed).
+     *
+     * @param bus_id Bus identifier
+     * @param node_id Node identifier
+     * @param msg Message to send
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_can_node_send(uint8_t bus_id, int node_id, const simulith_can_fd_message_t *msg);
+
+    /**
+     * @brief Receive a CAN or CAN FD message queued for a node (non-blocking)
+     * @param bus_id Bus identifier
+     * @param node_id Node identifier
+     * @param msg Buffer to store received message
+     * @return 1 if message received, 0 if no message available, -1 on failure
+     */
+    int simulith_can_node_receive(uint8_t bus_id, int node_id, simulith_can_fd_message_t *msg);
+
+    /**
+     * @brief Send a batch of CAN messages
+     *
+     * All messages are validated before any is sent; one invalid message rejects the whole batch.
+     * Sending stops at the first message the bus cannot take, when the frame pool or the transmit
+     * queue is full. Frames that do not fit in the receive queue are dropped, as with simulith_can_send.
+     *
+     * @param bus_id Bus identifier
+     * @param msgs Array of messages to send
+     * @param count Number of messages in the array
+     * @return Number of messages sent, -1 on failure or if none could be sent
+     */
+    int simulith_can_send_batch(uint8_t bus_id, const simulith_can_message_t *msgs, size_t count);
+
+    /**
+     * @brief Receive up to max_count CAN messages (non-blocking)
+     * @param bus_id Bus identifier
+     * @param msgs Buffer to store received messages
+     * @param max_count Capacity of the buffer in messages
+     * @return Number of messages received (0 if none available), -1 on failure
+     */
+    int simulith_can_receive_batch(uint8_t bus_id, simulith_can_message_t *msgs, size_t max_count);
+
+    /**
+     * @brief Select how received frames are delivered
+     *
+     * In the immediate and deferred modes, frames are dispatched to the callback of the first
+     * matching filter, else to the bus callback given to simulith_can_init (classic frames only).
+     * Frames with no callback are still queued for simulith_can_receive.
+     *
+     * @param bus_id Bus identifier
+     * @param mode Dispatch mode
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_can_set_dispatch_mode(uint8_t bus_id, simulith_can_dispatch_mode_t mode);
+
+    /**
+     * @brief Select how received frames are delivered to a node, see simulith_can_set_dispatch_mode
+     * @param bus_id Bus identifier
+     * @param node_id Node identifier
+     * @param mode Dispatch mode
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_can_node_set_dispatch_mode(uint8_t bus_id, int node_id, simulith_can_dispatch_mode_t mode);
+
+    /**
+     * @brief Dispatch frames queued in SIMULITH_CAN_DISPATCH_DEFERRED mode on every node of a bus
+     *
+     * Intended to be called once per tick. Frames sent from within the callbacks are
+     * left for the next call.
+     *
+     * @param bus_id Bus identifier
+     * @return Number of frames dispatched, -1 on failure
+     */
+    int simulith_can_dispatch(uint8_t bus_id);
+
+    /**
+     * @brief Enable or disable the bit timing model of a bus
+     *
+     * With timing enabled, sent frames are not delivered right away. They wait for the bus and
+     * are transmitted one at a time as simulith_can_advance moves bus time forward, the lowest
+     * arbitration field (ID, then RTR/IDE) winning when several are pending. Frame durations
+     * include stuff bits and follow the bitrate, and the data bitrate after BRS in CAN FD frames.
+     * Enabling resets bus time and statistics; disabling delivers all pending frames at once.
+     *
+     * @param bus_id Bus identifier
+     * @param enable true to enable the model
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_can_set_timing(uint8_t bus_id, bool enable);
+
+    /**
+     * @brief Advance bus time and deliver the frames whose transmission ends by then
+     *
+     * Intended to be called from the tick callback with the tick time.
+     *
+     * @param bus_id Bus identifier
+     * @param now_ns New bus time in nanoseconds, not earlier than the previous one
+     * @return Number of frames delivered (0 when timing is disabled), -1 on failure
+     */
+    int simulith_can_advance(uint8_t bus_id, uint64_t now_ns);
+
+    /**
+     * @brief Get the bus load statistics collected since timing was enabled
+     * @param bus_id Bus identifier
+     * @param stats Buffer to store the statistics
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_can_get_stats(uint8_t bus_id, simulith_can_bus_stats_t *stats);
+
+    /**
+     * @brief Time a frame holds the bus at the bitrates of a bus, including stuff bits and intermission
+     * @param bus_id Bus identifier
+     * @param msg Frame, a classic frame when SIMULITH_CAN_FLAG_FDF is not set
+     * @return Duration in nanoseconds, -1 on failure
+     */
+    int64_t simulith_can_frame_duration_ns(uint8_t bus_id, const simulith_can_fd_message_t *msg);
+
+    /**
+     * @brief Get the number of frames a node lost because its receive queue was full
+     * @param bus_id Bus identifier
+     * @param node_id Node identifier (0 for the bus endpoint)
+     * @param dropped Buffer to store the count
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_can_node_get_dropped(uint8_t bus_id, int node_id, uint64_t *dropped);
+
+    /**
+     * @brief Get the generation of a bus
+     *
+     * Each simulith_can_init starts a new generation, so code holding a node identifier can
+     * tell whether the bus was closed and initialized again since it attached.
+     *
+     * @param bus_id Bus identifier
+     * @return Generation (>= 1), 0 if the bus is not initialized
+     */
+    uint32_t simulith_can_get_generation(uint8_t bus_id);
+
     /**
      * @brief Close a CAN bus
      * @param bus_id Bus identifier
@@ -103,8 +381,20 @@ extern "C"
 #define SIMULITH_CAN_BITRATE_500K 500000
 #define SIMULITH_CAN_BITRATE_1M   1000000
 
+#define SIMULITH_CAN_FD_BITRATE_2M  2000000
+#define SIMULITH_CAN_FD_BITRATE_5M  5000000
+#define SIMULITH_CAN_FD_BITRATE_MAX 8000000
+
 #define SIMULITH_CAN_MAX_FILTERS 16
+#define SIMULITH_CAN_MAX_NODES   32
 #define SIMULITH_CAN_MAX_DLC     8
+#define SIMULITH_CAN_FD_MAX_LEN  64
+
+// Frame flags for simulith_can_fd_message_t
+#define SIMULITH_CAN_FLAG_RTR 0x01 /**< Remote frame (classic frames only) */
+#define SIMULITH_CAN_FLAG_FDF 0x02 /**< FD format frame */
+#define SIMULITH_CAN_FLAG_BRS 0x04 /**< Bit rate switch to the data phase bitrate */
+#define SIMULITH_CAN_FLAG_ESI 0x08 /**< Error state indicator */
 
 // Macros for CAN ID types
 #define SIMULITH_CAN_ID_STD_MAX 0x7FF      /**< Maximum 11-bit standard ID */
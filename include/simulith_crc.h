@@ -0,0 +1,94 @@
+#ifndef SIMULITH_CRC_H
+#define SIMULITH_CRC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Update a CRC-16-CCITT (the CCSDS frame error control field)
+     *
+     * Polynomial 0x1021, most significant bit first, no final XOR. Start with
+     * SIMULITH_CRC16_CCITT_INIT and feed the data in as many pieces as needed.
+     *
+     * @param crc CRC of the preceding data
+     * @param data Data to add
+     * @param len Number of bytes
+     * @return Updated CRC
+     */
+    uint16_t simulith_crc16_ccitt(uint16_t crc, const void *data, size_t len);
+
+    /**
+     * @brief Update a CRC-16/X.25 (the HDLC and PPP frame check sequence)
+     *
+     * Polynomial 0x1021, reflected, with the initial value 0xFFFF and the final XOR applied
+     * internally. Start with 0 and feed the data in as many pieces as needed.
+     *
+     * @param crc CRC of the preceding data
+     * @param data Data to add
+     * @param len Number of bytes
+     * @return Updated CRC
+     */
+    uint16_t simulith_crc16_x25(uint16_t crc, const void *data, size_t len);
+
+    /**
+     * @brief Update a CRC-32C (Castagnoli, as used by CSP)
+     *
+     * Reflected, with the initial value and final XOR applied internally. Start with 0 and
+     * feed the data in as many pieces as needed. Uses the SSE4.2 crc32 instruction when
+     * the CPU has it.
+     *
+     * @param crc CRC of the preceding data
+     * @param data Data to add
+     * @param len Number of bytes
+     * @return Updated CRC
+     */
+    uint32_t simulith_crc32c(uint32_t crc, const void *data, size_t len);
+
+    /**
+     * @brief Get the size of a CRC field
+     * @param type SIMULITH_CRC_*
+     * @return Size in bytes, 0 for SIMULITH_CRC_NONE or an unknown type
+     */
+    size_t simulith_crc_size(uint8_t type);
+
+    /**
+     * @brief Check the CRC field at the end of a frame
+     *
+     * The field is the CRC of the bytes before it, most significant byte first, except for
+     * SIMULITH_CRC_CRC16_X25 which goes least significant byte first as in HDLC.
+     *
+     * @param type SIMULITH_CRC_*
+     * @param frame Frame including the CRC field
+     * @param len Frame length in bytes
+     * @return true if the field matches (always for SIMULITH_CRC_NONE)
+     */
+    bool simulith_crc_check(uint8_t type, const uint8_t *frame, size_t len);
+
+    /**
+     * @brief Append the CRC field to a frame, see simulith_crc_check
+     * @param type SIMULITH_CRC_*
+     * @param frame Frame, with room for simulith_crc_size(type) more bytes
+     * @param len Frame length in bytes without the CRC field
+     * @return Frame length including the CRC field
+     */
+    size_t simulith_crc_stamp(uint8_t type, uint8_t *frame, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+// CRC field types
+#define SIMULITH_CRC_NONE        0
+#define SIMULITH_CRC_CRC16_CCITT 1
+#define SIMULITH_CRC_CRC32C      2
+#define SIMULITH_CRC_CRC16_X25   3
+
+#define SIMULITH_CRC16_CCITT_INIT 0xFFFF
+
+#endif // SIMULITH_CRC_H
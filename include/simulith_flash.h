@@ -0,0 +1,139 @@
+#ifndef SIMULITH_FLASH_H
+#define SIMULITH_FLASH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Flash or EEPROM device configuration
+     */
+    typedef struct
+    {
+        uint8_t  type;        /**< SIMULITH_FLASH_NOR or SIMULITH_FLASH_EEPROM */
+        uint32_t page_size;   /**< Program page size in bytes, a power of two (0 for 256) */
+        uint32_t sector_size; /**< Erase sector size in bytes, a power of two (0 for 4096) */
+        uint8_t  addr_bytes;  /**< Address bytes of the 3-byte address commands (0 to fit the size) */
+        uint32_t jedec_id;    /**< Manufacturer and device ID returned by the JEDEC ID command */
+        bool     persist;     /**< Write changes back to the image instead of discarding them */
+    } simulith_flash_config_t;
+
+    /**
+     * @brief Open a flash or EEPROM device backed by an image file
+     *
+     * The image is memory-mapped, so opening takes the same time for any size and only the
+     * pages the software reads are loaded. Unless persist is set, the mapping is
+     * copy-on-write: the run sees its own writes and the image file stays untouched. The
+     * device size is the image size.
+     *
+     * NOR devices can only clear bits when programming and set them again by erasing a
+     * sector. EEPROM devices overwrite bytes. Programming wraps within a page.
+     *
+     * @param path Image file
+     * @param config Device configuration
+     * @return Device identifier (>= 0) on success, -1 on failure
+     */
+    int simulith_flash_open(const char *path, const simulith_flash_config_t *config);
+
+    /**
+     * @brief Attach a device to an SPI chip select as a serial NOR flash or EEPROM
+     *
+     * Supports READ (0x03), FAST_READ (0x0B), their 4-byte address forms (0x13, 0x0C),
+     * PAGE PROGRAM (0x02, 0x12), SECTOR ERASE (0x20, 0x21), CHIP ERASE (0x60, 0xC7),
+     * WRITE ENABLE (0x06), WRITE DISABLE (0x04), READ STATUS (0x05) and JEDEC ID (0x9F).
+     * Commands may span the segments of a simulith_spi_transact. Like the page buffer of the
+     * part, PAGE PROGRAM collects its data until the chip select is released, and programs
+     * and erases take effect then.
+     *
+     * @param flash_id Device identifier
+     * @param bus_id SPI bus identifier, initialized with simulith_spi_init
+     * @param cs_id Chip select identifier
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_flash_attach_spi(int flash_id, uint8_t bus_id, uint8_t cs_id);
+
+    /**
+     * @brief Attach a device to an I2C address as a 24xx serial EEPROM
+     *
+     * A write message starts with the address pointer, one byte for devices up to 256 bytes
+     * and two bytes (high byte first) up to 64 KB. The data bytes that follow are a page
+     * write, programmed at the end of the message and wrapping within the page. A read
+     * message reads sequentially from the pointer, wrapping at the end of the device. The
+     * pointer is kept between transactions, so a read without a pointer write continues
+     * where the last access stopped. Write cycle time is not modelled.
+     *
+     * @param flash_id Device identifier, of at most 64 KB
+     * @param bus_id I2C bus identifier, initialized with simulith_i2c_init
+     * @param address Device address, as for simulith_i2c_attach
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_flash_attach_i2c(int flash_id, uint8_t bus_id, uint16_t address);
+
+    /**
+     * @brief Read from a device
+     *
+     * Unlike an SPI READ, which wraps to address 0 at the end of the device, the range must
+     * lie within the device.
+     *
+     * @param flash_id Device identifier
+     * @param address Start address
+     * @param data Buffer to store the data
+     * @param len Number of bytes to read
+     * @return Number of bytes read, -1 on failure
+     */
+    int simulith_flash_read(int flash_id, uint64_t address, uint8_t *data, size_t len);
+
+    /**
+     * @brief Program a device, with the semantics of its type
+     *
+     * As with PAGE PROGRAM over SPI, the data wraps within the page of the start address,
+     * and when it is longer than a page only its last page_size bytes are programmed.
+     *
+     * @param flash_id Device identifier
+     * @param address Start address
+     * @param data Data to program
+     * @param len Number of bytes, at most INT_MAX
+     * @return Number of bytes taken (len), -1 on failure
+     */
+    int simulith_flash_program(int flash_id, uint64_t address, const uint8_t *data, size_t len);
+
+    /**
+     * @brief Erase the sector containing an address to 0xFF
+     * @param flash_id Device identifier
+     * @param address Any address in the sector
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_flash_erase(int flash_id, uint64_t address);
+
+    /**
+     * @brief Get the size of a device
+     * @param flash_id Device identifier
+     * @return Size in bytes, 0 on failure
+     */
+    uint64_t simulith_flash_size(int flash_id);
+
+    /**
+     * @brief Close a device, writing it back to the image if persist is set
+     *
+     * Detach the device from its bus first.
+     *
+     * @param flash_id Device identifier
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_flash_close(int flash_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define SIMULITH_FLASH_NOR    0
+#define SIMULITH_FLASH_EEPROM 1
+
+#define SIMULITH_FLASH_MAX_DEVICES 8
+
+#endif // SIMULITH_FLASH_H
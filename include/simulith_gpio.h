@@ -65,6 +65,35 @@ extern "C"
      */
     int simulith_gpio_toggle(uint8_t port, uint8_t pin);
 
+    /**
+     * @brief Read all pins of a port at once
+     * @param port Port identifier
+     * @param mask Pointer to store the pin states, bit n for pin n (0 for pins not initialized)
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_gpio_port_read(uint8_t port, uint32_t *mask);
+
+    /**
+     * @brief Set several output pins of a port at once
+     *
+     * Either all the pins in the mask change or none does: every one of them must be an
+     * initialized output.
+     *
+     * @param port Port identifier
+     * @param mask Pins to set, bit n for pin n
+     * @param value New states of the pins in the mask, other bits are ignored
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_gpio_port_write(uint8_t port, uint32_t mask, uint32_t value);
+
+    /**
+     * @brief Toggle several output pins of a port at once, like simulith_gpio_port_write
+     * @param port Port identifier
+     * @param mask Pins to toggle, bit n for pin n
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_gpio_port_toggle(uint8_t port, uint32_t mask);
+
     /**
      * @brief Close a GPIO pin
      * @param port Port identifier
@@ -77,6 +106,31 @@ extern "C"
 #define SIMULITH_GPIO_MAX_PORTS 8
 #define SIMULITH_GPIO_MAX_PINS  32
 
+    /**
+     * @brief Pin states of all ports, bit n of state[port] for pin n
+     */
+    typedef struct
+    {
+        uint32_t state[SIMULITH_GPIO_MAX_PORTS];
+    } simulith_gpio_snapshot_t;
+
+    /**
+     * @brief Capture the pin states of all ports, one word per port
+     * @param snapshot Structure to fill
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_gpio_snapshot(simulith_gpio_snapshot_t *snapshot);
+
+    /**
+     * @brief Compare two snapshots, for example of consecutive ticks
+     * @param before Earlier snapshot
+     * @param after Later snapshot
+     * @param changed Structure to store the pins that changed (can be NULL)
+     * @return Number of pins that changed, -1 on failure
+     */
+    int simulith_gpio_diff(const simulith_gpio_snapshot_t *before, const simulith_gpio_snapshot_t *after,
+                           simulith_gpio_snapshot_t *changed);
+
 #ifdef __cplusplus
 }
 #endif
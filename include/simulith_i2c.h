@@ -1,6 +1,7 @@
 #ifndef SIMULITH_I2C_H
 #define SIMULITH_I2C_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -9,6 +10,32 @@ extern "C"
 {
 #endif
 
+    /**
+     * @brief One message of a combined I2C transaction, separated by repeated starts
+     */
+    typedef struct
+    {
+        uint16_t addr;  /**< Device address, 10-bit addresses ORed with SIMULITH_I2C_ADDR_10BIT */
+        uint16_t flags; /**< SIMULITH_I2C_M_RD for a read, 0 for a write */
+        uint8_t *buf;   /**< Data to write, or buffer to store read data */
+        size_t   len;   /**< Number of bytes, at least 1 */
+    } simulith_i2c_msg_t;
+
+    /**
+     * @brief Bus timing statistics, see simulith_i2c_set_speed
+     */
+    typedef struct
+    {
+        uint64_t time_ns;          /**< Bus time since the speed was set */
+        uint64_t busy_ns;          /**< Time spent in transactions, clock stretching included */
+        uint64_t transactions;     /**< Transactions, NACKed ones included */
+        uint64_t nacks;            /**< Transactions NACKed in the address phase */
+        uint64_t overruns;         /**< simulith_i2c_advance intervals shorter than their transactions */
+        uint64_t last_busy_ns;     /**< Time spent in transactions over the last interval */
+        double   utilization;      /**< busy_ns / time_ns */
+        double   last_utilization; /**< last_busy_ns over the last interval, above 1 on overruns */
+    } simulith_i2c_bus_stats_t;
+
     /**
      * @brief Callback function type for I2C read operations
      * @param addr Device address
@@ -29,8 +56,57 @@ extern "C"
      */
     typedef int (*simulith_i2c_write_callback)(uint8_t addr, uint8_t reg, const uint8_t *data, size_t len);
 
+    /**
+     * @brief Operations of a device attached to an I2C address
+     */
+    typedef struct
+    {
+        /**
+         * @brief Read from the device
+         * @param bus_id Bus identifier
+         * @param addr Device address, as given to simulith_i2c_attach
+         * @param reg Register address
+         * @param data Buffer to store read data
+         * @param len Number of bytes to read
+         * @param ctx Context pointer given to simulith_i2c_attach
+         * @return 0 on success, -1 on failure
+         */
+        int (*read)(uint8_t bus_id, uint16_t addr, uint8_t reg, uint8_t *data, size_t len, void *ctx);
+
+        /**
+         * @brief Write to the device
+         * @param bus_id Bus identifier
+         * @param addr Device address, as given to simulith_i2c_attach
+         * @param reg Register address
+         * @param data Data to write
+         * @param len Number of bytes to write
+         * @param ctx Context pointer given to simulith_i2c_attach
+         * @return 0 on success, -1 on failure
+         */
+        int (*write)(uint8_t bus_id, uint16_t addr, uint8_t reg, const uint8_t *data, size_t len, void *ctx);
+
+        /**
+         * @brief Take consecutive messages of a combined transaction at once (optional)
+         *
+         * Without it, each write message reaches write with its first byte as the register,
+         * and a one byte write followed by a read reaches read.
+         *
+         * @param bus_id Bus identifier
+         * @param addr Device address, as given to simulith_i2c_attach
+         * @param msgs Messages, all to this device
+         * @param count Number of messages
+         * @param ctx Context pointer given to simulith_i2c_attach
+         * @return 0 on success, -1 on failure
+         */
+        int (*transfer)(uint8_t bus_id, uint16_t addr, const simulith_i2c_msg_t *msgs, size_t count, void *ctx);
+    } simulith_i2c_device_ops_t;
+
     /**
      * @brief Initialize an I2C bus
+     *
+     * The callbacks receive accesses to addresses without an attached device. Pass NULL for
+     * both to have those accesses NACKed instead. Initializing detaches all devices.
+     *
      * @param bus_id Bus identifier (0-7)
      * @param read_cb Callback function for read operations
      * @param write_cb Callback function for write operations
@@ -38,30 +114,128 @@ extern "C"
      */
     int simulith_i2c_init(uint8_t bus_id, simulith_i2c_read_callback read_cb, simulith_i2c_write_callback write_cb);
 
+    /**
+     * @brief Attach a device model to an address
+     *
+     * Accesses to the address go straight to the device operations with its context, found
+     * by a table lookup. Accesses to addresses without a device go to the bus callbacks, or
+     * fail with errno set to ENXIO (NACK) if the bus has none.
+     *
+     * @param bus_id Bus identifier
+     * @param addr 7-bit address, or a 10-bit address ORed with SIMULITH_I2C_ADDR_10BIT
+     * @param ops Device operations, copied; NULL to detach the device
+     * @param ctx Context pointer passed to the operations
+     * @return 0 on success, -1 on failure (including an address already in use)
+     */
+    int simulith_i2c_attach(uint8_t bus_id, uint16_t addr, const simulith_i2c_device_ops_t *ops, void *ctx);
+
     /**
      * @brief Read data from an I2C device
      * @param bus_id Bus identifier
-     * @param addr Device address
+     * @param addr Device address, 10-bit addresses ORed with SIMULITH_I2C_ADDR_10BIT
      * @param reg Register address
      * @param data Buffer to store read data
      * @param len Number of bytes to read
-     * @return 0 on success, -1 on failure
+     * @return 0 on success, -1 on failure (errno ENXIO if no device acknowledged)
      */
-    int simulith_i2c_read(uint8_t bus_id, uint8_t addr, uint8_t reg, uint8_t *data, size_t len);
+    int simulith_i2c_read(uint8_t bus_id, uint16_t addr, uint8_t reg, uint8_t *data, size_t len);
 
     /**
      * @brief Write data to an I2C device
      * @param bus_id Bus identifier
-     * @param addr Device address
+     * @param addr Device address, 10-bit addresses ORed with SIMULITH_I2C_ADDR_10BIT
      * @param reg Register address
      * @param data Data to write
      * @param len Number of bytes to write
+     * @return 0 on success, -1 on failure (errno ENXIO if no device acknowledged)
+     */
+    int simulith_i2c_write(uint8_t bus_id, uint16_t addr, uint8_t reg, const uint8_t *data, size_t len);
+
+    /**
+     * @brief Execute a combined transaction: messages separated by repeated starts, then a stop
+     *
+     * All messages are checked, and every address must acknowledge, before any is dispatched,
+     * so a failed check leaves the devices untouched. Consecutive messages to a device with a
+     * transfer operation reach it in one call. Otherwise a write message is a register write
+     * (register, data...) and a one byte write followed by a read is a register read; other
+     * shapes fail the check.
+     *
+     * @param bus_id Bus identifier
+     * @param msgs Messages
+     * @param count Number of messages (1 to SIMULITH_I2C_MAX_MSGS)
+     * @return Number of messages executed, -1 on failure (errno ENXIO if an address did not
+     *         acknowledge)
+     */
+    int simulith_i2c_transfer(uint8_t bus_id, const simulith_i2c_msg_t *msgs, size_t count);
+
+    /**
+     * @brief Set the clock speed of a bus and enable transaction timing
+     *
+     * Transactions still complete right away, but each one is charged the time it would hold
+     * the bus: start and stop conditions, address bytes (two for 10-bit addresses, and the
+     * first again after a repeated start for reads, only that one when the message before
+     * addressed the same device), nine clocks per byte for the data and
+     * ACK bits, repeated starts between messages, and the clock stretching of the devices.
+     * A NACKed transaction holds the bus for its address phase. simulith_i2c_advance closes
+     * each tick and counts an overrun when its transactions took longer than the tick.
+     * Setting the speed resets bus time and statistics.
+     *
+     * @param bus_id Bus identifier
+     * @param speed_hz SCL frequency, such as SIMULITH_I2C_SPEED_FAST (0 to disable timing)
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_i2c_set_speed(uint8_t bus_id, uint32_t speed_hz);
+
+    /**
+     * @brief Set the time a device holds SCL low in each message addressed to it
+     * @param bus_id Bus identifier
+     * @param addr Address of an attached device
+     * @param stretch_ns Clock stretching per message in nanoseconds
      * @return 0 on success, -1 on failure
      */
-    int simulith_i2c_write(uint8_t bus_id, uint8_t addr, uint8_t reg, const uint8_t *data, size_t len);
+    int simulith_i2c_set_clock_stretch(uint8_t bus_id, uint16_t addr, uint64_t stretch_ns);
+
+    /**
+     * @brief Time a combined transaction holds the bus at its speed
+     * @param bus_id Bus identifier
+     * @param msgs Messages, buffers are not accessed
+     * @param count Number of messages (1 to SIMULITH_I2C_MAX_MSGS)
+     * @return Duration in nanoseconds (0 when timing is disabled), -1 on failure
+     */
+    int64_t simulith_i2c_transaction_duration_ns(uint8_t bus_id, const simulith_i2c_msg_t *msgs, size_t count);
+
+    /**
+     * @brief Advance bus time, closing the accounting interval
+     *
+     * Intended to be called from the tick callback with the tick time.
+     *
+     * @param bus_id Bus identifier
+     * @param now_ns New bus time in nanoseconds, not earlier than the previous one
+     * @return 0 on success, 1 if the transactions of the interval overran it, -1 on failure
+     */
+    int simulith_i2c_advance(uint8_t bus_id, uint64_t now_ns);
+
+    /**
+     * @brief Get the timing statistics collected since the speed was set
+     * @param bus_id Bus identifier
+     * @param stats Buffer to store the statistics
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_i2c_get_stats(uint8_t bus_id, simulith_i2c_bus_stats_t *stats);
 
 #ifdef __cplusplus
 }
 #endif
 
+#define SIMULITH_I2C_M_RD 0x0001 /**< Message flag: read from the device */
+
+#define SIMULITH_I2C_SPEED_STANDARD  100000  /**< Standard-mode, 100 kHz */
+#define SIMULITH_I2C_SPEED_FAST      400000  /**< Fast-mode, 400 kHz */
+#define SIMULITH_I2C_SPEED_FAST_PLUS 1000000 /**< Fast-mode Plus, 1 MHz */
+#define SIMULITH_I2C_SPEED_HIGH      3400000 /**< High-speed mode, 3.4 MHz */
+
+#define SIMULITH_I2C_ADDR_10BIT        0x8000 /**< Flag marking a 10-bit address */
+#define SIMULITH_I2C_MAX_10BIT_DEVICES 16     /**< 10-bit addressed devices per bus */
+#define SIMULITH_I2C_MAX_MSGS          32     /**< Messages per combined transaction */
+
 #endif /* SIMULITH_I2C_H */
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef SIMULITH_PTY_H
+#define SIMULITH_PTY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief PTY bridge statistics
+     */
+    typedef struct
+    {
+        uint64_t rx_bytes; /**< Bytes read from the terminal and injected into the port */
+        uint64_t tx_bytes; /**< Bytes sent on the port and written to the terminal */
+        uint64_t dropped;  /**< Bytes sent on the port while the terminal buffer was full */
+    } simulith_pty_stats_t;
+
+    /**
+     * @brief Expose a UART port as a pseudo-terminal
+     *
+     * The bridge takes over the port's receive callback, so data sent on the port goes to
+     * the terminal, and data written to the terminal can be read with simulith_uart_receive.
+     * The terminal is in raw mode. Data only moves in simulith_pty_tick.
+     *
+     * @param port_id Port identifier, initialized with simulith_uart_init
+     * @param path Buffer to store the terminal device path (e.g. /dev/pts/3), may be NULL
+     * @param path_len Size of the path buffer
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_pty_open(uint8_t port_id, char *path, size_t path_len);
+
+    /**
+     * @brief Move data between the terminal and the port
+     *
+     * Data written to the terminal since the last tick is injected into the port, then
+     * simulith_uart_advance releases paced transmit data and everything sent on the port
+     * is written to the terminal, in batches. When pacing is enabled on the port, the
+     * terminal side is paced at the same baud rate and the rest stays in the terminal.
+     *
+     * @param port_id Port identifier
+     * @param now_ns Current simulation time in nanoseconds
+     * @return Number of bytes moved, -1 on failure
+     */
+    int simulith_pty_tick(uint8_t port_id, uint64_t now_ns);
+
+    /**
+     * @brief Get the bridge statistics
+     * @param port_id Port identifier
+     * @param stats Buffer to store the statistics
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_pty_get_stats(uint8_t port_id, simulith_pty_stats_t *stats);
+
+    /**
+     * @brief Close the terminal and give the port its loopback back
+     * @param port_id Port identifier
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_pty_close(uint8_t port_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Bytes buffered per direction between ticks
+#define SIMULITH_PTY_BUFFER_SIZE 4096
+
+#endif // SIMULITH_PTY_H
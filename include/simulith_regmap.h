@@ -0,0 +1,114 @@
+#ifndef SIMULITH_REGMAP_H
+#define SIMULITH_REGMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Create a register map in a named shared-memory segment
+     *
+     * The register map holds the registers of a device model, so that a separate process,
+     * such as the environment model, can update sensor values while the flight software
+     * reads them through its bus without any messaging. Updates are published with a
+     * sequence lock: readers never block the writer and never see a half-written update.
+     * Reads and writes fail rather than wait forever when an update never completes, as
+     * when the process making it died.
+     * The registers start zeroed. Closing the map removes the segment.
+     *
+     * @param name Segment name, starting with '/'
+     * @param size Number of register bytes
+     * @return Register map identifier (>= 0) on success, -1 on failure
+     */
+    int simulith_regmap_create(const char *name, size_t size);
+
+    /**
+     * @brief Open a register map created by another process
+     * @param name Segment name given to simulith_regmap_create
+     * @return Register map identifier (>= 0) on success, -1 on failure
+     */
+    int simulith_regmap_open(const char *name);
+
+    /**
+     * @brief Update registers as one consistent change
+     * @param regmap_id Register map identifier
+     * @param offset First register
+     * @param data Register values
+     * @param len Number of bytes
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_regmap_write(int regmap_id, size_t offset, const void *data, size_t len);
+
+    /**
+     * @brief Read a consistent snapshot of registers
+     *
+     * Retries while an update is in progress, so the bytes read all come from the same
+     * update. Fails when the update is still in progress after SIMULITH_REGMAP_SPINS retries.
+     *
+     * @param regmap_id Register map identifier
+     * @param offset First register
+     * @param data Buffer to store the register values
+     * @param len Number of bytes
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_regmap_read(int regmap_id, size_t offset, void *data, size_t len);
+
+    /**
+     * @brief Get the number of updates made to a register map
+     * @param regmap_id Register map identifier
+     * @return Number of completed updates, 0 on failure
+     */
+    uint32_t simulith_regmap_updates(int regmap_id);
+
+    /**
+     * @brief Serve an I2C address from a register map
+     *
+     * Register reads and writes at the address access the map directly, the register
+     * address being the offset.
+     *
+     * @param regmap_id Register map identifier
+     * @param bus_id I2C bus identifier, initialized with simulith_i2c_init
+     * @param addr Device address, as for simulith_i2c_attach
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_regmap_attach_i2c(int regmap_id, uint8_t bus_id, uint16_t addr);
+
+    /**
+     * @brief Serve an SPI chip select from a register map
+     *
+     * Uses the register protocol of simulith_spi_attach_registers: the first byte after the
+     * chip select is asserted is the register address, with SIMULITH_REGMAP_SPI_READ set for
+     * a read. The following bytes read or write registers from there on, incrementing the
+     * address.
+     *
+     * @param regmap_id Register map identifier
+     * @param bus_id SPI bus identifier, initialized with simulith_spi_init
+     * @param cs_id Chip select identifier
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_regmap_attach_spi(int regmap_id, uint8_t bus_id, uint8_t cs_id);
+
+    /**
+     * @brief Close a register map, removing the segment if this process created it
+     *
+     * Detach the map from its buses first.
+     *
+     * @param regmap_id Register map identifier
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_regmap_close(int regmap_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define SIMULITH_REGMAP_SPI_READ 0x80 /**< Register address flag of SPI reads, as SIMULITH_SPI_REG_READ */
+
+#define SIMULITH_REGMAP_MAX_MAPS 64
+#define SIMULITH_REGMAP_SPINS    100000 /**< Attempts to get past an update in progress before failing */
+
+#endif // SIMULITH_REGMAP_H
@@ -0,0 +1,136 @@
+#ifndef SIMULITH_SENSOR_H
+#define SIMULITH_SENSOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Callback function type computing a sensor sample
+     *
+     * Called when the software reads the sensor and the cached sample is out of date, so
+     * sensors that are read less often than the simulation ticks cost nothing in between.
+     * The callback updates the measurement registers in place and can look at the
+     * configuration registers the software wrote.
+     *
+     * @param time_ns Simulation time of the sample in nanoseconds, a multiple of the period
+     * @param registers Register image of the sensor
+     * @param size Number of registers
+     * @param ctx Context pointer from the sensor configuration
+     * @return 0 on success, -1 on failure
+     */
+    typedef int (*simulith_sensor_sample_callback)(uint64_t time_ns, uint8_t *registers, size_t size, void *ctx);
+
+    /**
+     * @brief Sensor model configuration
+     */
+    typedef struct
+    {
+        size_t                          size;      /**< Number of registers (1 to SIMULITH_SENSOR_MAX_REGS) */
+        uint64_t                        period_ns; /**< Output data period, 0 for a new sample every tick */
+        simulith_sensor_sample_callback sample;    /**< Computes a sample */
+        void                           *ctx;       /**< Context pointer passed to sample */
+    } simulith_sensor_config_t;
+
+    /**
+     * @brief Sensor statistics
+     */
+    typedef struct
+    {
+        uint64_t reads;   /**< Register reads by the software */
+        uint64_t samples; /**< Calls to the sample callback */
+    } simulith_sensor_stats_t;
+
+    /**
+     * @brief Create a lazily sampled sensor model
+     * @param config Sensor configuration
+     * @return Sensor identifier (>= 0) on success, -1 on failure
+     */
+    int simulith_sensor_create(const simulith_sensor_config_t *config);
+
+    /**
+     * @brief Move the simulation time of all sensors forward
+     *
+     * Only records the time, call it from the tick callback. A read samples again when the
+     * time has moved by at least the sensor period since the cached sample, or the software
+     * wrote a register.
+     *
+     * @param now_ns Simulation time in nanoseconds
+     */
+    void simulith_sensor_advance(uint64_t now_ns);
+
+    /**
+     * @brief Serve an I2C address from a sensor, the register address being the offset
+     * @param sensor_id Sensor identifier
+     * @param bus_id I2C bus identifier, initialized with simulith_i2c_init
+     * @param addr Device address, as for simulith_i2c_attach
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_sensor_attach_i2c(int sensor_id, uint8_t bus_id, uint16_t addr);
+
+    /**
+     * @brief Serve an SPI chip select from a sensor
+     *
+     * Uses the register protocol of simulith_spi_attach_registers: the first byte after the
+     * chip select is asserted is the register address, with SIMULITH_SENSOR_SPI_READ set for
+     * a read, then registers follow from there on.
+     *
+     * @param sensor_id Sensor identifier
+     * @param bus_id SPI bus identifier, initialized with simulith_spi_init
+     * @param cs_id Chip select identifier
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_sensor_attach_spi(int sensor_id, uint8_t bus_id, uint8_t cs_id);
+
+    /**
+     * @brief Read registers, sampling first if the cached sample is out of date
+     * @param sensor_id Sensor identifier
+     * @param reg First register
+     * @param data Buffer to store the register values
+     * @param len Number of bytes
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_sensor_read(int sensor_id, uint8_t reg, uint8_t *data, size_t len);
+
+    /**
+     * @brief Write registers, the next read samples again
+     * @param sensor_id Sensor identifier
+     * @param reg First register
+     * @param data Register values
+     * @param len Number of bytes
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_sensor_write(int sensor_id, uint8_t reg, const uint8_t *data, size_t len);
+
+    /**
+     * @brief Get sensor statistics
+     * @param sensor_id Sensor identifier
+     * @param stats Structure to fill
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_sensor_get_stats(int sensor_id, simulith_sensor_stats_t *stats);
+
+    /**
+     * @brief Destroy a sensor model
+     *
+     * Detach the sensor from its buses first.
+     *
+     * @param sensor_id Sensor identifier
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_sensor_destroy(int sensor_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define SIMULITH_SENSOR_SPI_READ 0x80 /**< Register address flag of SPI reads, as SIMULITH_SPI_REG_READ */
+
+#define SIMULITH_SENSOR_MAX_SENSORS 64
+#define SIMULITH_SENSOR_MAX_REGS    256
+
+#endif // SIMULITH_SENSOR_H
@@ -0,0 +1,81 @@
+#ifndef SIMULITH_SOCKETCAN_H
+#define SIMULITH_SOCKETCAN_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief SocketCAN bridge statistics
+     */
+    typedef struct
+    {
+        uint64_t rx_frames; /**< Frames read from the socket and sent on the bus */
+        uint64_t tx_frames; /**< Frames received on the bus and written to the socket */
+        uint64_t dropped;   /**< Frames rejected by the bus or the socket, or lost between ticks */
+    } simulith_socketcan_stats_t;
+
+    /**
+     * @brief Bridge a CAN bus to a Linux SocketCAN interface (e.g. vcan0)
+     *
+     * The bridge attaches to the bus as a node that accepts every frame. Frames only move
+     * in simulith_socketcan_tick, so software on the interface sees bus traffic at tick
+     * boundaries. Frames received on the bus beyond what the node queue holds between two
+     * ticks are dropped and counted in the statistics. CAN FD frames are bridged as well.
+     *
+     * @param bus_id Bus identifier, initialized with simulith_can_init
+     * @param ifname Network interface name
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_socketcan_open(uint8_t bus_id, const char *ifname);
+
+    /**
+     * @brief Bridge a CAN bus to an already open socket, see simulith_socketcan_open
+     *
+     * The socket must carry one struct can_frame or struct canfd_frame per datagram, as
+     * a bound CAN_RAW socket does. The bridge takes ownership of the descriptor.
+     *
+     * @param bus_id Bus identifier, initialized with simulith_can_init
+     * @param fd Socket descriptor
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_socketcan_attach_fd(uint8_t bus_id, int fd);
+
+    /**
+     * @brief Move frames between the socket and the bus
+     *
+     * Frames written by software on the interface since the last tick are sent on the bus,
+     * then frames received on the bus are written to the socket, in batches. Call once per
+     * tick, after simulith_can_advance when the bus timing model is enabled.
+     *
+     * @param bus_id Bus identifier
+     * @return Number of frames moved, -1 on failure
+     */
+    int simulith_socketcan_tick(uint8_t bus_id);
+
+    /**
+     * @brief Get the bridge statistics
+     * @param bus_id Bus identifier
+     * @param stats Buffer to store the statistics
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_socketcan_get_stats(uint8_t bus_id, simulith_socketcan_stats_t *stats);
+
+    /**
+     * @brief Detach the bridge from the bus and close its socket
+     * @param bus_id Bus identifier
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_socketcan_close(uint8_t bus_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Frames moved per recvmmsg/sendmmsg call
+#define SIMULITH_SOCKETCAN_BATCH 32
+
+#endif // SIMULITH_SOCKETCAN_H
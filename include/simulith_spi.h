@@ -1,6 +1,7 @@
 #ifndef SIMULITH_SPI_H
 #define SIMULITH_SPI_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -21,6 +22,16 @@ extern "C"
         uint8_t  data_bits;   /**< Data bits per transfer (4-16) */
     } simulith_spi_config_t;
 
+    /**
+     * @brief One segment of an SPI transaction, see simulith_spi_transact
+     */
+    typedef struct
+    {
+        const uint8_t *tx_data; /**< Data to transmit (can be NULL for receive-only) */
+        uint8_t       *rx_data; /**< Buffer for received data (can be NULL for transmit-only) */
+        size_t         len;     /**< Number of bytes to transfer */
+    } simulith_spi_segment_t;
+
     /**
      * @brief Callback function type for SPI transfer operations
      * @param bus_id Bus identifier
@@ -33,27 +44,218 @@ extern "C"
     typedef int (*simulith_spi_transfer_callback)(uint8_t bus_id, uint8_t cs_id, const uint8_t *tx_data,
                                                   uint8_t *rx_data, size_t len);
 
+    /**
+     * @brief Callback function type for devices attached to a chip select
+     * @param bus_id Bus identifier
+     * @param cs_id Chip select identifier
+     * @param tx_data Data to transmit (can be NULL for receive-only)
+     * @param rx_data Buffer for received data (can be NULL for transmit-only)
+     * @param len Number of bytes to transfer
+     * @param ctx Context pointer given to simulith_spi_attach
+     * @return Number of bytes transferred, -1 on error
+     */
+    typedef int (*simulith_spi_device_callback)(uint8_t bus_id, uint8_t cs_id, const uint8_t *tx_data,
+                                                uint8_t *rx_data, size_t len, void *ctx);
+
+    /**
+     * @brief Callback function type for devices that take transfers in chunks
+     * @param bus_id Bus identifier
+     * @param cs_id Chip select identifier
+     * @param offset Bytes transferred since the chip select was asserted
+     * @param tx_chunk Data to transmit (can be NULL for receive-only)
+     * @param rx_chunk Buffer for received data (can be NULL for transmit-only)
+     * @param len Number of bytes in the chunk, at most SIMULITH_SPI_STREAM_CHUNK
+     * @param ctx Context pointer given to simulith_spi_attach_stream
+     * @return Number of bytes transferred, -1 on error
+     */
+    typedef int (*simulith_spi_stream_callback)(uint8_t bus_id, uint8_t cs_id, size_t offset, const uint8_t *tx_chunk,
+                                                uint8_t *rx_chunk, size_t len, void *ctx);
+
+    /**
+     * @brief Callback function type producing or consuming the chunks of simulith_spi_stream
+     * @param bus_id Bus identifier
+     * @param cs_id Chip select identifier
+     * @param offset Position of the chunk in the stream
+     * @param chunk Chunk to fill with data to transmit, or received data
+     * @param len Number of bytes in the chunk
+     * @param ctx Context pointer given to simulith_spi_stream
+     * @return 0 to go on, -1 to abort the stream
+     */
+    typedef int (*simulith_spi_chunk_callback)(uint8_t bus_id, uint8_t cs_id, size_t offset, uint8_t *chunk, size_t len,
+                                               void *ctx);
+
+    /**
+     * @brief Callback function type for chip select changes
+     * @param bus_id Bus identifier
+     * @param cs_id Chip select identifier
+     * @param asserted true when the chip select is asserted, false when released
+     * @param ctx Context pointer given to simulith_spi_attach
+     */
+    typedef void (*simulith_spi_cs_callback)(uint8_t bus_id, uint8_t cs_id, bool asserted, void *ctx);
+
+    /**
+     * @brief Register operations of a device attached with simulith_spi_attach_registers
+     */
+    typedef struct
+    {
+        /**
+         * @brief Read registers, always within the register count
+         * @param bus_id Bus identifier
+         * @param cs_id Chip select identifier
+         * @param reg First register
+         * @param data Buffer to store the register values
+         * @param len Number of registers, at least 1
+         * @param ctx Context pointer given to simulith_spi_attach_registers
+         * @return 0 on success, -1 on failure
+         */
+        int (*read)(uint8_t bus_id, uint8_t cs_id, size_t reg, uint8_t *data, size_t len, void *ctx);
+
+        /**
+         * @brief Write registers, always within the register count
+         * @param bus_id Bus identifier
+         * @param cs_id Chip select identifier
+         * @param reg First register
+         * @param data Register values
+         * @param len Number of registers, at least 1
+         * @param ctx Context pointer given to simulith_spi_attach_registers
+         * @return 0 on success, -1 on failure
+         */
+        int (*write)(uint8_t bus_id, uint8_t cs_id, size_t reg, const uint8_t *data, size_t len, void *ctx);
+    } simulith_spi_register_ops_t;
+
     /**
      * @brief Initialize an SPI bus
      * @param bus_id Bus identifier (0-7)
      * @param config SPI configuration structure
-     * @param transfer_cb Callback function for transfer operations
+     * @param transfer_cb Callback function for chip selects without a device (NULL if not used)
      * @return 0 on success, -1 on failure
      */
     int simulith_spi_init(uint8_t bus_id, const simulith_spi_config_t *config,
                           simulith_spi_transfer_callback transfer_cb);
 
+    /**
+     * @brief Attach a device model to a chip select
+     *
+     * Transfers on the chip select go straight to the device callback, transfers on chip
+     * selects without a device go to the bus transfer callback, and fail if there is none.
+     *
+     * @param bus_id Bus identifier
+     * @param cs_id Chip select identifier (0 to SIMULITH_SPI_MAX_CS - 1)
+     * @param device_cb Device callback, NULL to detach the device
+     * @param ctx Context pointer passed to the callback
+     * @return 0 on success, -1 on failure (including a chip select already in use)
+     */
+    int simulith_spi_attach(uint8_t bus_id, uint8_t cs_id, simulith_spi_device_callback device_cb, void *ctx);
+
+    /**
+     * @brief Attach a device model that takes transfers in chunks
+     *
+     * Like simulith_spi_attach, but every transfer reaches the device in chunks of at most
+     * SIMULITH_SPI_STREAM_CHUNK bytes, with the offset since the chip select was asserted as
+     * a cursor. The device can produce data on demand without holding a whole readout.
+     *
+     * @param bus_id Bus identifier
+     * @param cs_id Chip select identifier (0 to SIMULITH_SPI_MAX_CS - 1)
+     * @param stream_cb Device callback, NULL to detach the device
+     * @param ctx Context pointer passed to the callback
+     * @return 0 on success, -1 on failure (including a chip select already in use)
+     */
+    int simulith_spi_attach_stream(uint8_t bus_id, uint8_t cs_id, simulith_spi_stream_callback stream_cb, void *ctx);
+
+    /**
+     * @brief Attach a device model made of registers, with the usual command byte protocol
+     *
+     * The first byte after the chip select is asserted is the register address, with
+     * SIMULITH_SPI_REG_READ set for a read. The following bytes read or write registers from
+     * there on, incrementing the address. Bytes past the last register read as 0xFF and are
+     * not written. The bus keeps the command state, so commands may span the segments of a
+     * simulith_spi_transact.
+     *
+     * @param bus_id Bus identifier
+     * @param cs_id Chip select identifier (0 to SIMULITH_SPI_MAX_CS - 1)
+     * @param size Number of registers
+     * @param ops Register operations, copied; NULL to detach the device
+     * @param ctx Context pointer passed to the operations
+     * @return 0 on success, -1 on failure (including a chip select already in use)
+     */
+    int simulith_spi_attach_registers(uint8_t bus_id, uint8_t cs_id, size_t size,
+                                      const simulith_spi_register_ops_t *ops, void *ctx);
+
+    /**
+     * @brief Get notified when a chip select is asserted and released
+     *
+     * Devices that parse commands across segments (see simulith_spi_transact) use this to
+     * know where a transaction starts and ends. Each simulith_spi_transfer is a transaction
+     * of its own.
+     *
+     * @param bus_id Bus identifier
+     * @param cs_id Chip select identifier
+     * @param cs_cb Chip select callback, called with the device context, NULL to remove it
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_spi_set_cs_callback(uint8_t bus_id, uint8_t cs_id, simulith_spi_cs_callback cs_cb);
+
     /**
      * @brief Perform an SPI transfer
      * @param bus_id Bus identifier
-     * @param cs_id Chip select identifier (0-7)
+     * @param cs_id Chip select identifier (0 to SIMULITH_SPI_MAX_CS - 1)
      * @param tx_data Data to transmit (can be NULL for receive-only)
      * @param rx_data Buffer for received data (can be NULL for transmit-only)
-     * @param len Number of bytes to transfer
+     * @param len Number of bytes to transfer, at most INT_MAX
      * @return Number of bytes transferred, -1 on failure
      */
     int simulith_spi_transfer(uint8_t bus_id, uint8_t cs_id, const uint8_t *tx_data, uint8_t *rx_data, size_t len);
 
+    /**
+     * @brief Perform several transfers with the chip select held between them
+     *
+     * Each segment goes to the device as a transfer of its own, straight from and to the
+     * caller's buffers, with the chip select asserted before the first segment and released
+     * after the last. All segments are validated before the chip select is asserted. A
+     * failing segment ends the transaction. The CRC check of simulith_spi_set_crc applies
+     * to the last segment that receives data.
+     *
+     * @param bus_id Bus identifier
+     * @param cs_id Chip select identifier (0 to SIMULITH_SPI_MAX_CS - 1)
+     * @param segments Segments, in bus order, at most INT_MAX bytes in total
+     * @param count Number of segments
+     * @return Total number of bytes transferred, -1 on failure
+     */
+    int simulith_spi_transact(uint8_t bus_id, uint8_t cs_id, const simulith_spi_segment_t *segments, size_t count);
+
+    /**
+     * @brief Perform a long transfer chunk by chunk, with the chip select held
+     *
+     * For each chunk of at most SIMULITH_SPI_STREAM_CHUNK bytes, fill_tx provides the data
+     * to transmit, the chunk goes to the device, and take_rx gets the received data. Only
+     * one chunk is buffered at a time, whatever the length. The CRC check of
+     * simulith_spi_set_crc does not apply.
+     *
+     * @param bus_id Bus identifier
+     * @param cs_id Chip select identifier (0 to SIMULITH_SPI_MAX_CS - 1)
+     * @param len Number of bytes to transfer, at most INT_MAX
+     * @param fill_tx Producer of the data to transmit (can be NULL for receive-only)
+     * @param take_rx Consumer of the received data (can be NULL for transmit-only)
+     * @param ctx Context pointer passed to the callbacks
+     * @return Number of bytes transferred, -1 on failure
+     */
+    int simulith_spi_stream(uint8_t bus_id, uint8_t cs_id, size_t len, simulith_spi_chunk_callback fill_tx,
+                            simulith_spi_chunk_callback take_rx, void *ctx);
+
+    /**
+     * @brief Check a CRC field at the end of the data received from a chip select
+     *
+     * Once set, simulith_spi_transfer fails when the data received from the chip select does
+     * not end with a matching CRC field, so models can trust what they receive without
+     * checking it again. Other devices on the bus are not affected.
+     *
+     * @param bus_id Bus identifier
+     * @param cs_id Chip select identifier (0 to SIMULITH_SPI_MAX_CS - 1)
+     * @param crc SIMULITH_CRC_* type, SIMULITH_CRC_NONE to stop checking
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_spi_set_crc(uint8_t bus_id, uint8_t cs_id, uint8_t crc);
+
     /**
      * @brief Close an SPI bus
      * @param bus_id Bus identifier
@@ -73,6 +275,10 @@ extern "C"
 #define SIMULITH_SPI_CS_ACTIVE_LOW  0
 #define SIMULITH_SPI_CS_ACTIVE_HIGH 1
 
+#define SIMULITH_SPI_MAX_CS       16   /**< Chip selects per bus */
+#define SIMULITH_SPI_STREAM_CHUNK 4096 /**< Largest chunk of a streamed transfer */
+#define SIMULITH_SPI_REG_READ     0x80 /**< Register address flag of reads, see simulith_spi_attach_registers */
+
 #ifdef __cplusplus
 }
 #endif
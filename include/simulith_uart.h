@@ -1,6 +1,7 @@
 #ifndef SIMULITH_UART_H
 #define SIMULITH_UART_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -14,13 +15,45 @@ extern "C"
      */
     typedef struct
     {
-        uint32_t baud_rate;    /**< Baud rate (e.g., 9600, 115200) */
-        uint8_t  data_bits;    /**< Data bits (5-8) */
-        uint8_t  stop_bits;    /**< Stop bits (1-2) */
-        uint8_t  parity;       /**< 0=none, 1=odd, 2=even */
-        uint8_t  flow_control; /**< 0=none, 1=hardware, 2=software */
+        uint32_t baud_rate;      /**< Baud rate (e.g., 9600, 115200) */
+        uint8_t  data_bits;      /**< Data bits (5-8) */
+        uint8_t  stop_bits;      /**< Stop bits (1-2) */
+        uint8_t  parity;         /**< 0=none, 1=odd, 2=even */
+        uint8_t  flow_control;   /**< 0=none, 1=hardware, 2=software */
+        uint32_t rx_buffer_size; /**< Receive buffer size in bytes, a power of two (0 for the default) */
     } simulith_uart_config_t;
 
+    /**
+     * @brief Deframer configuration, see simulith_uart_set_framing
+     */
+    typedef struct
+    {
+        uint8_t  type;        /**< SIMULITH_UART_FRAMING_* */
+        uint16_t max_len;     /**< Longest frame, the length of every frame for ASM (0 for the default) */
+        uint32_t sync_marker; /**< Attached sync marker for ASM (0 for the CCSDS marker) */
+        uint16_t idle_chars;  /**< Character times without data that end a partial frame (0 for the default) */
+        uint8_t  crc;         /**< SIMULITH_CRC_* field at the end of each frame, checked on delivery */
+    } simulith_uart_framing_t;
+
+    /**
+     * @brief UART statistics, see simulith_uart_set_pacing and simulith_uart_set_framing
+     */
+    typedef struct
+    {
+        bool     pacing;              /**< Pacing is enabled */
+        uint64_t char_time_ns;        /**< Time to send one character, rounded up */
+        uint64_t tx_bytes;            /**< Bytes delivered since pacing was enabled */
+        uint64_t tx_dropped;          /**< Bytes lost because the backlog was full */
+        size_t   tx_backlog;          /**< Bytes waiting to be sent */
+        size_t   tx_backlog_max;      /**< Largest backlog seen */
+        double   last_tx_bytes_per_s; /**< Throughput over the last simulith_uart_advance interval */
+        double   last_utilization;    /**< Fraction of the last interval the line was busy */
+        uint64_t rx_frames;           /**< Frames delivered since framing was set */
+        uint64_t rx_frames_dropped;   /**< Oversized, aborted and partial frames */
+        uint64_t rx_crc_errors;       /**< Frames dropped because their CRC field did not match */
+        uint64_t rx_unaddressed;      /**< Frames no endpoint matched, see simulith_uart_attach */
+    } simulith_uart_stats_t;
+
     /**
      * @brief Callback function type for UART receive operations
      * @param port_id Port identifier
@@ -39,15 +72,66 @@ extern "C"
      */
     int simulith_uart_init(uint8_t port_id, const simulith_uart_config_t *config, simulith_uart_rx_callback rx_cb);
 
+    /**
+     * @brief Replace the receive callback of a UART port
+     * @param port_id Port identifier
+     * @param rx_cb New callback (NULL to loop sent data back into the receive buffer)
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_uart_set_callback(uint8_t port_id, simulith_uart_rx_callback rx_cb);
+
+    /**
+     * @brief Attach an endpoint to a multi-drop (RS-485) port
+     *
+     * Once a port has endpoints, each frame sent on it goes only to the endpoints whose
+     * address matches the frame's first byte in the bits of their mask, instead of to the
+     * receive callback or the receive buffer. SIMULITH_UART_ADDRESS_BROADCAST reaches every
+     * endpoint, and a mask of 0 receives all traffic. Without framing (see
+     * simulith_uart_set_framing), each chunk of sent data counts as a frame. Endpoints reply
+     * with simulith_uart_inject.
+     *
+     * @param port_id Port identifier
+     * @param address Endpoint address
+     * @param mask Address bits that must match
+     * @param rx_cb Callback receiving the matching frames
+     * @return Endpoint identifier (>= 0) on success, -1 on failure
+     */
+    int simulith_uart_attach(uint8_t port_id, uint8_t address, uint8_t mask, simulith_uart_rx_callback rx_cb);
+
+    /**
+     * @brief Detach an endpoint, see simulith_uart_attach
+     * @param port_id Port identifier
+     * @param endpoint_id Endpoint identifier
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_uart_detach(uint8_t port_id, int endpoint_id);
+
     /**
      * @brief Send data over UART
+     *
+     * The data goes to the receive callback, or without one loops back into the receive buffer.
+     *
      * @param port_id Port identifier
      * @param data Data to send
      * @param len Number of bytes to send
-     * @return Number of bytes sent, -1 on failure
+     * @return Number of bytes sent (the callback result, or the bytes that fit in the receive buffer), -1 on failure
      */
     int simulith_uart_send(uint8_t port_id, const uint8_t *data, size_t len);
 
+    /**
+     * @brief Queue bytes for simulith_uart_receive as if they had arrived on the line
+     *
+     * Several threads may inject concurrently while one thread receives, with
+     * simulith_uart_receive and simulith_uart_available. Bytes that do not fit in the receive
+     * buffer are dropped, as on a UART with a full FIFO.
+     *
+     * @param port_id Port identifier
+     * @param data Data to queue
+     * @param len Number of bytes to queue
+     * @return Number of bytes queued, -1 on failure
+     */
+    int simulith_uart_inject(uint8_t port_id, const uint8_t *data, size_t len);
+
     /**
      * @brief Receive data from UART (non-blocking)
      * @param port_id Port identifier
@@ -59,11 +143,74 @@ extern "C"
 
     /**
      * @brief Check if UART port has data available
+     *
+     * Collects the bytes injected since the last call as simulith_uart_receive does, so only
+     * the thread that receives from the port may call it.
+     *
      * @param port_id Port identifier
      * @return Number of bytes available, -1 on failure
      */
     int simulith_uart_available(uint8_t port_id);
 
+    /**
+     * @brief Enable or disable baud rate pacing of sent data
+     *
+     * With pacing enabled, simulith_uart_send queues data in a backlog the size of the receive
+     * buffer, and simulith_uart_advance delivers only as many characters as the line can carry
+     * in the elapsed sim time. A character takes a start bit, the data bits, the parity bit if
+     * any and the stop bits. Enabling resets the statistics; disabling delivers the backlog.
+     * While pacing is enabled, sends on the port must come from a single thread.
+     *
+     * @param port_id Port identifier
+     * @param enable true to enable pacing
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_uart_set_pacing(uint8_t port_id, bool enable);
+
+    /**
+     * @brief Advance sim time and deliver the characters sent by then
+     *
+     * Intended to be called from the tick callback with the tick time. Also detects an idle
+     * line for the deframer, with or without pacing.
+     *
+     * @param port_id Port identifier
+     * @param now_ns New time in nanoseconds, not earlier than the previous one
+     * @return Number of bytes delivered (0 when pacing is disabled), -1 on failure
+     */
+    int simulith_uart_advance(uint8_t port_id, uint64_t now_ns);
+
+    /**
+     * @brief Deliver whole frames instead of byte chunks
+     *
+     * Sent data goes through a deframer, and the receive callback (or the receive buffer
+     * without one) gets one decoded frame per call:
+     * - SLIP (RFC 1055): frames end with 0xC0, escapes are removed
+     * - HDLC: asynchronous framing with 0x7E flags and 0x7D escapes
+     * - KISS: SLIP byte stuffing, only data frames are delivered, without the type byte
+     * - ASM: the max_len bytes following each attached sync marker
+     *
+     * With a CRC type set, frames whose CRC field does not match are dropped, so models
+     * can trust delivered frames without checking them again. The field stays in the
+     * frame, except for HDLC where it is the FCS (SIMULITH_CRC_CRC16_X25) and is removed
+     * once checked; without a CRC type, HDLC frames keep their FCS. Empty frames are
+     * skipped; oversized and aborted frames are dropped. When simulith_uart_advance finds
+     * the line idle for idle_chars character times, a partial frame is dropped. Data passed
+     * to simulith_uart_inject is not deframed.
+     *
+     * @param port_id Port identifier
+     * @param framing Deframer configuration, NULL to deliver byte chunks again
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_uart_set_framing(uint8_t port_id, const simulith_uart_framing_t *framing);
+
+    /**
+     * @brief Get the statistics of a port
+     * @param port_id Port identifier
+     * @param stats Buffer to store the statistics
+     * @return 0 on success, -1 on failure
+     */
+    int simulith_uart_get_stats(uint8_t port_id, simulith_uart_stats_t *stats);
+
     /**
      * @brief Close a UART port
      * @param port_id Port identifier
@@ -80,6 +227,23 @@ extern "C"
 #define SIMULITH_UART_FLOW_HARDWARE 1
 #define SIMULITH_UART_FLOW_SOFTWARE 2
 
+#define SIMULITH_UART_FRAMING_NONE 0
+#define SIMULITH_UART_FRAMING_SLIP 1
+#define SIMULITH_UART_FRAMING_HDLC 2
+#define SIMULITH_UART_FRAMING_KISS 3
+#define SIMULITH_UART_FRAMING_ASM  4
+
+#define SIMULITH_UART_FRAME_DEFAULT      1024
+#define SIMULITH_UART_IDLE_CHARS_DEFAULT 2
+#define SIMULITH_UART_CCSDS_ASM          0x1ACFFC1DU
+
+#define SIMULITH_UART_MAX_ENDPOINTS     32
+#define SIMULITH_UART_ADDRESS_BROADCAST 0xFF
+
+#define SIMULITH_UART_RX_BUFFER_DEFAULT 1024
+#define SIMULITH_UART_RX_BUFFER_MIN     16
+#define SIMULITH_UART_RX_BUFFER_MAX     (16 * 1024 * 1024)
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,220 +1,1335 @@
 #include "simulith_can.h"
 #include "simulith.h"
+#include <stdatomic.h>
 #include <string.h>
 
-#define MAX_CAN_BUSES 8
-#define MAX_FILTERS   16
+#define MAX_CAN_BUSES     8
+#define MAX_FILTERS       16
+#define NODE_QUEUE_SIZE   32 // Frame references per node queue, must be a power of two
+#define NODE_QUEUE_MASK   (NODE_QUEUE_SIZE - 1)
+#define PENDING_SIZE      64 // Frames waiting for arbitration per bus when timing is enabled
+#define SENDING_FRAMES    64 // Frames held by threads in the middle of a send
+#define CLASSIC_POOL_SIZE POOL_SIZE
+#define FD_POOL_SIZE      POOL_SIZE
 
+// Frame slots per pool and bus: both queues of every node full, the transmit queue, the frame on
+// the wire and the sends in progress. Nodes that never receive cannot run the pool dry.
+#define POOL_SIZE (SIMULITH_CAN_MAX_NODES * 2 * NODE_QUEUE_SIZE + PENDING_SIZE + 1 + SENDING_FRAMES)
+
+#define FRAME_REF_FD   0x8000 // Set in frame references that index the FD pool
+#define FRAME_REF_NONE 0xFFFF
+
+#define FREE_LIST_INDEX 0xFFFF  // Free list head: index of the first free slot
+#define FREE_LIST_TAG   0x10000 // and a counter in the upper bits against ABA on pop
+
+#define FRAME_FLAG_EXT 0x80 // Extended ID bit for log_frame, shares the byte with SIMULITH_CAN_FLAG_*
+
+// Bits after the CRC sequence: CRC delimiter, ACK slot, ACK delimiter, end of frame, intermission
+#define FRAME_TAIL_BITS 13
+#define CRC15_POLY      0x4599
+
+typedef struct
+{
+    simulith_can_filter_t        filter;
+    bool                         active;
+    simulith_can_filter_callback callback;
+    void                        *ctx;
+} filter_slot_t;
+
+typedef struct
+{
+    uint16_t       ref;
+    _Atomic size_t seq; // Equals the position when the cell is free, position + 1 once filled
+} ref_cell_t;
+
+// Bounded multi-producer queue of frame references, any thread may push while the node's
+// receiver pops. Producers claim a position with a CAS on head and publish the cell through
+// its sequence number, so a preempted producer never blocks the others.
+typedef struct
+{
+    ref_cell_t     cells[NODE_QUEUE_SIZE];
+    _Atomic size_t head; // Free-running positions, masked on access
+    size_t         tail; // Only touched by the consumer
+} ref_queue_t;
+
+// A frame put on the bus is copied once into a refcounted slot and every node that accepts it
+// queues a 16-bit reference. Classic and FD frames have separate pools so classic frames do not
+// reserve 64-byte payloads. Free slots form lock-free lists linked through the next arrays.
 typedef struct
 {
-    simulith_can_filter_t filter;
-    bool                  active;
-} filter_slot_t;
+    simulith_can_message_t    classic[CLASSIC_POOL_SIZE];
+    simulith_can_fd_message_t fd[FD_POOL_SIZE];
+    _Atomic uint16_t          classic_refcount[CLASSIC_POOL_SIZE];
+    _Atomic uint16_t          fd_refcount[FD_POOL_SIZE];
+    _Atomic uint16_t          classic_next[CLASSIC_POOL_SIZE];
+    _Atomic uint16_t          fd_next[FD_POOL_SIZE];
+    _Atomic uint32_t          classic_free; // See FREE_LIST_INDEX
+    _Atomic uint32_t          fd_free;
+} frame_pool_t;
+
+typedef struct
+{
+    bool                         active;
+    simulith_can_rx_callback     rx_callback;
+    simulith_can_dispatch_mode_t dispatch_mode;
+    filter_slot_t                filters[MAX_FILTERS];
+    ref_queue_t                  rx_queue;       // Frames waiting for simulith_can_receive
+    ref_queue_t                  deferred_queue; // Frames waiting for simulith_can_dispatch
+    _Atomic uint64_t             dropped;        // Frames lost to a full queue
+} can_node_t;
+
+// A frame waiting for, or holding, the bus when timing is enabled
+typedef struct
+{
+    uint16_t ref;
+    int      sender;
+    uint64_t key;         // Arbitration field value, lower wins
+    uint64_t ready_ns;    // Bus time when the frame was sent
+    uint64_t duration_ns; // Time the frame holds the bus
+    uint64_t start_ns;    // Bus time when it won arbitration
+} pending_frame_t;
+
+typedef struct
+{
+    bool                  initialized;
+    uint32_t              generation; // Incremented by each simulith_can_init
+    simulith_can_config_t config;
+    can_node_t            nodes[SIMULITH_CAN_MAX_NODES];
+    frame_pool_t          pool;
+
+    // Bit timing model, see simulith_can_set_timing
+    bool            timing;
+    uint64_t        time_ns;
+    uint64_t        busy_ns;
+    uint64_t        frames;
+    uint64_t        max_latency_ns;
+    double          last_utilization;
+    pending_frame_t pending[PENDING_SIZE];
+    size_t          pending_count;
+    pending_frame_t tx; // Frame currently on the wire
+    bool            tx_active;
+} can_bus_t;
+
+static can_bus_t can_buses[MAX_CAN_BUSES] = {0};
+
+static bool is_valid_id(uint32_t id, uint8_t is_extended)
+{
+    return id <= (is_extended ? SIMULITH_CAN_ID_EXT_MAX : SIMULITH_CAN_ID_STD_MAX);
+}
+
+static bool is_valid_config(const simulith_can_config_t *config)
+{
+    if (!config)
+        return false;
+
+    // Validate bitrate (125kbps to 1Mbps)
+    if (config->bitrate < SIMULITH_CAN_BITRATE_125K || config->bitrate > SIMULITH_CAN_BITRATE_1M)
+        return false;
+
+    // Validate sample point (50-90%)
+    if (config->sample_point < 50 || config->sample_point > 90)
+        return false;
+
+    // Validate sync jump width (1-4)
+    if (config->sync_jump < 1 || config->sync_jump > 4)
+        return false;
+
+    // Validate CAN FD data phase bitrate (disabled, or nominal bitrate to 8Mbps)
+    if (config->data_bitrate != 0 &&
+        (config->data_bitrate < config->bitrate || config->data_bitrate > SIMULITH_CAN_FD_BITRATE_MAX))
+        return false;
+
+    return true;
+}
+
+static bool is_valid_message(const simulith_can_message_t *msg)
+{
+    if (!msg)
+        return false;
+
+    // Validate ID based on type
+    if (!is_valid_id(msg->id, msg->is_extended))
+        return false;
+
+    // Validate DLC
+    if (msg->dlc > SIMULITH_CAN_MAX_DLC)
+        return false;
+
+    return true;
+}
+
+static bool is_valid_fd_len(uint8_t len)
+{
+    switch (len)
+    {
+        case 12:
+        case 16:
+        case 20:
+        case 24:
+        case 32:
+        case 48:
+        case 64:
+            return true;
+        default:
+            return len <= SIMULITH_CAN_MAX_DLC;
+    }
+}
+
+static bool is_valid_fd_message(const can_bus_t *bus, const simulith_can_fd_message_t *msg)
+{
+    if (!msg)
+        return false;
+
+    if (!is_valid_id(msg->id, msg->is_extended))
+        return false;
+
+    if (!is_valid_fd_len(msg->len))
+        return false;
+
+    // FD frames have no remote form, and bit-rate switching needs a data phase bitrate
+    if (msg->flags & ~(SIMULITH_CAN_FLAG_FDF | SIMULITH_CAN_FLAG_BRS | SIMULITH_CAN_FLAG_ESI))
+        return false;
+    if ((msg->flags & SIMULITH_CAN_FLAG_BRS) && bus->config.data_bitrate == 0)
+        return false;
+
+    return true;
+}
+
+static bool message_passes_filter(uint32_t id, uint8_t is_extended, const simulith_can_filter_t *filter)
+{
+    if (is_extended != filter->is_extended)
+        return false;
+    return ((id & filter->mask) == (filter->id & filter->mask));
+}
+
+static void log_frame(const char *dir, uint8_t bus_id, uint32_t id, uint8_t flags, uint8_t len, const uint8_t *data)
+{
+    simulith_log("CAN%d %s: ID=0x%x [%d] %s%s%s%s", bus_id, dir, id, len, (flags & FRAME_FLAG_EXT) ? "EXT " : "STD ",
+                 (flags & SIMULITH_CAN_FLAG_FDF) ? "FD " : "", (flags & SIMULITH_CAN_FLAG_BRS) ? "BRS " : "",
+                 (flags & SIMULITH_CAN_FLAG_RTR) ? "RTR " : "");
+
+    if (!(flags & SIMULITH_CAN_FLAG_RTR))
+    {
+        for (int i = 0; i < len; i++)
+        {
+            simulith_log("%02X ", data[i]);
+        }
+    }
+    simulith_log("\n");
+}
+
+static void log_classic(const char *dir, uint8_t bus_id, const simulith_can_message_t *msg)
+{
+    uint8_t flags = (msg->is_extended ? FRAME_FLAG_EXT : 0) | (msg->is_rtr ? SIMULITH_CAN_FLAG_RTR : 0);
+    log_frame(dir, bus_id, msg->id, flags, msg->dlc, msg->data);
+}
+
+static void log_fd(const char *dir, uint8_t bus_id, const simulith_can_fd_message_t *msg)
+{
+    log_frame(dir, bus_id, msg->id, msg->flags | (msg->is_extended ? FRAME_FLAG_EXT : 0), msg->len, msg->data);
+}
+
+static void free_list_reset(_Atomic uint32_t *head, _Atomic uint16_t *next, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        atomic_init(&next[i], (i + 1 < size) ? (uint16_t)(i + 1) : FRAME_REF_NONE);
+    }
+    atomic_init(head, 0);
+}
+
+static uint16_t free_list_pop(_Atomic uint32_t *head, _Atomic uint16_t *next)
+{
+    uint32_t old = atomic_load_explicit(head, memory_order_acquire);
+    uint32_t new;
+
+    do
+    {
+        uint16_t index = old & FREE_LIST_INDEX;
+        if (index == FRAME_REF_NONE)
+            return FRAME_REF_NONE;
+        new = ((old + FREE_LIST_TAG) & ~FREE_LIST_INDEX) | atomic_load_explicit(&next[index], memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(head, &old, new, memory_order_acquire, memory_order_acquire));
+
+    return old & FREE_LIST_INDEX;
+}
+
+static void free_list_push(_Atomic uint32_t *head, _Atomic uint16_t *next, uint16_t index)
+{
+    uint32_t old = atomic_load_explicit(head, memory_order_relaxed);
+
+    do
+    {
+        atomic_store_explicit(&next[index], old & FREE_LIST_INDEX, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(head, &old, ((old + FREE_LIST_TAG) & ~FREE_LIST_INDEX) | index,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+static void pool_reset(frame_pool_t *pool)
+{
+    for (size_t i = 0; i < CLASSIC_POOL_SIZE; i++)
+    {
+        atomic_init(&pool->classic_refcount[i], 0);
+    }
+    for (size_t i = 0; i < FD_POOL_SIZE; i++)
+    {
+        atomic_init(&pool->fd_refcount[i], 0);
+    }
+    free_list_reset(&pool->classic_free, pool->classic_next, CLASSIC_POOL_SIZE);
+    free_list_reset(&pool->fd_free, pool->fd_next, FD_POOL_SIZE);
+}
+
+// Take a free slot with a reference count of one, FRAME_REF_NONE if the pool is exhausted
+static uint16_t frame_alloc(frame_pool_t *pool, bool is_fd)
+{
+    uint16_t ref;
+
+    if (is_fd)
+    {
+        ref = free_list_pop(&pool->fd_free, pool->fd_next);
+        if (ref == FRAME_REF_NONE)
+            return FRAME_REF_NONE;
+        atomic_store_explicit(&pool->fd_refcount[ref], 1, memory_order_relaxed);
+        return ref | FRAME_REF_FD;
+    }
+
+    ref = free_list_pop(&pool->classic_free, pool->classic_next);
+    if (ref == FRAME_REF_NONE)
+        return FRAME_REF_NONE;
+    atomic_store_explicit(&pool->classic_refcount[ref], 1, memory_order_relaxed);
+    return ref;
+}
+
+static _Atomic uint16_t *frame_refcount(frame_pool_t *pool, uint16_t ref)
+{
+    uint16_t index = ref & ~FRAME_REF_FD;
+    return (ref & FRAME_REF_FD) ? &pool->fd_refcount[index] : &pool->classic_refcount[index];
+}
+
+// Only called by holders of a reference, so the count cannot drop to zero meanwhile
+static void frame_retain(frame_pool_t *pool, uint16_t ref)
+{
+    atomic_fetch_add_explicit(frame_refcount(pool, ref), 1, memory_order_relaxed);
+}
+
+static void frame_release(frame_pool_t *pool, uint16_t ref)
+{
+    uint16_t index = ref & ~FRAME_REF_FD;
+
+    if (atomic_fetch_sub_explicit(frame_refcount(pool, ref), 1, memory_order_acq_rel) > 1)
+        return;
+
+    if (ref & FRAME_REF_FD)
+        free_list_push(&pool->fd_free, pool->fd_next, index);
+    else
+        free_list_push(&pool->classic_free, pool->classic_next, index);
+}
+
+static const simulith_can_message_t *frame_classic(const frame_pool_t *pool, uint16_t ref)
+{
+    return (ref & FRAME_REF_FD) ? NULL : &pool->classic[ref];
+}
+
+static const simulith_can_fd_message_t *frame_fd(const frame_pool_t *pool, uint16_t ref)
+{
+    return (ref & FRAME_REF_FD) ? &pool->fd[ref & ~FRAME_REF_FD] : NULL;
+}
+
+// Copy a frame of either kind into the FD message layout
+static void frame_to_fd(const frame_pool_t *pool, uint16_t ref, simulith_can_fd_message_t *msg)
+{
+    const simulith_can_message_t *classic = frame_classic(pool, ref);
+
+    if (!classic)
+    {
+        memcpy(msg, frame_fd(pool, ref), sizeof(*msg));
+        return;
+    }
+
+    memset(msg, 0, sizeof(*msg));
+    msg->id          = classic->id;
+    msg->is_extended = classic->is_extended;
+    msg->flags       = classic->is_rtr ? SIMULITH_CAN_FLAG_RTR : 0;
+    msg->len         = classic->dlc;
+    memcpy(msg->data, classic->data, sizeof(classic->data));
+}
+
+static bool frame_passes_filter(const frame_pool_t *pool, uint16_t ref, const filter_slot_t *slot)
+{
+    const simulith_can_message_t    *classic = frame_classic(pool, ref);
+    const simulith_can_fd_message_t *fd      = frame_fd(pool, ref);
+
+    if (!slot->active)
+        return false;
+    if (classic)
+        return message_passes_filter(classic->id, classic->is_extended, &slot->filter);
+    return message_passes_filter(fd->id, fd->is_extended, &slot->filter);
+}
+
+static void ref_queue_init(ref_queue_t *queue)
+{
+    for (size_t i = 0; i < NODE_QUEUE_SIZE; i++)
+    {
+        atomic_init(&queue->cells[i].seq, i);
+    }
+    atomic_init(&queue->head, 0);
+    queue->tail = 0;
+}
+
+static bool ref_queue_push(ref_queue_t *queue, uint16_t ref)
+{
+    size_t      pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    ref_cell_t *cell;
+
+    while (true)
+    {
+        cell         = &queue->cells[pos & NODE_QUEUE_MASK];
+        size_t   seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+        if (dif == 0)
+        {
+            // The cell is free for this lap, claim it
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        }
+        else if (dif < 0)
+        {
+            // The consumer has not freed the cell yet, the queue is full
+            return false;
+        }
+        else
+        {
+            // Another producer claimed this position
+            pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+
+    cell->ref = ref;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    return true;
+}
+
+static bool ref_queue_peek(ref_queue_t *queue, uint16_t *ref)
+{
+    ref_cell_t *cell = &queue->cells[queue->tail & NODE_QUEUE_MASK];
+
+    if (atomic_load_explicit(&cell->seq, memory_order_acquire) != queue->tail + 1)
+        return false;
+
+    *ref = cell->ref;
+    return true;
+}
+
+// Consume the reference returned by ref_queue_peek, handing the cell back to the producers
+static void ref_queue_pop(ref_queue_t *queue)
+{
+    ref_cell_t *cell = &queue->cells[queue->tail & NODE_QUEUE_MASK];
+
+    atomic_store_explicit(&cell->seq, queue->tail + NODE_QUEUE_SIZE, memory_order_release);
+    queue->tail++;
+}
+
+// Drop every reference still queued, returning the slots to the pool
+static void ref_queue_clear(frame_pool_t *pool, ref_queue_t *queue)
+{
+    uint16_t ref;
+
+    while (ref_queue_peek(queue, &ref))
+    {
+        ref_queue_pop(queue);
+        frame_release(pool, ref);
+    }
+}
+
+static can_node_t *get_node(uint8_t bus_id, int node_id)
+{
+    if (bus_id >= MAX_CAN_BUSES || !can_buses[bus_id].initialized || node_id < 0 || node_id >= SIMULITH_CAN_MAX_NODES)
+    {
+        return NULL;
+    }
+
+    can_node_t *node = &can_buses[bus_id].nodes[node_id];
+    return node->active ? node : NULL;
+}
+
+// Index of the first matching filter that has its own callback, -1 if none
+static int find_filter_callback(const frame_pool_t *pool, const can_node_t *node, uint16_t ref)
+{
+    for (int i = 0; i < MAX_FILTERS; i++)
+    {
+        if (node->filters[i].callback && frame_passes_filter(pool, ref, &node->filters[i]))
+            return i;
+    }
+    return -1;
+}
+
+// A frame is handled by its filter's callback first, then by the node callback (classic frames only)
+static bool has_handler(const frame_pool_t *pool, const can_node_t *node, uint16_t ref)
+{
+    return find_filter_callback(pool, node, ref) >= 0 || (node->rx_callback && !(ref & FRAME_REF_FD));
+}
+
+// Callbacks read the frame straight out of its pool slot, only classic frames
+// going to a filter callback are converted to the FD layout
+static bool dispatch_frame(uint8_t bus_id, can_bus_t *bus, can_node_t *node, uint16_t ref)
+{
+    int result;
+    int filter_id = find_filter_callback(&bus->pool, node, ref);
+
+    if (filter_id >= 0)
+    {
+        simulith_can_fd_message_t        converted;
+        const simulith_can_fd_message_t *msg = frame_fd(&bus->pool, ref);
+        if (!msg)
+        {
+            frame_to_fd(&bus->pool, ref, &converted);
+            msg = &converted;
+        }
+        result = node->filters[filter_id].callback(bus_id, msg, node->filters[filter_id].ctx);
+    }
+    else if (node->rx_callback && !(ref & FRAME_REF_FD))
+    {
+        result = node->rx_callback(bus_id, frame_classic(&bus->pool, ref));
+    }
+    else
+    {
+        return false;
+    }
+
+    if (result < 0)
+    {
+        simulith_log("CAN%d RX callback failed\n", bus_id);
+    }
+    return true;
+}
+
+// Hand a frame that has been put on the bus to one node: dispatch it to a callback
+// according to the node dispatch mode, or queue a reference for simulith_can_receive
+static void deliver_frame(uint8_t bus_id, can_bus_t *bus, can_node_t *node, uint16_t ref)
+{
+    // Accept everything when there is a node callback, otherwise only frames matching a filter
+    bool accepted = node->rx_callback != NULL;
+    for (int i = 0; !accepted && i < MAX_FILTERS; i++)
+    {
+        accepted = frame_passes_filter(&bus->pool, ref, &node->filters[i]);
+    }
+    if (!accepted)
+        return;
+
+    ref_queue_t *queue = &node->rx_queue;
+    switch (node->dispatch_mode)
+    {
+        case SIMULITH_CAN_DISPATCH_IMMEDIATE:
+            if (dispatch_frame(bus_id, bus, node, ref))
+                return;
+            break;
+        case SIMULITH_CAN_DISPATCH_DEFERRED:
+            if (has_handler(&bus->pool, node, ref))
+                queue = &node->deferred_queue;
+            break;
+        default:
+            break;
+    }
+
+    // Take the node's reference first, the receiver may release it as soon as it is queued
+    frame_retain(&bus->pool, ref);
+    if (!ref_queue_push(queue, ref))
+    {
+        simulith_log("CAN%d node queue full, dropped frame\n", bus_id);
+        atomic_fetch_add_explicit(&node->dropped, 1, memory_order_relaxed);
+        frame_release(&bus->pool, ref);
+    }
+}
+
+// Fan a frame out to every node on the bus. The sender's reference from frame_alloc
+// keeps the slot alive until all nodes have taken their own.
+static void transmit_frame(uint8_t bus_id, can_bus_t *bus, int sender, uint16_t ref)
+{
+    for (int i = 0; i < SIMULITH_CAN_MAX_NODES; i++)
+    {
+        // Node 0 keeps the original single-endpoint loopback, attached nodes never hear themselves
+        if (!bus->nodes[i].active || (i == sender && i != 0))
+            continue;
+        deliver_frame(bus_id, bus, &bus->nodes[i], ref);
+    }
+    frame_release(&bus->pool, ref);
+}
+
+// Running count of the bits of a frame as they go on the wire, with the stuff bits
+// inserted after every five consecutive bits of equal value
+typedef struct
+{
+    uint32_t bits;
+    uint32_t stuff_bits;
+    uint8_t  run;
+    uint8_t  last;
+    uint16_t crc; // CRC-15 of the unstuffed bits, classic frames only
+} bit_stream_t;
+
+static void stream_bits(bit_stream_t *stream, uint32_t value, int count, bool update_crc)
+{
+    for (int i = count - 1; i >= 0; i--)
+    {
+        uint8_t bit = (value >> i) & 1;
+
+        if (update_crc)
+        {
+            bool crc_next = bit ^ ((stream->crc >> 14) & 1);
+            stream->crc   = (stream->crc << 1) & 0x7FFF;
+            if (crc_next)
+                stream->crc ^= CRC15_POLY;
+        }
+
+        stream->bits++;
+        if (stream->run > 0 && bit == stream->last)
+        {
+            stream->run++;
+        }
+        else
+        {
+            stream->last = bit;
+            stream->run  = 1;
+        }
+
+        // The stuff bit has the opposite value and starts the next run
+        if (stream->run == 5)
+        {
+            stream->stuff_bits++;
+            stream->last = !bit;
+            stream->run  = 1;
+        }
+    }
+}
+
+static uint8_t fd_len_to_dlc(uint8_t len)
+{
+    static const uint8_t dlc_codes[] = {9, 10, 11, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15};
+    return len <= SIMULITH_CAN_MAX_DLC ? len : dlc_codes[(len - 9) / 4];
+}
+
+// Arbitration field as a number, so that the numerically lower frame is the one that wins
+// bitwise arbitration. Standard frames beat extended frames with the same base ID.
+static uint64_t arbitration_key(const simulith_can_fd_message_t *msg)
+{
+    uint64_t rtr = (msg->flags & SIMULITH_CAN_FLAG_RTR) ? 1 : 0;
+
+    if (!msg->is_extended)
+        return ((uint64_t)msg->id << 21) | (rtr << 20);
+    return ((uint64_t)(msg->id >> 18) << 21) | (1ULL << 20) | (1ULL << 19) | ((uint64_t)(msg->id & 0x3FFFF) << 1) | rtr;
+}
+
+// Count the bits of a frame sent at the nominal and at the data phase bitrate
+static void frame_bit_counts(const simulith_can_fd_message_t *msg, uint32_t *nominal_bits, uint32_t *data_bits)
+{
+    bit_stream_t stream = {0};
+    bool         fd     = (msg->flags & SIMULITH_CAN_FLAG_FDF) != 0;
+    bool         rtr    = (msg->flags & SIMULITH_CAN_FLAG_RTR) != 0;
+    uint32_t     arbitration_bits;
+
+    // Start of frame and arbitration field, RTR is the RRS bit in FD frames
+    stream_bits(&stream, 0, 1, !fd);
+    if (msg->is_extended)
+    {
+        stream_bits(&stream, msg->id >> 18, 11, !fd);
+        stream_bits(&stream, 3, 2, !fd); // SRR, IDE
+        stream_bits(&stream, msg->id & 0x3FFFF, 18, !fd);
+        stream_bits(&stream, rtr, 1, !fd);
+    }
+    else
+    {
+        stream_bits(&stream, msg->id, 11, !fd);
+        stream_bits(&stream, rtr, 1, !fd);
+        stream_bits(&stream, 0, 1, !fd); // IDE
+    }
+
+    if (!fd)
+    {
+        // r0 (plus r1 for extended frames, which is already the RTR position), DLC, data, CRC
+        stream_bits(&stream, 0, msg->is_extended ? 2 : 1, true);
+        stream_bits(&stream, msg->len, 4, true);
+        for (int i = 0; !rtr && i < msg->len; i++)
+        {
+            stream_bits(&stream, msg->data[i], 8, true);
+        }
+        stream_bits(&stream, stream.crc, 15, false);
+
+        *nominal_bits = stream.bits + stream.stuff_bits + FRAME_TAIL_BITS;
+        *data_bits    = 0;
+        return;
+    }
+
+    // FDF, res, BRS: the data phase starts after BRS
+    stream_bits(&stream, (1 << 2) | ((msg->flags & SIMULITH_CAN_FLAG_BRS) ? 1 : 0), 3, false);
+    arbitration_bits = stream.bits + stream.stuff_bits;
+
+    stream_bits(&stream, (msg->flags & SIMULITH_CAN_FLAG_ESI) ? 1 : 0, 1, false);
+    stream_bits(&stream, fd_len_to_dlc(msg->len), 4, false);
+    for (int i = 0; i < msg->len; i++)
+    {
+        stream_bits(&stream, msg->data[i], 8, false);
+    }
+
+    // The stuff count and CRC use fixed stuff bits, one before the stuff count and one every
+    // four bits after it: 4 + 17 + 6 bits for up to 16 data bytes, 4 + 21 + 7 above
+    uint32_t crc_field = (msg->len <= 16) ? 27 : 32;
+    uint32_t data_phase = stream.bits + stream.stuff_bits - arbitration_bits + crc_field;
+
+    if (msg->flags & SIMULITH_CAN_FLAG_BRS)
+    {
+        *nominal_bits = arbitration_bits + FRAME_TAIL_BITS;
+        *data_bits    = data_phase;
+    }
+    else
+    {
+        *nominal_bits = arbitration_bits + data_phase + FRAME_TAIL_BITS;
+        *data_bits    = 0;
+    }
+}
+
+static uint64_t frame_duration_ns(const simulith_can_config_t *config, const simulith_can_fd_message_t *msg)
+{
+    uint32_t nominal_bits, data_bits;
+    frame_bit_counts(msg, &nominal_bits, &data_bits);
+
+    uint64_t duration = (nominal_bits * 1000000000ULL + config->bitrate / 2) / config->bitrate;
+    if (data_bits > 0)
+    {
+        duration += (data_bits * 1000000000ULL + config->data_bitrate / 2) / config->data_bitrate;
+    }
+    return duration;
+}
+
+// Put a frame on the bus now, or queue it for arbitration when timing is enabled.
+// Takes over the reference returned by frame_alloc.
+static int submit_frame(uint8_t bus_id, can_bus_t *bus, int sender, uint16_t ref)
+{
+    if (!bus->timing)
+    {
+        transmit_frame(bus_id, bus, sender, ref);
+        return 0;
+    }
+
+    if (bus->pending_count == PENDING_SIZE)
+    {
+        simulith_log("CAN%d TX queue full\n", bus_id);
+        frame_release(&bus->pool, ref);
+        return -1;
+    }
+
+    simulith_can_fd_message_t msg;
+    frame_to_fd(&bus->pool, ref, &msg);
+
+    pending_frame_t *entry = &bus->pending[bus->pending_count++];
+    entry->ref             = ref;
+    entry->sender          = sender;
+    entry->key             = arbitration_key(&msg);
+    entry->ready_ns        = bus->time_ns;
+    entry->duration_ns     = frame_duration_ns(&bus->config, &msg);
+    return 0;
+}
+
+// Remove and return the pending frame that wins arbitration
+static bool arbitrate(can_bus_t *bus, pending_frame_t *winner)
+{
+    if (bus->pending_count == 0)
+        return false;
+
+    size_t best = 0;
+    for (size_t i = 1; i < bus->pending_count; i++)
+    {
+        // Equal keys keep send order
+        if (bus->pending[i].key < bus->pending[best].key)
+            best = i;
+    }
+
+    *winner = bus->pending[best];
+    memmove(&bus->pending[best], &bus->pending[best + 1], (bus->pending_count - best - 1) * sizeof(pending_frame_t));
+    bus->pending_count--;
+    return true;
+}
+
+static void flush_pending(uint8_t bus_id, can_bus_t *bus)
+{
+    pending_frame_t entry;
+
+    if (bus->tx_active)
+    {
+        bus->tx_active = false;
+        transmit_frame(bus_id, bus, bus->tx.sender, bus->tx.ref);
+    }
+    while (arbitrate(bus, &entry))
+    {
+        transmit_frame(bus_id, bus, entry.sender, entry.ref);
+    }
+}
+
+static void reset_node(can_node_t *node, simulith_can_rx_callback rx_cb)
+{
+    memset(node, 0, sizeof(*node));
+    ref_queue_init(&node->rx_queue);
+    ref_queue_init(&node->deferred_queue);
+    node->rx_callback   = rx_cb;
+    node->dispatch_mode = SIMULITH_CAN_DISPATCH_POLL;
+    node->active        = true;
+}
+
+int simulith_can_init(uint8_t bus_id, const simulith_can_config_t *config, simulith_can_rx_callback rx_cb)
+{
+    if (bus_id >= MAX_CAN_BUSES)
+    {
+        simulith_log("Invalid CAN bus ID: %d\n", bus_id);
+        return -1;
+    }
+
+    if (!is_valid_config(config))
+    {
+        simulith_log("Invalid CAN configuration for bus %d\n", bus_id);
+        return -1;
+    }
+
+    can_bus_t *bus = &can_buses[bus_id];
+
+    if (bus->initialized)
+    {
+        simulith_log("CAN bus %d already initialized\n", bus_id);
+        return -1;
+    }
+
+    // Initialize bus structure, node 0 is the endpoint owned by the caller
+    memcpy(&bus->config, config, sizeof(simulith_can_config_t));
+    memset(bus->nodes, 0, sizeof(bus->nodes));
+    reset_node(&bus->nodes[0], rx_cb);
+    pool_reset(&bus->pool);
+    bus->timing        = false;
+    bus->tx_active     = false;
+    bus->pending_count = 0;
+    bus->generation++;
+    bus->initialized = true;
+
+    simulith_log("CAN bus %d initialized: %lu bps, sample point %d%%, SJW %d\n", bus_id, (unsigned long)config->bitrate,
+                 config->sample_point, config->sync_jump);
+    if (config->data_bitrate)
+    {
+        simulith_log("CAN bus %d FD data phase: %lu bps\n", bus_id, (unsigned long)config->data_bitrate);
+    }
+
+    return 0;
+}
+
+int simulith_can_attach(uint8_t bus_id, simulith_can_rx_callback rx_cb)
+{
+    if (bus_id >= MAX_CAN_BUSES || !can_buses[bus_id].initialized)
+    {
+        return -1;
+    }
+
+    can_bus_t *bus = &can_buses[bus_id];
+
+    for (int i = 1; i < SIMULITH_CAN_MAX_NODES; i++)
+    {
+        if (!bus->nodes[i].active)
+        {
+            reset_node(&bus->nodes[i], rx_cb);
+            simulith_log("Attached node %d to CAN%d\n", i, bus_id);
+            return i;
+        }
+    }
+
+    simulith_log("No free node slots on CAN%d\n", bus_id);
+    return -1;
+}
+
+int simulith_can_detach(uint8_t bus_id, int node_id)
+{
+    can_node_t *node = get_node(bus_id, node_id);
+
+    // Node 0 lives as long as the bus, use simulith_can_close
+    if (!node || node_id == 0)
+    {
+        return -1;
+    }
+
+    ref_queue_clear(&can_buses[bus_id].pool, &node->rx_queue);
+    ref_queue_clear(&can_buses[bus_id].pool, &node->deferred_queue);
+    node->active = false;
+    simulith_log("Detached node %d from CAN%d\n", node_id, bus_id);
+    return 0;
+}
+
+int simulith_can_add_filter(uint8_t bus_id, const simulith_can_filter_t *filter)
+{
+    return simulith_can_node_add_filter(bus_id, 0, filter, NULL, NULL);
+}
+
+int simulith_can_add_filter_callback(uint8_t bus_id, const simulith_can_filter_t *filter,
+                                     simulith_can_filter_callback callback, void *ctx)
+{
+    return simulith_can_node_add_filter(bus_id, 0, filter, callback, ctx);
+}
+
+int simulith_can_node_add_filter(uint8_t bus_id, int node_id, const simulith_can_filter_t *filter,
+                                 simulith_can_filter_callback callback, void *ctx)
+{
+    can_node_t *node = get_node(bus_id, node_id);
 
-typedef struct
+    if (!node || !filter)
+    {
+        return -1;
+    }
+
+    // Find free filter slot
+    for (int i = 0; i < MAX_FILTERS; i++)
+    {
+        if (!node->filters[i].active)
+        {
+            memcpy(&node->filters[i].filter, filter, sizeof(simulith_can_filter_t));
+            node->filters[i].callback = callback;
+            node->filters[i].ctx      = ctx;
+            node->filters[i].active   = true;
+            simulith_log("Added filter %d to CAN%d node %d: ID=0x%x, mask=0x%x, %s%s\n", i, bus_id, node_id,
+                         filter->id, filter->mask, filter->is_extended ? "extended" : "standard",
+                         callback ? ", with callback" : "");
+            return i;
+        }
+    }
+
+    simulith_log("No free filter slots on CAN%d node %d\n", bus_id, node_id);
+    return -1;
+}
+
+int simulith_can_remove_filter(uint8_t bus_id, int filter_id)
 {
-    bool                     initialized;
-    simulith_can_config_t    config;
-    simulith_can_rx_callback rx_callback;
-    filter_slot_t            filters[MAX_FILTERS];
-    simulith_can_message_t   rx_buffer[32]; // Simple circular buffer for received messages
-    size_t                   rx_head;
-    size_t                   rx_tail;
-} can_bus_t;
+    return simulith_can_node_remove_filter(bus_id, 0, filter_id);
+}
 
-static can_bus_t can_buses[MAX_CAN_BUSES] = {0};
+int simulith_can_node_remove_filter(uint8_t bus_id, int node_id, int filter_id)
+{
+    can_node_t *node = get_node(bus_id, node_id);
 
-static bool is_valid_config(const simulith_can_config_t *config)
+    if (!node || filter_id < 0 || filter_id >= MAX_FILTERS)
+    {
+        return -1;
+    }
+
+    if (!node->filters[filter_id].active)
+    {
+        return -1;
+    }
+
+    node->filters[filter_id].active   = false;
+    node->filters[filter_id].callback = NULL;
+    simulith_log("Removed filter %d from CAN%d node %d\n", filter_id, bus_id, node_id);
+    return 0;
+}
+
+static int send_classic(uint8_t bus_id, int node_id, const simulith_can_message_t *msg)
 {
-    if (!config)
-        return false;
+    can_bus_t *bus = &can_buses[bus_id];
+    uint16_t   ref = frame_alloc(&bus->pool, false);
 
-    // Validate bitrate (125kbps to 1Mbps)
-    if (config->bitrate < SIMULITH_CAN_BITRATE_125K || config->bitrate > SIMULITH_CAN_BITRATE_1M)
-        return false;
+    if (ref == FRAME_REF_NONE)
+    {
+        simulith_log("CAN%d frame pool exhausted, dropped ID=0x%x\n", bus_id, msg->id);
+        return -1;
+    }
 
-    // Validate sample point (50-90%)
-    if (config->sample_point < 50 || config->sample_point > 90)
-        return false;
+    // The only copy of the frame, every receiving node references this slot
+    memcpy(&bus->pool.classic[ref], msg, sizeof(*msg));
+    return submit_frame(bus_id, bus, node_id, ref);
+}
 
-    // Validate sync jump width (1-4)
-    if (config->sync_jump < 1 || config->sync_jump > 4)
-        return false;
+static int send_fd(uint8_t bus_id, int node_id, const simulith_can_fd_message_t *msg)
+{
+    can_bus_t *bus = &can_buses[bus_id];
 
-    return true;
+    if (bus->config.data_bitrate == 0)
+    {
+        simulith_log("CAN%d is not configured for CAN FD\n", bus_id);
+        return -1;
+    }
+
+    if (!is_valid_fd_message(bus, msg))
+    {
+        simulith_log("Invalid CAN FD message\n");
+        return -1;
+    }
+
+    log_fd("TX", bus_id, msg);
+
+    uint16_t ref = frame_alloc(&bus->pool, true);
+    if (ref == FRAME_REF_NONE)
+    {
+        simulith_log("CAN%d frame pool exhausted, dropped ID=0x%x\n", bus_id, msg->id);
+        return -1;
+    }
+
+    simulith_can_fd_message_t *slot = &bus->pool.fd[ref & ~FRAME_REF_FD];
+    memcpy(slot, msg, sizeof(*msg));
+    slot->flags |= SIMULITH_CAN_FLAG_FDF;
+    return submit_frame(bus_id, bus, node_id, ref);
 }
 
-static bool is_valid_message(const simulith_can_message_t *msg)
+int simulith_can_send(uint8_t bus_id, const simulith_can_message_t *msg)
 {
-    if (!msg)
-        return false;
+    if (!get_node(bus_id, 0))
+    {
+        return -1;
+    }
 
-    // Validate ID based on type
-    if (msg->is_extended)
+    if (!is_valid_message(msg))
     {
-        if (msg->id > SIMULITH_CAN_ID_EXT_MAX)
-            return false;
+        simulith_log("Invalid CAN message\n");
+        return -1;
+    }
+
+    log_classic("TX", bus_id, msg);
+
+    // In simulation, we can directly pass the message to every node on the bus
+    // In real hardware, this would go through the CAN transceiver
+    return send_classic(bus_id, 0, msg);
+}
+
+int simulith_can_send_fd(uint8_t bus_id, const simulith_can_fd_message_t *msg)
+{
+    if (!get_node(bus_id, 0))
+    {
+        return -1;
+    }
+
+    return send_fd(bus_id, 0, msg);
+}
+
+int simulith_can_node_send(uint8_t bus_id, int node_id, const simulith_can_fd_message_t *msg)
+{
+    if (!get_node(bus_id, node_id) || !msg)
+    {
+        return -1;
+    }
+
+    if (msg->flags & SIMULITH_CAN_FLAG_FDF)
+    {
+        return send_fd(bus_id, node_id, msg);
+    }
+
+    // Classic frame described in the FD layout
+    simulith_can_message_t classic = {.id          = msg->id,
+                                      .is_extended = msg->is_extended,
+                                      .is_rtr      = (msg->flags & SIMULITH_CAN_FLAG_RTR) ? 1 : 0,
+                                      .dlc         = msg->len};
+
+    if ((msg->flags & ~SIMULITH_CAN_FLAG_RTR) || !is_valid_message(&classic))
+    {
+        simulith_log("Invalid CAN message\n");
+        return -1;
+    }
+
+    memcpy(classic.data, msg->data, sizeof(classic.data));
+    log_classic("TX", bus_id, &classic);
+    return send_classic(bus_id, node_id, &classic);
+}
+
+// Pop the oldest frame queued for a node. Classic-only callers get -1 and the frame stays
+// queued when it is an FD frame.
+static int pop_frame(can_bus_t *bus, can_node_t *node, simulith_can_message_t *classic,
+                     simulith_can_fd_message_t *fd)
+{
+    uint16_t ref;
+
+    if (!ref_queue_peek(&node->rx_queue, &ref))
+        return 0;
+
+    if (fd)
+    {
+        frame_to_fd(&bus->pool, ref, fd);
+    }
+    else if (ref & FRAME_REF_FD)
+    {
+        return -1;
     }
     else
     {
-        if (msg->id > SIMULITH_CAN_ID_STD_MAX)
-            return false;
+        memcpy(classic, frame_classic(&bus->pool, ref), sizeof(*classic));
     }
 
-    // Validate DLC
-    if (msg->dlc > SIMULITH_CAN_MAX_DLC)
-        return false;
+    ref_queue_pop(&node->rx_queue);
+    frame_release(&bus->pool, ref);
+    return 1;
+}
 
-    return true;
+int simulith_can_receive(uint8_t bus_id, simulith_can_message_t *msg)
+{
+    can_node_t *node = get_node(bus_id, 0);
+
+    if (!node || !msg)
+    {
+        return -1;
+    }
+
+    int result = pop_frame(&can_buses[bus_id], node, msg, NULL);
+
+    if (result < 0)
+    {
+        simulith_log("CAN%d RX: next frame is CAN FD, use simulith_can_receive_fd\n", bus_id);
+        return -1;
+    }
+    if (result == 0)
+    {
+        return 0; // No messages available
+    }
+
+    log_classic("RX", bus_id, msg);
+
+    return 1;
 }
 
-static bool message_passes_filter(const simulith_can_message_t *msg, const simulith_can_filter_t *filter)
+int simulith_can_receive_fd(uint8_t bus_id, simulith_can_fd_message_t *msg)
 {
-    if (msg->is_extended != filter->is_extended)
-        return false;
-    return ((msg->id & filter->mask) == (filter->id & filter->mask));
+    return simulith_can_node_receive(bus_id, 0, msg);
 }
 
-int simulith_can_init(uint8_t bus_id, const simulith_can_config_t *config, simulith_can_rx_callback rx_cb)
+int simulith_can_node_receive(uint8_t bus_id, int node_id, simulith_can_fd_message_t *msg)
 {
-    if (bus_id >= MAX_CAN_BUSES)
+    can_node_t *node = get_node(bus_id, node_id);
+
+    if (!node || !msg)
     {
-        simulith_log("Invalid CAN bus ID: %d\n", bus_id);
         return -1;
     }
 
-    if (!is_valid_config(config))
+    if (pop_frame(&can_buses[bus_id], node, NULL, msg) == 0)
+    {
+        return 0; // No messages available
+    }
+
+    log_fd("RX", bus_id, msg);
+
+    return 1;
+}
+
+int simulith_can_send_batch(uint8_t bus_id, const simulith_can_message_t *msgs, size_t count)
+{
+    if (!get_node(bus_id, 0) || (!msgs && count > 0))
     {
-        simulith_log("Invalid CAN configuration for bus %d\n", bus_id);
         return -1;
     }
 
-    can_bus_t *bus = &can_buses[bus_id];
+    // Reject the whole batch up front so a bad frame never leaves the bus half-written
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!is_valid_message(&msgs[i]))
+        {
+            simulith_log("Invalid CAN message at batch index %lu\n", (unsigned long)i);
+            return -1;
+        }
+    }
 
-    if (bus->initialized)
+    simulith_log("CAN%d TX batch: %lu frames\n", bus_id, (unsigned long)count);
+
+    // Stops at the first frame the bus cannot take, the ones before it are already sent
+    size_t sent = 0;
+    while (sent < count && send_classic(bus_id, 0, &msgs[sent]) == 0)
+    {
+        sent++;
+    }
+
+    return (sent > 0 || count == 0) ? (int)sent : -1;
+}
+
+int simulith_can_receive_batch(uint8_t bus_id, simulith_can_message_t *msgs, size_t max_count)
+{
+    can_node_t *node = get_node(bus_id, 0);
+
+    if (!node || (!msgs && max_count > 0))
     {
-        simulith_log("CAN bus %d already initialized\n", bus_id);
         return -1;
     }
 
-    // Initialize bus structure
-    memcpy(&bus->config, config, sizeof(simulith_can_config_t));
-    bus->rx_callback = rx_cb;
-    bus->initialized = true;
-    bus->rx_head     = 0;
-    bus->rx_tail     = 0;
+    // Stops early at an FD frame, which only simulith_can_receive_fd can return
+    size_t count = 0;
+    while (count < max_count && pop_frame(&can_buses[bus_id], node, &msgs[count], NULL) > 0)
+    {
+        count++;
+    }
+    if (count > 0)
+    {
+        simulith_log("CAN%d RX batch: %lu frames\n", bus_id, (unsigned long)count);
+    }
 
-    // Clear all filters
-    memset(bus->filters, 0, sizeof(bus->filters));
+    return (int)count;
+}
 
-    simulith_log("CAN bus %d initialized: %lu bps, sample point %d%%, SJW %d\n", bus_id, (unsigned long)config->bitrate,
-                 config->sample_point, config->sync_jump);
+int simulith_can_set_dispatch_mode(uint8_t bus_id, simulith_can_dispatch_mode_t mode)
+{
+    return simulith_can_node_set_dispatch_mode(bus_id, 0, mode);
+}
+
+int simulith_can_node_set_dispatch_mode(uint8_t bus_id, int node_id, simulith_can_dispatch_mode_t mode)
+{
+    can_node_t *node = get_node(bus_id, node_id);
+
+    if (!node || mode > SIMULITH_CAN_DISPATCH_DEFERRED)
+    {
+        return -1;
+    }
 
+    node->dispatch_mode = mode;
+    simulith_log("CAN%d node %d dispatch mode set to %d\n", bus_id, node_id, mode);
     return 0;
 }
 
-int simulith_can_add_filter(uint8_t bus_id, const simulith_can_filter_t *filter)
+int simulith_can_dispatch(uint8_t bus_id)
 {
     if (bus_id >= MAX_CAN_BUSES || !can_buses[bus_id].initialized)
     {
         return -1;
     }
 
-    can_bus_t *bus = &can_buses[bus_id];
+    can_bus_t *bus   = &can_buses[bus_id];
+    int        count = 0;
 
-    // Find free filter slot
-    for (int i = 0; i < MAX_FILTERS; i++)
+    for (int i = 0; i < SIMULITH_CAN_MAX_NODES; i++)
     {
-        if (!bus->filters[i].active)
+        can_node_t  *node  = &bus->nodes[i];
+        ref_queue_t *queue = &node->deferred_queue;
+        uint16_t     ref;
+
+        // Frames sent by the callbacks wait for the next drain
+        size_t end = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+        while (node->active && queue->tail != end && ref_queue_peek(queue, &ref))
         {
-            memcpy(&bus->filters[i].filter, filter, sizeof(simulith_can_filter_t));
-            bus->filters[i].active = true;
-            simulith_log("Added filter %d to CAN%d: ID=0x%x, mask=0x%x, %s\n", i, bus_id, filter->id, filter->mask,
-                         filter->is_extended ? "extended" : "standard");
-            return i;
+            ref_queue_pop(queue);
+
+            // Filters may have changed since the frame was queued, the reference moves to the rx queue
+            if (dispatch_frame(bus_id, bus, node, ref) || !ref_queue_push(&node->rx_queue, ref))
+            {
+                frame_release(&bus->pool, ref);
+            }
+            count++;
         }
     }
 
-    simulith_log("No free filter slots on CAN%d\n", bus_id);
-    return -1;
+    return count;
 }
 
-int simulith_can_remove_filter(uint8_t bus_id, int filter_id)
+int simulith_can_set_timing(uint8_t bus_id, bool enable)
 {
-    if (bus_id >= MAX_CAN_BUSES || !can_buses[bus_id].initialized || filter_id < 0 || filter_id >= MAX_FILTERS)
+    if (bus_id >= MAX_CAN_BUSES || !can_buses[bus_id].initialized)
     {
         return -1;
     }
 
     can_bus_t *bus = &can_buses[bus_id];
 
-    if (!bus->filters[filter_id].active)
+    if (!enable)
     {
-        return -1;
+        flush_pending(bus_id, bus);
+    }
+    else if (!bus->timing)
+    {
+        bus->time_ns          = 0;
+        bus->busy_ns          = 0;
+        bus->frames           = 0;
+        bus->max_latency_ns   = 0;
+        bus->last_utilization = 0.0;
     }
 
-    bus->filters[filter_id].active = false;
-    simulith_log("Removed filter %d from CAN%d\n", filter_id, bus_id);
+    bus->timing = enable;
+    simulith_log("CAN%d bit timing %s\n", bus_id, enable ? "enabled" : "disabled");
     return 0;
 }
 
-int simulith_can_send(uint8_t bus_id, const simulith_can_message_t *msg)
+int simulith_can_advance(uint8_t bus_id, uint64_t now_ns)
 {
     if (bus_id >= MAX_CAN_BUSES || !can_buses[bus_id].initialized)
     {
         return -1;
     }
 
-    if (!is_valid_message(msg))
+    can_bus_t *bus = &can_buses[bus_id];
+
+    if (!bus->timing)
     {
-        simulith_log("Invalid CAN message\n");
+        return 0;
+    }
+
+    if (now_ns < bus->time_ns)
+    {
+        simulith_log("CAN%d cannot advance backwards to %llu ns\n", bus_id, (unsigned long long)now_ns);
         return -1;
     }
 
-    simulith_log("CAN%d TX: ID=0x%x [%d] %s%s", bus_id, msg->id, msg->dlc, msg->is_extended ? "EXT " : "STD ",
-                 msg->is_rtr ? "RTR " : "");
+    uint64_t window_start = bus->time_ns;
+    uint64_t window_busy  = 0;
+    int      delivered    = 0;
 
-    if (!msg->is_rtr)
+    while (true)
     {
-        for (int i = 0; i < msg->dlc; i++)
+        if (!bus->tx_active)
         {
-            simulith_log("%02X ", msg->data[i]);
+            // The bus is idle: the highest priority pending frame starts right away
+            if (!arbitrate(bus, &bus->tx))
+                break;
+            bus->tx.start_ns = bus->time_ns;
+            bus->tx_active   = true;
         }
-    }
-    simulith_log("\n");
 
-    // In simulation, we can directly pass the message to the receive callback
-    // In real hardware, this would go through the CAN transceiver
-    can_bus_t *bus = &can_buses[bus_id];
-    if (bus->rx_callback)
-    {
-        // Check if message passes any active filters
-        bool passes_filter = false;
-        for (int i = 0; i < MAX_FILTERS; i++)
+        uint64_t start = bus->tx.start_ns > window_start ? bus->tx.start_ns : window_start;
+        uint64_t end   = bus->tx.start_ns + bus->tx.duration_ns;
+
+        if (end > now_ns)
         {
-            if (bus->filters[i].active && message_passes_filter(msg, &bus->filters[i].filter))
-            {
-                passes_filter = true;
-                break;
-            }
+            // Still on the wire at the end of this interval
+            window_busy += now_ns - start;
+            break;
         }
 
-        if (passes_filter || bus->rx_callback)
+        window_busy += end - start;
+        bus->time_ns   = end;
+        bus->tx_active = false;
+        bus->frames++;
+        if (bus->time_ns - bus->tx.ready_ns > bus->max_latency_ns)
         {
-            // Store in receive buffer
-            size_t next_head = (bus->rx_head + 1) % 32;
-            if (next_head != bus->rx_tail)
-            {
-                memcpy(&bus->rx_buffer[bus->rx_head], msg, sizeof(simulith_can_message_t));
-                bus->rx_head = next_head;
-            }
+            bus->max_latency_ns = bus->time_ns - bus->tx.ready_ns;
         }
+
+        // Frames sent from receive callbacks join arbitration at this point in time
+        transmit_frame(bus_id, bus, bus->tx.sender, bus->tx.ref);
+        delivered++;
+    }
+
+    bus->time_ns = now_ns;
+    bus->busy_ns += window_busy;
+    if (now_ns > window_start)
+    {
+        bus->last_utilization = (double)window_busy / (double)(now_ns - window_start);
+    }
+
+    return delivered;
+}
+
+int simulith_can_get_stats(uint8_t bus_id, simulith_can_bus_stats_t *stats)
+{
+    if (bus_id >= MAX_CAN_BUSES || !can_buses[bus_id].initialized || !stats)
+    {
+        return -1;
     }
 
+    can_bus_t *bus = &can_buses[bus_id];
+
+    stats->time_ns          = bus->time_ns;
+    stats->busy_ns          = bus->busy_ns;
+    stats->frames           = bus->frames;
+    stats->max_latency_ns   = bus->max_latency_ns;
+    stats->pending          = (uint32_t)bus->pending_count + (bus->tx_active ? 1 : 0);
+    stats->utilization      = bus->time_ns ? (double)bus->busy_ns / (double)bus->time_ns : 0.0;
+    stats->last_utilization = bus->last_utilization;
     return 0;
 }
 
-int simulith_can_receive(uint8_t bus_id, simulith_can_message_t *msg)
+int64_t simulith_can_frame_duration_ns(uint8_t bus_id, const simulith_can_fd_message_t *msg)
 {
     if (bus_id >= MAX_CAN_BUSES || !can_buses[bus_id].initialized || !msg)
     {
@@ -223,28 +1338,35 @@ int simulith_can_receive(uint8_t bus_id, simulith_can_message_t *msg)
 
     can_bus_t *bus = &can_buses[bus_id];
 
-    if (bus->rx_head == bus->rx_tail)
+    if (((msg->flags & SIMULITH_CAN_FLAG_FDF) && !is_valid_fd_message(bus, msg)) ||
+        (!(msg->flags & SIMULITH_CAN_FLAG_FDF) && (msg->len > SIMULITH_CAN_MAX_DLC || !is_valid_id(msg->id, msg->is_extended))))
     {
-        return 0; // No messages available
+        return -1;
     }
 
-    // Get message from buffer
-    memcpy(msg, &bus->rx_buffer[bus->rx_tail], sizeof(simulith_can_message_t));
-    bus->rx_tail = (bus->rx_tail + 1) % 32;
+    return (int64_t)frame_duration_ns(&bus->config, msg);
+}
 
-    simulith_log("CAN%d RX: ID=0x%x [%d] %s%s", bus_id, msg->id, msg->dlc, msg->is_extended ? "EXT " : "STD ",
-                 msg->is_rtr ? "RTR " : "");
+int simulith_can_node_get_dropped(uint8_t bus_id, int node_id, uint64_t *dropped)
+{
+    can_node_t *node = get_node(bus_id, node_id);
 
-    if (!msg->is_rtr)
+    if (!node || !dropped)
     {
-        for (int i = 0; i < msg->dlc; i++)
-        {
-            simulith_log("%02X ", msg->data[i]);
-        }
+        return -1;
     }
-    simulith_log("\n");
 
-    return 1;
+    *dropped = atomic_load_explicit(&node->dropped, memory_order_relaxed);
+    return 0;
+}
+
+uint32_t simulith_can_get_generation(uint8_t bus_id)
+{
+    if (bus_id >= MAX_CAN_BUSES || !can_buses[bus_id].initialized)
+    {
+        return 0;
+    }
+    return can_buses[bus_id].generation;
 }
 
 int simulith_can_close(uint8_t bus_id)
@@ -257,4 +1379,4 @@ int simulith_can_close(uint8_t bus_id)
     can_buses[bus_id].initialized = false;
     simulith_log("CAN bus %d closed\n", bus_id);
     return 0;
-}
\ No newline at end of file
+}
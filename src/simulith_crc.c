@@ -0,0 +1,223 @@
+#include "simulith_crc.h"
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define HAVE_SSE42_CRC 1
+#endif
+
+#define CRC16_CCITT_POLY 0x1021
+#define CRC16_X25_POLY   0x8408     // Reflected 0x1021
+#define CRC32C_POLY      0x82F63B78 // Reflected
+#define SLICES           8          // Bytes per step of the table-driven loops
+
+// Slice k holds the CRC of a byte followed by k zero bytes
+static uint16_t crc16_table[SLICES][256];
+static uint16_t crc16_x25_table[256];
+static uint32_t crc32c_table[SLICES][256];
+
+static uint32_t (*crc32c_update)(uint32_t crc, const uint8_t *data, size_t len);
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static uint32_t load_le32(const uint8_t *data)
+{
+    return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+// Slicing-by-8, eight table lookups per eight bytes instead of a loop per bit
+static uint32_t crc32c_sliced(uint32_t crc, const uint8_t *data, size_t len)
+{
+    while (len >= SLICES)
+    {
+        uint32_t lo = crc ^ load_le32(data);
+        uint32_t hi = load_le32(data + 4);
+
+        crc = crc32c_table[7][lo & 0xFF] ^ crc32c_table[6][(lo >> 8) & 0xFF] ^ crc32c_table[5][(lo >> 16) & 0xFF] ^
+              crc32c_table[4][lo >> 24] ^ crc32c_table[3][hi & 0xFF] ^ crc32c_table[2][(hi >> 8) & 0xFF] ^
+              crc32c_table[1][(hi >> 16) & 0xFF] ^ crc32c_table[0][hi >> 24];
+        data += SLICES;
+        len -= SLICES;
+    }
+
+    while (len--)
+    {
+        crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+#ifdef HAVE_SSE42_CRC
+__attribute__((target("sse4.2"))) static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *data, size_t len)
+{
+    uint64_t crc64 = crc;
+
+    while (len >= sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += sizeof(word);
+        len -= sizeof(word);
+    }
+
+    crc = (uint32_t)crc64;
+    while (len--)
+    {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+static void init_tables(void)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        uint16_t crc16     = i << 8;
+        uint16_t crc16_x25 = i;
+        uint32_t crc32c    = i;
+
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc16     = (crc16 & 0x8000) ? (crc16 << 1) ^ CRC16_CCITT_POLY : crc16 << 1;
+            crc16_x25 = (crc16_x25 & 1) ? (crc16_x25 >> 1) ^ CRC16_X25_POLY : crc16_x25 >> 1;
+            crc32c    = (crc32c & 1) ? (crc32c >> 1) ^ CRC32C_POLY : crc32c >> 1;
+        }
+        crc16_table[0][i]  = crc16;
+        crc16_x25_table[i] = crc16_x25;
+        crc32c_table[0][i] = crc32c;
+    }
+
+    for (int k = 1; k < SLICES; k++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            uint16_t crc16  = crc16_table[k - 1][i];
+            uint32_t crc32c = crc32c_table[k - 1][i];
+
+            crc16_table[k][i]  = (crc16 << 8) ^ crc16_table[0][crc16 >> 8];
+            crc32c_table[k][i] = (crc32c >> 8) ^ crc32c_table[0][crc32c & 0xFF];
+        }
+    }
+
+    crc32c_update = crc32c_sliced;
+#ifdef HAVE_SSE42_CRC
+    if (__builtin_cpu_supports("sse4.2"))
+        crc32c_update = crc32c_sse42;
+#endif
+}
+
+uint16_t simulith_crc16_ccitt(uint16_t crc, const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+
+    pthread_once(&tables_once, init_tables);
+
+    // Slicing-by-8, the CRC overlaps the first two bytes of each step
+    while (len >= SLICES)
+    {
+        crc = crc16_table[7][bytes[0] ^ (crc >> 8)] ^ crc16_table[6][bytes[1] ^ (crc & 0xFF)] ^
+              crc16_table[5][bytes[2]] ^ crc16_table[4][bytes[3]] ^ crc16_table[3][bytes[4]] ^
+              crc16_table[2][bytes[5]] ^ crc16_table[1][bytes[6]] ^ crc16_table[0][bytes[7]];
+        bytes += SLICES;
+        len -= SLICES;
+    }
+
+    while (len--)
+    {
+        crc = (crc << 8) ^ crc16_table[0][(crc >> 8) ^ *bytes++];
+    }
+    return crc;
+}
+
+uint16_t simulith_crc16_x25(uint16_t crc, const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+
+    pthread_once(&tables_once, init_tables);
+
+    // HDLC frames are short, a byte at a time is enough
+    crc = ~crc;
+    while (len--)
+    {
+        crc = (crc >> 8) ^ crc16_x25_table[(crc ^ *bytes++) & 0xFF];
+    }
+    return ~crc;
+}
+
+uint32_t simulith_crc32c(uint32_t crc, const void *data, size_t len)
+{
+    pthread_once(&tables_once, init_tables);
+    return ~crc32c_update(~crc, data, len);
+}
+
+size_t simulith_crc_size(uint8_t type)
+{
+    switch (type)
+    {
+        case SIMULITH_CRC_CRC16_CCITT:
+        case SIMULITH_CRC_CRC16_X25:
+            return 2;
+        case SIMULITH_CRC_CRC32C:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+// CRC of the frame before the field
+static uint32_t frame_crc(uint8_t type, const uint8_t *frame, size_t len)
+{
+    if (type == SIMULITH_CRC_CRC16_CCITT)
+        return simulith_crc16_ccitt(SIMULITH_CRC16_CCITT_INIT, frame, len);
+    if (type == SIMULITH_CRC_CRC16_X25)
+        return simulith_crc16_x25(0, frame, len);
+    return simulith_crc32c(0, frame, len);
+}
+
+// Position of the i-th most significant byte of a field starting at start
+static size_t field_byte(uint8_t type, size_t start, size_t size, size_t i)
+{
+    // The HDLC FCS goes least significant byte first
+    return (type == SIMULITH_CRC_CRC16_X25) ? start + size - 1 - i : start + i;
+}
+
+bool simulith_crc_check(uint8_t type, const uint8_t *frame, size_t len)
+{
+    size_t   size  = simulith_crc_size(type);
+    uint32_t field = 0;
+
+    if (size == 0)
+    {
+        return true;
+    }
+
+    if (!frame || len < size)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        field = (field << 8) | frame[field_byte(type, len - size, size, i)];
+    }
+    return field == frame_crc(type, frame, len - size);
+}
+
+size_t simulith_crc_stamp(uint8_t type, uint8_t *frame, size_t len)
+{
+    size_t size = simulith_crc_size(type);
+
+    if (size == 0 || !frame)
+    {
+        return len;
+    }
+
+    uint32_t crc = frame_crc(type, frame, len);
+    for (size_t i = 0; i < size; i++)
+    {
+        frame[field_byte(type, len, size, i)] = crc >> (8 * (size - 1 - i));
+    }
+    return len + size;
+}
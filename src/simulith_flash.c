@@ -0,0 +1,604 @@
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64 // Images over 2 GB on 32-bit hosts
+#endif
+
+#include "simulith_flash.h"
+#include "simulith.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define DEFAULT_PAGE_SIZE   256
+#define DEFAULT_SECTOR_SIZE 4096
+
+// Serial flash commands
+#define CMD_WRITE_DISABLE 0x04
+#define CMD_WRITE_ENABLE  0x06
+#define CMD_READ_STATUS   0x05
+#define CMD_READ          0x03
+#define CMD_FAST_READ     0x0B
+#define CMD_READ4         0x13
+#define CMD_FAST_READ4    0x0C
+#define CMD_PAGE_PROGRAM  0x02
+#define CMD_PAGE_PROGRAM4 0x12
+#define CMD_SECTOR_ERASE  0x20
+#define CMD_SECTOR_ERASE4 0x21
+#define CMD_CHIP_ERASE    0x60
+#define CMD_CHIP_ERASE2   0xC7
+#define CMD_JEDEC_ID      0x9F
+
+#define STATUS_WEL 0x02 // Write enable latch
+
+typedef struct
+{
+    bool                    active;
+    simulith_flash_config_t config;
+    int                     fd;
+    uint8_t                *data; // Image mapping
+    uint64_t                size;
+
+    // Page buffer: page_size data bytes, then page_size flags of the bytes loaded
+    uint8_t *page_buffer;
+    bool     loaded; // Bytes wait to be programmed
+
+    // SPI command state, reset when the chip select is asserted
+    uint8_t  command;
+    uint8_t  addr_len;  // Address bytes of the command
+    uint8_t  dummy_len; // Dummy bytes between the address and the data
+    size_t   position;  // Bytes since the chip select was asserted
+    uint64_t address;
+    bool     write_enable;
+
+    // I2C address pointer, kept between transactions for current address reads
+    uint8_t  i2c_addr_len;
+    uint64_t i2c_pointer;
+} flash_t;
+
+static flash_t flashes[SIMULITH_FLASH_MAX_DEVICES] = {0};
+
+static flash_t *get_flash(int flash_id)
+{
+    if (flash_id < 0 || flash_id >= SIMULITH_FLASH_MAX_DEVICES || !flashes[flash_id].active)
+        return NULL;
+    return &flashes[flash_id];
+}
+
+static bool is_power_of_two(uint32_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+int simulith_flash_open(const char *path, const simulith_flash_config_t *config)
+{
+    struct stat st;
+    int         flash_id = -1;
+
+    if (!path || !config || config->type > SIMULITH_FLASH_EEPROM || config->addr_bytes > 4)
+    {
+        return -1;
+    }
+
+    simulith_flash_config_t cfg = *config;
+    cfg.page_size               = cfg.page_size ? cfg.page_size : DEFAULT_PAGE_SIZE;
+    cfg.sector_size             = cfg.sector_size ? cfg.sector_size : DEFAULT_SECTOR_SIZE;
+    if (!is_power_of_two(cfg.page_size) || !is_power_of_two(cfg.sector_size))
+    {
+        simulith_log("Flash page and sector sizes must be powers of two\n");
+        return -1;
+    }
+
+    for (int i = 0; i < SIMULITH_FLASH_MAX_DEVICES; i++)
+    {
+        if (!flashes[i].active)
+        {
+            flash_id = i;
+            break;
+        }
+    }
+    if (flash_id < 0)
+    {
+        simulith_log("No free flash device for %s\n", path);
+        return -1;
+    }
+
+    int fd = open(path, cfg.persist ? O_RDWR : O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+        simulith_log("Cannot open flash image %s: %s\n", path, fd < 0 ? strerror(errno) : "empty file");
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    // Pages are only read in when touched; private mappings copy a page on its first write
+    uint8_t *data =
+        mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, cfg.persist ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        simulith_log("Cannot map flash image %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (cfg.addr_bytes == 0)
+    {
+        cfg.addr_bytes = (st.st_size <= 0x10000) ? 2 : (st.st_size <= 0x1000000 ? 3 : 4);
+    }
+
+    uint8_t *page_buffer = calloc(2, cfg.page_size);
+    if (!page_buffer)
+    {
+        simulith_log("Cannot allocate the page buffer of %s\n", path);
+        munmap(data, st.st_size);
+        close(fd);
+        return -1;
+    }
+
+    flash_t *flash = &flashes[flash_id];
+    memset(flash, 0, sizeof(*flash));
+    flash->config      = cfg;
+    flash->fd          = fd;
+    flash->data        = data;
+    flash->size        = st.st_size;
+    flash->page_buffer = page_buffer;
+    flash->active      = true;
+
+    simulith_log("Flash %d: %s, %llu bytes%s\n", flash_id, path, (unsigned long long)flash->size,
+                 cfg.persist ? "" : ", copy-on-write");
+    return flash_id;
+}
+
+// Load the page buffer from the address on, wrapping within the page
+static void load_page(flash_t *flash, uint64_t address, const uint8_t *data, size_t len)
+{
+    uint64_t mask = flash->config.page_size - 1;
+    uint8_t *flags = flash->page_buffer + flash->config.page_size;
+
+    // Like the page buffer of the part, later bytes replace the ones a page earlier
+    if (len > flash->config.page_size)
+    {
+        address += len - flash->config.page_size;
+        data += len - flash->config.page_size;
+        len = flash->config.page_size;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        flash->page_buffer[(address + i) & mask] = data[i];
+        flags[(address + i) & mask]              = 1;
+    }
+    flash->loaded = flash->loaded || len > 0;
+}
+
+// Program the loaded bytes of the page buffer into the page of the address, then empty it
+static void program(flash_t *flash, uint64_t address)
+{
+    uint64_t page  = address & ~(uint64_t)(flash->config.page_size - 1);
+    uint8_t *flags = flash->page_buffer + flash->config.page_size;
+
+    if (!flash->loaded)
+        return;
+
+    for (uint32_t offset = 0; offset < flash->config.page_size; offset++)
+    {
+        uint64_t target = (page + offset) % flash->size;
+
+        if (!flags[offset])
+            continue;
+
+        // NOR cells only go from 1 to 0 until erased
+        if (flash->config.type == SIMULITH_FLASH_NOR)
+            flash->data[target] &= flash->page_buffer[offset];
+        else
+            flash->data[target] = flash->page_buffer[offset];
+        flags[offset] = 0;
+    }
+    flash->loaded = false;
+}
+
+static void erase_sector(flash_t *flash, uint64_t address)
+{
+    uint64_t start = (address % flash->size) & ~(uint64_t)(flash->config.sector_size - 1);
+    uint64_t len   = flash->config.sector_size;
+
+    if (start + len > flash->size)
+        len = flash->size - start;
+    memset(&flash->data[start], 0xFF, len);
+}
+
+// Copy out from the address on, wrapping at the end of the device
+static void read_wrapped(const flash_t *flash, uint64_t address, uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        uint64_t offset = address % flash->size;
+        size_t   count  = (len < flash->size - offset) ? len : flash->size - offset;
+
+        memcpy(data, &flash->data[offset], count);
+        data += count;
+        address += count;
+        len -= count;
+    }
+}
+
+static void flash_spi_cs(uint8_t bus_id, uint8_t cs_id, bool asserted, void *ctx)
+{
+    flash_t *flash = ctx;
+
+    (void)bus_id;
+    (void)cs_id;
+
+    if (asserted)
+    {
+        flash->command  = 0;
+        flash->position = 0;
+        flash->address  = 0;
+        return;
+    }
+
+    // Programs and erases run once the whole command is in
+    bool complete = flash->position >= 1u + flash->addr_len;
+    switch (flash->command)
+    {
+        case CMD_PAGE_PROGRAM:
+        case CMD_PAGE_PROGRAM4:
+            program(flash, flash->address);
+            break;
+        case CMD_SECTOR_ERASE:
+        case CMD_SECTOR_ERASE4:
+            if (complete && flash->write_enable)
+                erase_sector(flash, flash->address);
+            break;
+        case CMD_CHIP_ERASE:
+        case CMD_CHIP_ERASE2:
+            if (flash->write_enable)
+                memset(flash->data, 0xFF, flash->size);
+            break;
+        default:
+            break;
+    }
+
+    // Every program or erase clears the write enable latch
+    if (flash->command == CMD_PAGE_PROGRAM || flash->command == CMD_PAGE_PROGRAM4 ||
+        flash->command == CMD_SECTOR_ERASE || flash->command == CMD_SECTOR_ERASE4 ||
+        flash->command == CMD_CHIP_ERASE || flash->command == CMD_CHIP_ERASE2)
+        flash->write_enable = false;
+}
+
+static void start_command(flash_t *flash, uint8_t command)
+{
+    flash->command   = command;
+    flash->addr_len  = 0;
+    flash->dummy_len = 0;
+
+    switch (command)
+    {
+        case CMD_READ:
+        case CMD_PAGE_PROGRAM:
+        case CMD_SECTOR_ERASE:
+            flash->addr_len = flash->config.addr_bytes;
+            break;
+        case CMD_FAST_READ:
+            flash->addr_len  = flash->config.addr_bytes;
+            flash->dummy_len = 1;
+            break;
+        case CMD_READ4:
+        case CMD_PAGE_PROGRAM4:
+        case CMD_SECTOR_ERASE4:
+            flash->addr_len = 4;
+            break;
+        case CMD_FAST_READ4:
+            flash->addr_len  = 4;
+            flash->dummy_len = 1;
+            break;
+        case CMD_WRITE_ENABLE:
+            flash->write_enable = true;
+            break;
+        case CMD_WRITE_DISABLE:
+            flash->write_enable = false;
+            break;
+        default:
+            break;
+    }
+}
+
+// Data phase of the command, in bulk
+static void data_phase(flash_t *flash, const uint8_t *tx_data, uint8_t *rx_data, size_t len)
+{
+    size_t index = flash->position - (1 + flash->addr_len + flash->dummy_len);
+
+    switch (flash->command)
+    {
+        case CMD_READ:
+        case CMD_FAST_READ:
+        case CMD_READ4:
+        case CMD_FAST_READ4:
+            if (rx_data)
+                read_wrapped(flash, flash->address + index, rx_data, len);
+            return;
+        case CMD_PAGE_PROGRAM:
+        case CMD_PAGE_PROGRAM4:
+            if (tx_data && flash->write_enable)
+                load_page(flash, flash->address + index, tx_data, len);
+            break;
+        case CMD_READ_STATUS:
+            if (rx_data)
+                memset(rx_data, flash->write_enable ? STATUS_WEL : 0, len);
+            return;
+        case CMD_JEDEC_ID:
+            for (size_t i = 0; rx_data && i < len; i++)
+                rx_data[i] = flash->config.jedec_id >> (8 * (2 - (index + i) % 3));
+            return;
+        default:
+            break;
+    }
+
+    if (rx_data)
+        memset(rx_data, 0xFF, len);
+}
+
+static int flash_spi_transfer(uint8_t bus_id, uint8_t cs_id, const uint8_t *tx_data, uint8_t *rx_data, size_t len,
+                              void *ctx)
+{
+    flash_t *flash = ctx;
+    size_t   i     = 0;
+
+    (void)bus_id;
+    (void)cs_id;
+
+    // Opcode, address and dummy bytes, one at a time
+    while (i < len && flash->position < (flash->position == 0 ? 1u : 1u + flash->addr_len + flash->dummy_len))
+    {
+        uint8_t byte = tx_data ? tx_data[i] : 0xFF;
+
+        if (flash->position == 0)
+            start_command(flash, byte);
+        else if (flash->position <= flash->addr_len)
+            flash->address = (flash->address << 8) | byte;
+
+        if (rx_data)
+            rx_data[i] = 0xFF;
+        flash->position++;
+        i++;
+    }
+
+    if (i < len)
+    {
+        data_phase(flash, tx_data ? tx_data + i : NULL, rx_data ? rx_data + i : NULL, len - i);
+        flash->position += len - i;
+    }
+    return len;
+}
+
+int simulith_flash_attach_spi(int flash_id, uint8_t bus_id, uint8_t cs_id)
+{
+    flash_t *flash = get_flash(flash_id);
+
+    if (!flash || simulith_spi_attach(bus_id, cs_id, flash_spi_transfer, flash) < 0)
+    {
+        return -1;
+    }
+
+    if (simulith_spi_set_cs_callback(bus_id, cs_id, flash_spi_cs) < 0)
+    {
+        simulith_spi_attach(bus_id, cs_id, NULL, NULL);
+        return -1;
+    }
+    return 0;
+}
+
+// Sequential read from the address pointer, wrapping at the end of the device
+static void eeprom_read(flash_t *flash, uint8_t *data, size_t len)
+{
+    read_wrapped(flash, flash->i2c_pointer, data, len);
+    flash->i2c_pointer = (flash->i2c_pointer + len) % flash->size;
+}
+
+// Set the address pointer, then page write the data bytes, the pointer wrapping within the page
+static void eeprom_write(flash_t *flash, uint64_t pointer, const uint8_t *data, size_t len)
+{
+    uint64_t mask = flash->config.page_size - 1;
+
+    flash->i2c_pointer = pointer % flash->size;
+    if (len == 0)
+        return;
+
+    load_page(flash, flash->i2c_pointer, data, len);
+    program(flash, flash->i2c_pointer);
+    flash->i2c_pointer = ((flash->i2c_pointer & ~mask) | ((flash->i2c_pointer + len) & mask)) % flash->size;
+}
+
+// Register reads: a one byte address pointer, then a sequential read
+static int flash_i2c_read(uint8_t bus_id, uint16_t addr, uint8_t reg, uint8_t *data, size_t len, void *ctx)
+{
+    flash_t *flash = ctx;
+
+    (void)bus_id;
+    if (flash->i2c_addr_len != 1)
+    {
+        simulith_log("I2C EEPROM at 0x%03X needs a %u byte address\n", addr & ~SIMULITH_I2C_ADDR_10BIT,
+                     flash->i2c_addr_len);
+        return -1;
+    }
+
+    flash->i2c_pointer = reg % flash->size;
+    eeprom_read(flash, data, len);
+    return 0;
+}
+
+// Register writes: reg is the first address byte, the rest of the address starts the data
+static int flash_i2c_write(uint8_t bus_id, uint16_t addr, uint8_t reg, const uint8_t *data, size_t len, void *ctx)
+{
+    flash_t *flash   = ctx;
+    uint64_t pointer = reg;
+
+    (void)bus_id;
+    if (len < flash->i2c_addr_len - 1u)
+    {
+        simulith_log("I2C EEPROM at 0x%03X needs a %u byte address\n", addr & ~SIMULITH_I2C_ADDR_10BIT,
+                     flash->i2c_addr_len);
+        return -1;
+    }
+
+    for (uint8_t i = 1; i < flash->i2c_addr_len; i++)
+        pointer = (pointer << 8) | data[i - 1];
+    eeprom_write(flash, pointer, data + flash->i2c_addr_len - 1, len - (flash->i2c_addr_len - 1));
+    return 0;
+}
+
+// Combined transactions: address pointer writes, page writes and sequential reads
+static int flash_i2c_transfer(uint8_t bus_id, uint16_t addr, const simulith_i2c_msg_t *msgs, size_t count, void *ctx)
+{
+    flash_t *flash = ctx;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (msgs[i].flags & SIMULITH_I2C_M_RD)
+            eeprom_read(flash, msgs[i].buf, msgs[i].len);
+        else if (flash_i2c_write(bus_id, addr, msgs[i].buf[0], msgs[i].buf + 1, msgs[i].len - 1, ctx) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+int simulith_flash_attach_i2c(int flash_id, uint8_t bus_id, uint16_t address)
+{
+    const simulith_i2c_device_ops_t ops   = {.read     = flash_i2c_read,
+                                             .write    = flash_i2c_write,
+                                             .transfer = flash_i2c_transfer};
+    flash_t                        *flash = get_flash(flash_id);
+
+    if (!flash)
+    {
+        return -1;
+    }
+
+    if (flash->size > 0x10000)
+    {
+        simulith_log("Flash %d is too large for a two byte I2C address\n", flash_id);
+        return -1;
+    }
+
+    flash->i2c_addr_len = (flash->size <= 0x100) ? 1 : 2;
+    flash->i2c_pointer  = 0;
+    return simulith_i2c_attach(bus_id, address, &ops, flash);
+}
+
+int simulith_flash_read(int flash_id, uint64_t address, uint8_t *data, size_t len)
+{
+    flash_t *flash = get_flash(flash_id);
+
+    if (!flash || !data || address >= flash->size || len > flash->size - address)
+    {
+        return -1;
+    }
+
+    memcpy(data, &flash->data[address], len);
+    return len;
+}
+
+int simulith_flash_program(int flash_id, uint64_t address, const uint8_t *data, size_t len)
+{
+    flash_t *flash = get_flash(flash_id);
+
+    if (!flash || !data || address >= flash->size || len > INT_MAX)
+    {
+        return -1;
+    }
+
+    load_page(flash, address, data, len);
+    program(flash, address);
+    return len;
+}
+
+int simulith_flash_erase(int flash_id, uint64_t address)
+{
+    flash_t *flash = get_flash(flash_id);
+
+    if (!flash || address >= flash->size)
+    {
+        return -1;
+    }
+
+    erase_sector(flash, address);
+    return 0;
+}
+
+uint64_t simulith_flash_size(int flash_id)
+{
+    flash_t *flash = get_flash(flash_id);
+
+    return flash ? flash->size : 0;
+}
+
+int simulith_flash_close(int flash_id)
+{
+    flash_t *flash = get_flash(flash_id);
+
+    if (!flash)
+    {
+        return -1;
+    }
+
+    if (flash->config.persist && msync(flash->data, flash->size, MS_SYNC) < 0)
+    {
+        simulith_log("Flash %d write back failed: %s\n", flash_id, strerror(errno));
+    }
+    munmap(flash->data, flash->size);
+    close(flash->fd);
+    free(flash->page_buffer);
+    flash->active = false;
+
+    simulith_log("Flash %d closed\n", flash_id);
+    return 0;
+}
+
+#else // !(__unix__ || __APPLE__)
+
+int simulith_flash_open(const char *path, const simulith_flash_config_t *config)
+{
+    simulith_log("Flash images are only available on POSIX systems\n");
+    return -1;
+}
+
+int simulith_flash_attach_spi(int flash_id, uint8_t bus_id, uint8_t cs_id)
+{
+    return -1;
+}
+
+int simulith_flash_attach_i2c(int flash_id, uint8_t bus_id, uint16_t address)
+{
+    return -1;
+}
+
+int simulith_flash_read(int flash_id, uint64_t address, uint8_t *data, size_t len)
+{
+    return -1;
+}
+
+int simulith_flash_program(int flash_id, uint64_t address, const uint8_t *data, size_t len)
+{
+    return -1;
+}
+
+int simulith_flash_erase(int flash_id, uint64_t address)
+{
+    return -1;
+}
+
+uint64_t simulith_flash_size(int flash_id)
+{
+    return 0;
+}
+
+int simulith_flash_close(int flash_id)
+{
+    return -1;
+}
+
+#endif // __unix__ || __APPLE__
@@ -2,16 +2,15 @@
 #include "simulith.h"
 #include <string.h>
 
+// One bit per pin in each word, so a port is a handful of words and port operations are word operations
 typedef struct
 {
-    bool                 initialized;
-    simulith_gpio_mode_t mode;
-    uint8_t              state; // Current pin state (0 or 1)
-} gpio_pin_t;
-
-typedef struct
-{
-    gpio_pin_t pins[SIMULITH_GPIO_MAX_PINS];
+    uint32_t state;       // Current pin states
+    uint32_t initialized; // Pins initialized
+    uint32_t output;      // Output pins
+    uint32_t open_drain;  // Open-drain outputs
+    uint32_t pullup;      // Inputs with pull-up
+    uint32_t pulldown;    // Inputs with pull-down
 } gpio_port_t;
 
 static gpio_port_t gpio_ports[SIMULITH_GPIO_MAX_PORTS] = {0};
@@ -39,7 +38,7 @@ static bool check_pin_initialized(uint8_t port, uint8_t pin)
     {
         return false;
     }
-    return gpio_ports[port].pins[pin].initialized;
+    return gpio_ports[port].initialized & (1u << pin);
 }
 
 int simulith_gpio_init(uint8_t port, uint8_t pin, const simulith_gpio_config_t *config)
@@ -56,37 +55,42 @@ int simulith_gpio_init(uint8_t port, uint8_t pin, const simulith_gpio_config_t *
         return -1;
     }
 
-    gpio_pin_t *gpio_pin = &gpio_ports[port].pins[pin];
+    gpio_port_t *gpio_port = &gpio_ports[port];
+    uint32_t     bit       = 1u << pin;
 
-    if (gpio_pin->initialized)
+    if (gpio_port->initialized & bit)
     {
         simulith_log("GPIO pin %d.%d already initialized\n", port, pin);
         return -1;
     }
 
-    // Initialize pin structure
-    gpio_pin->mode        = config->mode;
-    gpio_pin->initialized = true;
+    // Initialize pin mode, closed pins have all their bits clear
+    gpio_port->initialized |= bit;
 
-    // Set initial state
-    if (config->mode == SIMULITH_GPIO_MODE_OUTPUT || config->mode == SIMULITH_GPIO_MODE_OUTPUT_OD)
-    {
-        gpio_pin->state = config->initial_state;
-    }
-    else
+    switch (config->mode)
     {
-        // For inputs, set initial state based on pull resistors
-        if (config->mode == SIMULITH_GPIO_MODE_INPUT_PULLUP)
-        {
-            gpio_pin->state = 1;
-        }
-        else
-        {
-            gpio_pin->state = 0; // Default to low for floating or pulldown inputs
-        }
+        case SIMULITH_GPIO_MODE_OUTPUT_OD:
+            gpio_port->open_drain |= bit;
+            // fall through
+        case SIMULITH_GPIO_MODE_OUTPUT:
+            gpio_port->output |= bit;
+            if (config->initial_state)
+                gpio_port->state |= bit;
+            break;
+        case SIMULITH_GPIO_MODE_INPUT_PULLUP:
+            // For inputs, set initial state based on pull resistors
+            gpio_port->pullup |= bit;
+            gpio_port->state |= bit;
+            break;
+        case SIMULITH_GPIO_MODE_INPUT_PULLDOWN:
+            gpio_port->pulldown |= bit;
+            break;
+        default:
+            break; // Default to low for floating inputs
     }
 
-    simulith_log("GPIO %d.%d initialized: mode=%d, state=%d\n", port, pin, config->mode, gpio_pin->state);
+    simulith_log("GPIO %d.%d initialized: mode=%d, state=%d\n", port, pin, config->mode,
+                 (gpio_port->state & bit) ? 1 : 0);
 
     return 0;
 }
@@ -98,10 +102,11 @@ int simulith_gpio_write(uint8_t port, uint8_t pin, uint8_t value)
         return -1;
     }
 
-    gpio_pin_t *gpio_pin = &gpio_ports[port].pins[pin];
+    gpio_port_t *gpio_port = &gpio_ports[port];
+    uint32_t     bit       = 1u << pin;
 
     // Check if pin is configured as output
-    if (gpio_pin->mode != SIMULITH_GPIO_MODE_OUTPUT && gpio_pin->mode != SIMULITH_GPIO_MODE_OUTPUT_OD)
+    if (!(gpio_port->output & bit))
     {
         simulith_log("Cannot write to GPIO %d.%d: not configured as output\n", port, pin);
         return -1;
@@ -114,7 +119,7 @@ int simulith_gpio_write(uint8_t port, uint8_t pin, uint8_t value)
         return -1;
     }
 
-    gpio_pin->state = value;
+    gpio_port->state = value ? (gpio_port->state | bit) : (gpio_port->state & ~bit);
     simulith_log("GPIO %d.%d set to %d\n", port, pin, value);
 
     return 0;
@@ -127,8 +132,7 @@ int simulith_gpio_read(uint8_t port, uint8_t pin, uint8_t *value)
         return -1;
     }
 
-    gpio_pin_t *gpio_pin = &gpio_ports[port].pins[pin];
-    *value               = gpio_pin->state;
+    *value = (gpio_ports[port].state >> pin) & 1;
 
     simulith_log("GPIO %d.%d read: %d\n", port, pin, *value);
     return 0;
@@ -141,21 +145,111 @@ int simulith_gpio_toggle(uint8_t port, uint8_t pin)
         return -1;
     }
 
-    gpio_pin_t *gpio_pin = &gpio_ports[port].pins[pin];
+    gpio_port_t *gpio_port = &gpio_ports[port];
 
     // Check if pin is configured as output
-    if (gpio_pin->mode != SIMULITH_GPIO_MODE_OUTPUT && gpio_pin->mode != SIMULITH_GPIO_MODE_OUTPUT_OD)
+    if (!(gpio_port->output & (1u << pin)))
     {
         simulith_log("Cannot toggle GPIO %d.%d: not configured as output\n", port, pin);
         return -1;
     }
 
-    gpio_pin->state = !gpio_pin->state;
-    simulith_log("GPIO %d.%d toggled to %d\n", port, pin, gpio_pin->state);
+    gpio_port->state ^= 1u << pin;
+    simulith_log("GPIO %d.%d toggled to %d\n", port, pin, (gpio_port->state >> pin) & 1);
+
+    return 0;
+}
+
+int simulith_gpio_port_read(uint8_t port, uint32_t *mask)
+{
+    if (port >= SIMULITH_GPIO_MAX_PORTS || !mask)
+    {
+        return -1;
+    }
+
+    *mask = gpio_ports[port].state;
+    simulith_log("GPIO %d read: 0x%08lX\n", port, (unsigned long)*mask);
+    return 0;
+}
+
+// Every pin in the mask must be an initialized output
+static bool check_port_outputs(uint8_t port, uint32_t mask)
+{
+    if (port >= SIMULITH_GPIO_MAX_PORTS)
+    {
+        return false;
+    }
+
+    uint32_t invalid = mask & ~(gpio_ports[port].initialized & gpio_ports[port].output);
+    if (invalid)
+    {
+        simulith_log("Cannot write to GPIO %d pins 0x%08lX: not configured as output\n", port, (unsigned long)invalid);
+        return false;
+    }
+    return true;
+}
+
+int simulith_gpio_port_write(uint8_t port, uint32_t mask, uint32_t value)
+{
+    if (!check_port_outputs(port, mask))
+    {
+        return -1;
+    }
+
+    gpio_ports[port].state = (gpio_ports[port].state & ~mask) | (value & mask);
+    simulith_log("GPIO %d set: mask 0x%08lX, value 0x%08lX\n", port, (unsigned long)mask,
+                 (unsigned long)(value & mask));
+    return 0;
+}
+
+int simulith_gpio_port_toggle(uint8_t port, uint32_t mask)
+{
+    if (!check_port_outputs(port, mask))
+    {
+        return -1;
+    }
 
+    gpio_ports[port].state ^= mask;
+    simulith_log("GPIO %d toggled: mask 0x%08lX\n", port, (unsigned long)mask);
     return 0;
 }
 
+int simulith_gpio_snapshot(simulith_gpio_snapshot_t *snapshot)
+{
+    if (!snapshot)
+    {
+        return -1;
+    }
+
+    for (uint8_t port = 0; port < SIMULITH_GPIO_MAX_PORTS; port++)
+    {
+        snapshot->state[port] = gpio_ports[port].state;
+    }
+    return 0;
+}
+
+int simulith_gpio_diff(const simulith_gpio_snapshot_t *before, const simulith_gpio_snapshot_t *after,
+                       simulith_gpio_snapshot_t *changed)
+{
+    int count = 0;
+
+    if (!before || !after)
+    {
+        return -1;
+    }
+
+    for (uint8_t port = 0; port < SIMULITH_GPIO_MAX_PORTS; port++)
+    {
+        uint32_t bits = before->state[port] ^ after->state[port];
+
+        if (changed)
+            changed->state[port] = bits;
+        for (; bits; bits &= bits - 1)
+            count++;
+    }
+    return count;
+}
+
 int simulith_gpio_close(uint8_t port, uint8_t pin)
 {
     if (!check_pin_initialized(port, pin))
@@ -163,7 +257,15 @@ int simulith_gpio_close(uint8_t port, uint8_t pin)
         return -1;
     }
 
-    gpio_ports[port].pins[pin].initialized = false;
+    gpio_port_t *gpio_port = &gpio_ports[port];
+    uint32_t     keep      = ~(1u << pin);
+
+    gpio_port->state &= keep;
+    gpio_port->initialized &= keep;
+    gpio_port->output &= keep;
+    gpio_port->open_drain &= keep;
+    gpio_port->pullup &= keep;
+    gpio_port->pulldown &= keep;
     simulith_log("GPIO %d.%d closed\n", port, pin);
     return 0;
 }
\ No newline at end of file
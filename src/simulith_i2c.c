@@ -1,17 +1,139 @@
 #include "simulith.h"
 #include <errno.h>
+#include <string.h>
 
-#define MAX_I2C_BUSES 8
+#define MAX_I2C_BUSES  8
+#define ADDR_7BIT_MAX  0x7F
+#define ADDR_10BIT_MAX 0x3FF
+#define MIN_SPEED_HZ   1000
+#define NS_PER_S       1000000000ULL
+
+typedef struct
+{
+    simulith_i2c_device_ops_t ops;
+    void                     *ctx;
+    uint16_t                  addr;
+    bool                      attached;
+    uint64_t                  stretch_ns; // Clock stretching per message
+} i2c_device_t;
 
 typedef struct
 {
     bool                        initialized;
     simulith_i2c_read_callback  read_cb;
     simulith_i2c_write_callback write_cb;
+    i2c_device_t                devices[ADDR_7BIT_MAX + 1];                    // Indexed by 7-bit address
+    i2c_device_t                devices_10bit[SIMULITH_I2C_MAX_10BIT_DEVICES]; // Few, searched in order
+
+    // Transaction timing, enabled by a speed
+    uint32_t                 speed_hz;
+    uint64_t                 time_ns;        // Bus time of the last simulith_i2c_advance
+    uint64_t                 window_busy_ns; // Transaction time since then
+    simulith_i2c_bus_stats_t stats;
 } i2c_bus_t;
 
 static i2c_bus_t i2c_buses[MAX_I2C_BUSES] = {0};
 
+static bool is_valid_addr(uint16_t addr)
+{
+    if (addr & SIMULITH_I2C_ADDR_10BIT)
+        return (addr & ~SIMULITH_I2C_ADDR_10BIT) <= ADDR_10BIT_MAX;
+    return addr <= ADDR_7BIT_MAX;
+}
+
+static i2c_device_t *find_device(i2c_bus_t *bus, uint16_t addr)
+{
+    if (!(addr & SIMULITH_I2C_ADDR_10BIT))
+        return addr <= ADDR_7BIT_MAX && bus->devices[addr].attached ? &bus->devices[addr] : NULL;
+
+    for (int i = 0; i < SIMULITH_I2C_MAX_10BIT_DEVICES; i++)
+    {
+        if (bus->devices_10bit[i].attached && bus->devices_10bit[i].addr == addr)
+            return &bus->devices_10bit[i];
+    }
+    return NULL;
+}
+
+// Bit times of a message: address phase, then nine clocks per byte for the data and ACK bits
+// prev is the message before msg in the same transaction, NULL for the first one
+static uint64_t message_bits(const simulith_i2c_msg_t *msg, const simulith_i2c_msg_t *prev)
+{
+    uint64_t bits = 9;
+
+    // Two address bytes; reads repeat the first one, with the read bit, after a repeated start.
+    // Right after a message to the same device, a read only sends that first byte again.
+    if ((msg->addr & SIMULITH_I2C_ADDR_10BIT) && !(msg->flags & SIMULITH_I2C_M_RD))
+        bits = 9 + 9;
+    else if ((msg->addr & SIMULITH_I2C_ADDR_10BIT) && (!prev || prev->addr != msg->addr))
+        bits = 9 + 9 + 1 + 9;
+    return bits + 9 * (uint64_t)msg->len;
+}
+
+static uint64_t bits_ns(const i2c_bus_t *bus, uint64_t bits)
+{
+    return (bits * NS_PER_S + bus->speed_hz - 1) / bus->speed_hz;
+}
+
+// Start and stop conditions, the messages with repeated starts in between, and clock stretching
+static uint64_t transaction_ns(i2c_bus_t *bus, const simulith_i2c_msg_t *msgs, size_t count)
+{
+    uint64_t bits    = 2 + (count - 1);
+    uint64_t stretch = 0;
+
+    if (!bus->speed_hz)
+        return 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        i2c_device_t *device = find_device(bus, msgs[i].addr);
+
+        bits += message_bits(&msgs[i], i > 0 ? &msgs[i - 1] : NULL);
+        stretch += device ? device->stretch_ns : 0;
+    }
+    return bits_ns(bus, bits) + stretch;
+}
+
+static void account(i2c_bus_t *bus, uint64_t duration_ns)
+{
+    bus->window_busy_ns += duration_ns;
+    bus->stats.busy_ns += duration_ns;
+    bus->stats.transactions++;
+}
+
+static int nack(uint8_t bus_id, uint16_t addr)
+{
+    i2c_bus_t         *bus     = &i2c_buses[bus_id];
+    simulith_i2c_msg_t address = {.addr = addr};
+
+    account(bus, transaction_ns(bus, &address, 1));
+    bus->stats.nacks++;
+    simulith_log("I2C%d: no device at 0x%03X\n", bus_id, addr & ~SIMULITH_I2C_ADDR_10BIT);
+    errno = ENXIO;
+    return -1;
+}
+
+// Accesses without a device go to the bus callbacks, which only take 8-bit addresses
+static bool has_fallback(const i2c_bus_t *bus, uint16_t addr)
+{
+    return bus->read_cb && addr <= UINT8_MAX;
+}
+
+static int register_read(uint8_t bus_id, i2c_device_t *device, uint16_t addr, uint8_t reg, uint8_t *data,
+                         size_t len)
+{
+    if (device)
+        return device->ops.read(bus_id, addr, reg, data, len, device->ctx);
+    return i2c_buses[bus_id].read_cb((uint8_t)addr, reg, data, len);
+}
+
+static int register_write(uint8_t bus_id, i2c_device_t *device, uint16_t addr, uint8_t reg, const uint8_t *data,
+                          size_t len)
+{
+    if (device)
+        return device->ops.write(bus_id, addr, reg, data, len, device->ctx);
+    return i2c_buses[bus_id].write_cb((uint8_t)addr, reg, data, len);
+}
+
 int simulith_i2c_init(uint8_t bus_id, simulith_i2c_read_callback read_cb, simulith_i2c_write_callback write_cb)
 {
     if (bus_id >= MAX_I2C_BUSES)
@@ -21,22 +143,92 @@ int simulith_i2c_init(uint8_t bus_id, simulith_i2c_read_callback read_cb, simuli
         return -1;
     }
 
-    if (!read_cb || !write_cb)
+    // Both or neither, a bus without callbacks serves attached devices only
+    if (!read_cb != !write_cb)
     {
         simulith_log("Invalid I2C callbacks\n");
         errno = EINVAL;
         return -1;
     }
 
-    i2c_buses[bus_id].initialized = true;
-    i2c_buses[bus_id].read_cb     = read_cb;
-    i2c_buses[bus_id].write_cb    = write_cb;
+    i2c_bus_t *bus = &i2c_buses[bus_id];
+
+    memset(bus->devices, 0, sizeof(bus->devices));
+    memset(bus->devices_10bit, 0, sizeof(bus->devices_10bit));
+    memset(&bus->stats, 0, sizeof(bus->stats));
+    bus->speed_hz       = 0;
+    bus->time_ns        = 0;
+    bus->window_busy_ns = 0;
+    bus->initialized    = true;
+    bus->read_cb     = read_cb;
+    bus->write_cb    = write_cb;
 
     simulith_log("I2C bus %d initialized\n", bus_id);
     return 0;
 }
 
-int simulith_i2c_read(uint8_t bus_id, uint8_t addr, uint8_t reg, uint8_t *data, size_t len)
+int simulith_i2c_attach(uint8_t bus_id, uint16_t addr, const simulith_i2c_device_ops_t *ops, void *ctx)
+{
+    if (bus_id >= MAX_I2C_BUSES || !i2c_buses[bus_id].initialized || !is_valid_addr(addr))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    i2c_bus_t    *bus    = &i2c_buses[bus_id];
+    i2c_device_t *device = find_device(bus, addr);
+
+    if (!ops)
+    {
+        if (device)
+            memset(device, 0, sizeof(*device));
+        simulith_log("I2C%d device at 0x%03X detached\n", bus_id, addr & ~SIMULITH_I2C_ADDR_10BIT);
+        return 0;
+    }
+
+    if (!ops->read || !ops->write)
+    {
+        simulith_log("Invalid I2C device operations\n");
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (device)
+    {
+        simulith_log("I2C%d already has a device at 0x%03X\n", bus_id, addr & ~SIMULITH_I2C_ADDR_10BIT);
+        errno = EBUSY;
+        return -1;
+    }
+
+    if (addr & SIMULITH_I2C_ADDR_10BIT)
+    {
+        for (int i = 0; i < SIMULITH_I2C_MAX_10BIT_DEVICES && !device; i++)
+        {
+            if (!bus->devices_10bit[i].attached)
+                device = &bus->devices_10bit[i];
+        }
+
+        if (!device)
+        {
+            simulith_log("I2C%d has no room for another 10-bit device\n", bus_id);
+            errno = ENOSPC;
+            return -1;
+        }
+    }
+    else
+    {
+        device = &bus->devices[addr];
+    }
+
+    device->ops      = *ops;
+    device->ctx      = ctx;
+    device->addr     = addr;
+    device->attached = true;
+    simulith_log("I2C%d device at 0x%03X attached\n", bus_id, addr & ~SIMULITH_I2C_ADDR_10BIT);
+    return 0;
+}
+
+int simulith_i2c_read(uint8_t bus_id, uint16_t addr, uint8_t reg, uint8_t *data, size_t len)
 {
     if (bus_id >= MAX_I2C_BUSES || !i2c_buses[bus_id].initialized)
     {
@@ -52,10 +244,19 @@ int simulith_i2c_read(uint8_t bus_id, uint8_t addr, uint8_t reg, uint8_t *data,
         return -1;
     }
 
-    return i2c_buses[bus_id].read_cb(addr, reg, data, len);
+    i2c_bus_t    *bus    = &i2c_buses[bus_id];
+    i2c_device_t *device = find_device(bus, addr);
+
+    if (!device && !has_fallback(bus, addr))
+        return nack(bus_id, addr);
+
+    simulith_i2c_msg_t msgs[] = {{.addr = addr, .buf = &reg, .len = 1},
+                                 {.addr = addr, .flags = SIMULITH_I2C_M_RD, .buf = data, .len = len}};
+    account(bus, transaction_ns(bus, msgs, 2));
+    return register_read(bus_id, device, addr, reg, data, len);
 }
 
-int simulith_i2c_write(uint8_t bus_id, uint8_t addr, uint8_t reg, const uint8_t *data, size_t len)
+int simulith_i2c_write(uint8_t bus_id, uint16_t addr, uint8_t reg, const uint8_t *data, size_t len)
 {
     if (bus_id >= MAX_I2C_BUSES || !i2c_buses[bus_id].initialized)
     {
@@ -71,5 +272,210 @@ int simulith_i2c_write(uint8_t bus_id, uint8_t addr, uint8_t reg, const uint8_t
         return -1;
     }
 
-    return i2c_buses[bus_id].write_cb(addr, reg, data, len);
-}
\ No newline at end of file
+    i2c_bus_t    *bus    = &i2c_buses[bus_id];
+    i2c_device_t *device = find_device(bus, addr);
+
+    if (!device && !has_fallback(bus, addr))
+        return nack(bus_id, addr);
+
+    simulith_i2c_msg_t msg = {.addr = addr, .len = 1 + len};
+    account(bus, transaction_ns(bus, &msg, 1));
+    return register_write(bus_id, device, addr, reg, data, len);
+}
+
+// A write message with only the register, completed by the read that follows it
+static bool is_register_select(const simulith_i2c_msg_t *msgs, size_t count, size_t i)
+{
+    return !(msgs[i].flags & SIMULITH_I2C_M_RD) && msgs[i].len == 1 && i + 1 < count &&
+           (msgs[i + 1].flags & SIMULITH_I2C_M_RD) && msgs[i + 1].addr == msgs[i].addr;
+}
+
+int simulith_i2c_transfer(uint8_t bus_id, const simulith_i2c_msg_t *msgs, size_t count)
+{
+    i2c_device_t *devices[SIMULITH_I2C_MAX_MSGS];
+
+    if (bus_id >= MAX_I2C_BUSES || !i2c_buses[bus_id].initialized)
+    {
+        simulith_log("Invalid or uninitialized I2C bus: %d\n", bus_id);
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (!msgs || count == 0 || count > SIMULITH_I2C_MAX_MSGS)
+    {
+        simulith_log("Invalid I2C transaction: %zu messages\n", count);
+        errno = EINVAL;
+        return -1;
+    }
+
+    i2c_bus_t *bus = &i2c_buses[bus_id];
+
+    // Check the whole transaction before any device sees it
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!msgs[i].buf || msgs[i].len == 0)
+        {
+            simulith_log("Invalid I2C message %zu\n", i);
+            errno = EINVAL;
+            return -1;
+        }
+
+        devices[i] = find_device(bus, msgs[i].addr);
+        if (!devices[i] && !has_fallback(bus, msgs[i].addr))
+            return nack(bus_id, msgs[i].addr);
+
+        if (devices[i] && devices[i]->ops.transfer)
+            continue;
+
+        // Register accesses: (register, data...) writes and register select + read pairs
+        bool is_read = msgs[i].flags & SIMULITH_I2C_M_RD;
+        if ((is_read && (i == 0 || !is_register_select(msgs, count, i - 1))) ||
+            (!is_read && msgs[i].len == 1 && !is_register_select(msgs, count, i)))
+        {
+            simulith_log("I2C%d: message %zu is not a register access\n", bus_id, i);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    account(bus, transaction_ns(bus, msgs, count));
+    for (size_t i = 0; i < count;)
+    {
+        const simulith_i2c_msg_t *msg    = &msgs[i];
+        i2c_device_t             *device = devices[i];
+        int                       result;
+
+        if (device && device->ops.transfer)
+        {
+            size_t n = 1;
+            while (i + n < count && msgs[i + n].addr == msg->addr)
+                n++;
+            result = device->ops.transfer(bus_id, msg->addr, msg, n, device->ctx);
+            i += n;
+        }
+        else if (is_register_select(msgs, count, i))
+        {
+            result = register_read(bus_id, device, msg->addr, msg->buf[0], msgs[i + 1].buf, msgs[i + 1].len);
+            i += 2;
+        }
+        else
+        {
+            result = register_write(bus_id, device, msg->addr, msg->buf[0], msg->buf + 1, msg->len - 1);
+            i++;
+        }
+
+        if (result < 0)
+            return -1;
+    }
+
+    return (int)count;
+}
+
+int simulith_i2c_set_speed(uint8_t bus_id, uint32_t speed_hz)
+{
+    if (bus_id >= MAX_I2C_BUSES || !i2c_buses[bus_id].initialized)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (speed_hz != 0 && (speed_hz < MIN_SPEED_HZ || speed_hz > SIMULITH_I2C_SPEED_HIGH))
+    {
+        simulith_log("Invalid I2C speed: %lu Hz\n", (unsigned long)speed_hz);
+        errno = EINVAL;
+        return -1;
+    }
+
+    i2c_bus_t *bus = &i2c_buses[bus_id];
+
+    memset(&bus->stats, 0, sizeof(bus->stats));
+    bus->speed_hz       = speed_hz;
+    bus->time_ns        = 0;
+    bus->window_busy_ns = 0;
+
+    simulith_log("I2C bus %d timing %s at %lu Hz\n", bus_id, speed_hz ? "enabled" : "disabled",
+                 (unsigned long)speed_hz);
+    return 0;
+}
+
+int simulith_i2c_set_clock_stretch(uint8_t bus_id, uint16_t addr, uint64_t stretch_ns)
+{
+    if (bus_id >= MAX_I2C_BUSES || !i2c_buses[bus_id].initialized)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    i2c_device_t *device = find_device(&i2c_buses[bus_id], addr);
+
+    if (!device)
+    {
+        errno = ENXIO;
+        return -1;
+    }
+
+    device->stretch_ns = stretch_ns;
+    return 0;
+}
+
+int64_t simulith_i2c_transaction_duration_ns(uint8_t bus_id, const simulith_i2c_msg_t *msgs, size_t count)
+{
+    if (bus_id >= MAX_I2C_BUSES || !i2c_buses[bus_id].initialized || !msgs || count == 0 ||
+        count > SIMULITH_I2C_MAX_MSGS)
+    {
+        return -1;
+    }
+
+    return (int64_t)transaction_ns(&i2c_buses[bus_id], msgs, count);
+}
+
+int simulith_i2c_advance(uint8_t bus_id, uint64_t now_ns)
+{
+    if (bus_id >= MAX_I2C_BUSES || !i2c_buses[bus_id].initialized)
+    {
+        return -1;
+    }
+
+    i2c_bus_t *bus = &i2c_buses[bus_id];
+
+    if (now_ns < bus->time_ns)
+    {
+        simulith_log("I2C%d cannot advance backwards to %llu ns\n", bus_id, (unsigned long long)now_ns);
+        return -1;
+    }
+
+    uint64_t interval = now_ns - bus->time_ns;
+    bool     overrun  = bus->window_busy_ns > interval;
+
+    bus->stats.time_ns += interval;
+    bus->stats.last_busy_ns = bus->window_busy_ns;
+    if (interval > 0)
+    {
+        bus->stats.last_utilization = (double)bus->window_busy_ns / (double)interval;
+    }
+
+    if (overrun)
+    {
+        bus->stats.overruns++;
+        simulith_log("I2C%d overrun: %llu ns of transactions in %llu ns\n", bus_id,
+                     (unsigned long long)bus->window_busy_ns, (unsigned long long)interval);
+    }
+
+    bus->time_ns        = now_ns;
+    bus->window_busy_ns = 0;
+    return overrun ? 1 : 0;
+}
+
+int simulith_i2c_get_stats(uint8_t bus_id, simulith_i2c_bus_stats_t *stats)
+{
+    if (bus_id >= MAX_I2C_BUSES || !i2c_buses[bus_id].initialized || !stats)
+    {
+        return -1;
+    }
+
+    i2c_bus_t *bus = &i2c_buses[bus_id];
+
+    *stats             = bus->stats;
+    stats->utilization = stats->time_ns ? (double)stats->busy_ns / (double)stats->time_ns : 0.0;
+    return 0;
+}
@@ -0,0 +1,269 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // posix_openpt, ptsname_r, cfmakeraw
+#endif
+
+#include "simulith_pty.h"
+#include "simulith.h"
+
+#define MAX_BRIDGES 8 // One per UART port
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+
+typedef struct
+{
+    bool                 active;
+    int                  fd;
+    uint8_t              rx[SIMULITH_PTY_BUFFER_SIZE]; // Read from the terminal, not yet injected
+    size_t               rx_len;
+    uint8_t              tx[SIMULITH_PTY_BUFFER_SIZE]; // Sent on the port, not yet written
+    size_t               tx_len;
+    uint64_t             time_ns;
+    uint64_t             credit_ns;
+    simulith_pty_stats_t stats;
+} pty_bridge_t;
+
+static pty_bridge_t bridges[MAX_BRIDGES] = {0};
+
+static pty_bridge_t *get_bridge(uint8_t port_id)
+{
+    if (port_id >= MAX_BRIDGES || !bridges[port_id].active)
+        return NULL;
+    return &bridges[port_id];
+}
+
+// Receive callback of bridged ports, keeps sent data for the next tick
+static int port_to_buffer(uint8_t port_id, const uint8_t *data, size_t len)
+{
+    pty_bridge_t *bridge = get_bridge(port_id);
+
+    if (!bridge)
+    {
+        return -1;
+    }
+
+    size_t count = SIMULITH_PTY_BUFFER_SIZE - bridge->tx_len;
+    if (count > len)
+        count = len;
+
+    memcpy(&bridge->tx[bridge->tx_len], data, count);
+    bridge->tx_len += count;
+    bridge->stats.dropped += len - count;
+    return (int)count;
+}
+
+int simulith_pty_open(uint8_t port_id, char *path, size_t path_len)
+{
+    struct termios tio;
+    char           name[64];
+
+    if (port_id >= MAX_BRIDGES || bridges[port_id].active)
+    {
+        return -1;
+    }
+
+    int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        simulith_log("UART%d cannot open a pseudo-terminal: %s\n", port_id, strerror(errno));
+        return -1;
+    }
+
+    // Serial software expects the bytes on the line, no echo or line editing
+    if (grantpt(fd) < 0 || unlockpt(fd) < 0 || ptsname_r(fd, name, sizeof(name)) != 0 || tcgetattr(fd, &tio) < 0)
+    {
+        simulith_log("UART%d pseudo-terminal setup failed: %s\n", port_id, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    if (tcsetattr(fd, TCSANOW, &tio) < 0 || simulith_uart_set_callback(port_id, port_to_buffer) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    if (path && path_len > 0)
+    {
+        snprintf(path, path_len, "%s", name);
+    }
+
+    memset(&bridges[port_id], 0, sizeof(bridges[port_id]));
+    bridges[port_id].fd     = fd;
+    bridges[port_id].active = true;
+
+    simulith_log("UART%d bridged to %s\n", port_id, name);
+    return 0;
+}
+
+// Inject the data written to the terminal, as much as the line carried since the last tick
+static int terminal_to_port(uint8_t port_id, pty_bridge_t *bridge, const simulith_uart_stats_t *uart, uint64_t elapsed)
+{
+    size_t room     = SIMULITH_PTY_BUFFER_SIZE - bridge->rx_len;
+    size_t read_len = 0;
+
+    if (uart->pacing)
+    {
+        // Saved up time is capped by the buffer, so it cannot overflow
+        bridge->credit_ns += elapsed;
+        if (bridge->credit_ns > SIMULITH_PTY_BUFFER_SIZE * uart->char_time_ns)
+            bridge->credit_ns = SIMULITH_PTY_BUFFER_SIZE * uart->char_time_ns;
+        if (room > bridge->credit_ns / uart->char_time_ns)
+            room = bridge->credit_ns / uart->char_time_ns;
+    }
+
+    while (read_len < room)
+    {
+        ssize_t n = read(bridge->fd, &bridge->rx[bridge->rx_len + read_len], room - read_len);
+        if (n > 0)
+        {
+            read_len += n;
+            continue;
+        }
+
+        // EIO means nobody has the terminal open, which is an idle line as well
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EIO)
+        {
+            simulith_log("UART%d terminal read failed: %s\n", port_id, strerror(errno));
+            return -1;
+        }
+
+        // An idle line does not save up time for later bytes
+        bridge->credit_ns = 0;
+        break;
+    }
+
+    if (uart->pacing && bridge->credit_ns > 0)
+    {
+        bridge->credit_ns -= read_len * uart->char_time_ns;
+    }
+    bridge->rx_len += read_len;
+
+    // What does not fit in the receive buffer stays for the next tick
+    int injected = simulith_uart_inject(port_id, bridge->rx, bridge->rx_len);
+    if (injected < 0)
+    {
+        return -1;
+    }
+    memmove(bridge->rx, &bridge->rx[injected], bridge->rx_len - injected);
+    bridge->rx_len -= injected;
+    bridge->stats.rx_bytes += injected;
+    return injected;
+}
+
+// Write the data sent on the port to the terminal
+static int buffer_to_terminal(uint8_t port_id, pty_bridge_t *bridge)
+{
+    size_t written = 0;
+
+    while (written < bridge->tx_len)
+    {
+        ssize_t n = write(bridge->fd, &bridge->tx[written], bridge->tx_len - written);
+        if (n > 0)
+        {
+            written += n;
+            continue;
+        }
+
+        // A full terminal keeps the rest for the next tick
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            simulith_log("UART%d terminal write failed: %s\n", port_id, strerror(errno));
+            bridge->stats.dropped += bridge->tx_len - written;
+            bridge->tx_len = 0;
+            return -1;
+        }
+        break;
+    }
+
+    memmove(bridge->tx, &bridge->tx[written], bridge->tx_len - written);
+    bridge->tx_len -= written;
+    bridge->stats.tx_bytes += written;
+    return (int)written;
+}
+
+int simulith_pty_tick(uint8_t port_id, uint64_t now_ns)
+{
+    pty_bridge_t         *bridge = get_bridge(port_id);
+    simulith_uart_stats_t uart;
+
+    if (!bridge || simulith_uart_get_stats(port_id, &uart) < 0)
+    {
+        return -1;
+    }
+
+    uint64_t elapsed = (now_ns > bridge->time_ns) ? now_ns - bridge->time_ns : 0;
+    bridge->time_ns  = now_ns;
+
+    int received = terminal_to_port(port_id, bridge, &uart, elapsed);
+    if (received < 0 || simulith_uart_advance(port_id, now_ns) < 0)
+    {
+        return -1;
+    }
+
+    int sent = buffer_to_terminal(port_id, bridge);
+    if (sent < 0)
+    {
+        return -1;
+    }
+    return received + sent;
+}
+
+int simulith_pty_get_stats(uint8_t port_id, simulith_pty_stats_t *stats)
+{
+    pty_bridge_t *bridge = get_bridge(port_id);
+
+    if (!bridge || !stats)
+    {
+        return -1;
+    }
+
+    *stats = bridge->stats;
+    return 0;
+}
+
+int simulith_pty_close(uint8_t port_id)
+{
+    pty_bridge_t *bridge = get_bridge(port_id);
+
+    if (!bridge)
+    {
+        return -1;
+    }
+
+    // The port may already be closed
+    simulith_uart_set_callback(port_id, NULL);
+    close(bridge->fd);
+    bridge->active = false;
+
+    simulith_log("UART%d terminal closed\n", port_id);
+    return 0;
+}
+
+#else // !(__unix__ || __APPLE__)
+
+int simulith_pty_open(uint8_t port_id, char *path, size_t path_len)
+{
+    simulith_log("Pseudo-terminals are only available on POSIX systems\n");
+    return -1;
+}
+
+int simulith_pty_tick(uint8_t port_id, uint64_t now_ns)
+{
+    return -1;
+}
+
+int simulith_pty_get_stats(uint8_t port_id, simulith_pty_stats_t *stats)
+{
+    return -1;
+}
+
+int simulith_pty_close(uint8_t port_id)
+{
+    return -1;
+}
+
+#endif // __unix__ || __APPLE__
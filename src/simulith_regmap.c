@@ -0,0 +1,365 @@
+#include "simulith_regmap.h"
+#include "simulith.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define REGMAP_MAGIC    0x524D4150 // "RMAP"
+#define REGMAP_NAME_LEN 64
+
+// Segment layout, shared between processes
+typedef struct
+{
+    _Atomic uint32_t magic; // Stored last when the segment is created
+    uint32_t         size;
+    _Atomic uint32_t sequence; // Odd while an update is in progress
+    _Atomic uint8_t  registers[];
+} regmap_shared_t;
+
+typedef struct
+{
+    bool             active;
+    bool             owner; // Created the segment, removes it on close
+    char             name[REGMAP_NAME_LEN];
+    regmap_shared_t *shared;
+    size_t           map_size;
+} regmap_t;
+
+static regmap_t regmaps[SIMULITH_REGMAP_MAX_MAPS] = {0};
+
+static regmap_t *get_regmap(int regmap_id)
+{
+    if (regmap_id < 0 || regmap_id >= SIMULITH_REGMAP_MAX_MAPS || !regmaps[regmap_id].active)
+        return NULL;
+    return &regmaps[regmap_id];
+}
+
+static int map_segment(const char *name, int fd, bool owner)
+{
+    struct stat st;
+    int         regmap_id = -1;
+
+    for (int i = 0; i < SIMULITH_REGMAP_MAX_MAPS; i++)
+    {
+        if (!regmaps[i].active)
+        {
+            regmap_id = i;
+            break;
+        }
+    }
+    if (regmap_id < 0)
+    {
+        simulith_log("No free register map for %s\n", name);
+        return -1;
+    }
+
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(regmap_shared_t))
+    {
+        simulith_log("Register map %s is not a register map\n", name);
+        return -1;
+    }
+
+    regmap_shared_t *shared = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (shared == MAP_FAILED)
+    {
+        simulith_log("Cannot map register map %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+
+    if (!owner && (atomic_load_explicit(&shared->magic, memory_order_acquire) != REGMAP_MAGIC ||
+                   sizeof(regmap_shared_t) + shared->size > (size_t)st.st_size))
+    {
+        simulith_log("Register map %s is not a register map\n", name);
+        munmap(shared, st.st_size);
+        return -1;
+    }
+
+    regmap_t *regmap = &regmaps[regmap_id];
+    memset(regmap, 0, sizeof(*regmap));
+    strcpy(regmap->name, name);
+    regmap->owner    = owner;
+    regmap->shared   = shared;
+    regmap->map_size = st.st_size;
+    regmap->active   = true;
+    return regmap_id;
+}
+
+int simulith_regmap_create(const char *name, size_t size)
+{
+    if (!name || name[0] != '/' || strlen(name) >= REGMAP_NAME_LEN || size == 0 || size > UINT32_MAX)
+    {
+        simulith_log("Invalid register map\n");
+        return -1;
+    }
+
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0)
+    {
+        simulith_log("Cannot create register map %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+
+    // Truncating first zeroes a segment left over by an earlier run
+    if (ftruncate(fd, 0) < 0 || ftruncate(fd, sizeof(regmap_shared_t) + size) < 0)
+    {
+        simulith_log("Cannot size register map %s: %s\n", name, strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+
+    int regmap_id = map_segment(name, fd, true);
+    close(fd);
+    if (regmap_id < 0)
+    {
+        shm_unlink(name);
+        return -1;
+    }
+
+    regmap_shared_t *shared = regmaps[regmap_id].shared;
+
+    // Sized and zeroed, the magic number makes it valid for other processes once the rest is visible
+    shared->size = size;
+    atomic_init(&shared->sequence, 0);
+    atomic_store_explicit(&shared->magic, REGMAP_MAGIC, memory_order_release);
+
+    simulith_log("Register map %d: %s, %zu bytes\n", regmap_id, name, size);
+    return regmap_id;
+}
+
+int simulith_regmap_open(const char *name)
+{
+    if (!name || strlen(name) >= REGMAP_NAME_LEN)
+    {
+        return -1;
+    }
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        simulith_log("Cannot open register map %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+
+    int regmap_id = map_segment(name, fd, false);
+    close(fd);
+    if (regmap_id >= 0)
+    {
+        simulith_log("Register map %d: %s opened\n", regmap_id, name);
+    }
+    return regmap_id;
+}
+
+// Registers are copied with relaxed atomic accesses, the sequence orders them. A process that
+// dies in the middle of an update leaves the sequence odd, so both sides give up after a while.
+static int write_registers(regmap_shared_t *shared, size_t offset, const uint8_t *data, size_t len)
+{
+    uint32_t sequence = atomic_load_explicit(&shared->sequence, memory_order_relaxed);
+    int      spins    = 0;
+
+    // Writers take the lock by making the sequence odd
+    while ((sequence & 1) ||
+           !atomic_compare_exchange_weak_explicit(&shared->sequence, &sequence, sequence + 1, memory_order_acquire,
+                                                  memory_order_relaxed))
+    {
+        if (++spins == SIMULITH_REGMAP_SPINS)
+        {
+            simulith_log("Register map update still in progress, write dropped\n");
+            return -1;
+        }
+        sched_yield();
+        sequence = atomic_load_explicit(&shared->sequence, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+
+    for (size_t i = 0; i < len; i++)
+        atomic_store_explicit(&shared->registers[offset + i], data[i], memory_order_relaxed);
+
+    atomic_store_explicit(&shared->sequence, sequence + 2, memory_order_release);
+    return 0;
+}
+
+static int read_registers(regmap_shared_t *shared, size_t offset, uint8_t *data, size_t len)
+{
+    for (int spins = 0; spins < SIMULITH_REGMAP_SPINS; spins++)
+    {
+        uint32_t sequence = atomic_load_explicit(&shared->sequence, memory_order_acquire);
+
+        if (!(sequence & 1))
+        {
+            for (size_t i = 0; i < len; i++)
+                data[i] = atomic_load_explicit(&shared->registers[offset + i], memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&shared->sequence, memory_order_relaxed) == sequence)
+                return 0;
+        }
+        sched_yield();
+    }
+
+    simulith_log("Register map update still in progress, read failed\n");
+    return -1;
+}
+
+static bool in_range(const regmap_t *regmap, size_t offset, size_t len)
+{
+    return offset <= regmap->shared->size && len <= regmap->shared->size - offset;
+}
+
+int simulith_regmap_write(int regmap_id, size_t offset, const void *data, size_t len)
+{
+    regmap_t *regmap = get_regmap(regmap_id);
+
+    if (!regmap || !data || !in_range(regmap, offset, len))
+    {
+        return -1;
+    }
+
+    return write_registers(regmap->shared, offset, data, len);
+}
+
+int simulith_regmap_read(int regmap_id, size_t offset, void *data, size_t len)
+{
+    regmap_t *regmap = get_regmap(regmap_id);
+
+    if (!regmap || !data || !in_range(regmap, offset, len))
+    {
+        return -1;
+    }
+
+    return read_registers(regmap->shared, offset, data, len);
+}
+
+uint32_t simulith_regmap_updates(int regmap_id)
+{
+    regmap_t *regmap = get_regmap(regmap_id);
+
+    return regmap ? atomic_load_explicit(&regmap->shared->sequence, memory_order_acquire) / 2 : 0;
+}
+
+static int regmap_i2c_read(uint8_t bus_id, uint16_t addr, uint8_t reg, uint8_t *data, size_t len, void *ctx)
+{
+    regmap_t *regmap = ctx;
+
+    if (!in_range(regmap, reg, len))
+        return -1;
+    return read_registers(regmap->shared, reg, data, len);
+}
+
+static int regmap_i2c_write(uint8_t bus_id, uint16_t addr, uint8_t reg, const uint8_t *data, size_t len, void *ctx)
+{
+    regmap_t *regmap = ctx;
+
+    if (!in_range(regmap, reg, len))
+        return -1;
+    return write_registers(regmap->shared, reg, data, len);
+}
+
+int simulith_regmap_attach_i2c(int regmap_id, uint8_t bus_id, uint16_t addr)
+{
+    const simulith_i2c_device_ops_t ops    = {.read = regmap_i2c_read, .write = regmap_i2c_write};
+    regmap_t                       *regmap = get_regmap(regmap_id);
+
+    if (!regmap)
+    {
+        return -1;
+    }
+    return simulith_i2c_attach(bus_id, addr, &ops, regmap);
+}
+
+static int regmap_spi_read(uint8_t bus_id, uint8_t cs_id, size_t reg, uint8_t *data, size_t len, void *ctx)
+{
+    regmap_t *regmap = ctx;
+
+    return read_registers(regmap->shared, reg, data, len);
+}
+
+static int regmap_spi_write(uint8_t bus_id, uint8_t cs_id, size_t reg, const uint8_t *data, size_t len, void *ctx)
+{
+    regmap_t *regmap = ctx;
+
+    return write_registers(regmap->shared, reg, data, len);
+}
+
+int simulith_regmap_attach_spi(int regmap_id, uint8_t bus_id, uint8_t cs_id)
+{
+    const simulith_spi_register_ops_t ops    = {.read = regmap_spi_read, .write = regmap_spi_write};
+    regmap_t                         *regmap = get_regmap(regmap_id);
+
+    if (!regmap)
+    {
+        return -1;
+    }
+    return simulith_spi_attach_registers(bus_id, cs_id, regmap->shared->size, &ops, regmap);
+}
+
+int simulith_regmap_close(int regmap_id)
+{
+    regmap_t *regmap = get_regmap(regmap_id);
+
+    if (!regmap)
+    {
+        return -1;
+    }
+
+    munmap(regmap->shared, regmap->map_size);
+    if (regmap->owner)
+    {
+        shm_unlink(regmap->name);
+    }
+    regmap->active = false;
+
+    simulith_log("Register map %d closed\n", regmap_id);
+    return 0;
+}
+
+#else // !(__unix__ || __APPLE__)
+
+int simulith_regmap_create(const char *name, size_t size)
+{
+    simulith_log("Register maps are only available on POSIX systems\n");
+    return -1;
+}
+
+int simulith_regmap_open(const char *name)
+{
+    simulith_log("Register maps are only available on POSIX systems\n");
+    return -1;
+}
+
+int simulith_regmap_write(int regmap_id, size_t offset, const void *data, size_t len)
+{
+    return -1;
+}
+
+int simulith_regmap_read(int regmap_id, size_t offset, void *data, size_t len)
+{
+    return -1;
+}
+
+uint32_t simulith_regmap_updates(int regmap_id)
+{
+    return 0;
+}
+
+int simulith_regmap_attach_i2c(int regmap_id, uint8_t bus_id, uint16_t addr)
+{
+    return -1;
+}
+
+int simulith_regmap_attach_spi(int regmap_id, uint8_t bus_id, uint8_t cs_id)
+{
+    return -1;
+}
+
+int simulith_regmap_close(int regmap_id)
+{
+    return -1;
+}
+
+#endif // __unix__ || __APPLE__
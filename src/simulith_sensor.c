@@ -0,0 +1,186 @@
+#include "simulith_sensor.h"
+#include "simulith.h"
+
+typedef struct
+{
+    bool                     active;
+    simulith_sensor_config_t config;
+    uint8_t                  registers[SIMULITH_SENSOR_MAX_REGS];
+    bool                     sampled;     // Registers hold a sample taken at sample_time
+    uint64_t                 sample_time; // Simulation time of the cached sample
+    simulith_sensor_stats_t  stats;
+} sensor_t;
+
+static sensor_t sensors[SIMULITH_SENSOR_MAX_SENSORS] = {0};
+static uint64_t sensor_time_ns                       = 0;
+
+static sensor_t *get_sensor(int sensor_id)
+{
+    if (sensor_id < 0 || sensor_id >= SIMULITH_SENSOR_MAX_SENSORS || !sensors[sensor_id].active)
+        return NULL;
+    return &sensors[sensor_id];
+}
+
+int simulith_sensor_create(const simulith_sensor_config_t *config)
+{
+    if (!config || !config->sample || config->size == 0 || config->size > SIMULITH_SENSOR_MAX_REGS)
+    {
+        simulith_log("Invalid sensor configuration\n");
+        return -1;
+    }
+
+    for (int i = 0; i < SIMULITH_SENSOR_MAX_SENSORS; i++)
+    {
+        if (!sensors[i].active)
+        {
+            memset(&sensors[i], 0, sizeof(sensors[i]));
+            sensors[i].config = *config;
+            sensors[i].active = true;
+            return i;
+        }
+    }
+
+    simulith_log("No free sensor\n");
+    return -1;
+}
+
+void simulith_sensor_advance(uint64_t now_ns)
+{
+    sensor_time_ns = now_ns;
+}
+
+// Sample only when the software looks and the cached sample has expired
+static int refresh(sensor_t *sensor)
+{
+    uint64_t period = sensor->config.period_ns ? sensor->config.period_ns : 1;
+
+    if (sensor->sampled && sensor_time_ns >= sensor->sample_time && sensor_time_ns - sensor->sample_time < period)
+    {
+        return 0;
+    }
+
+    // Samples fall on the output data period, like the conversions of the real part
+    uint64_t time_ns = sensor_time_ns - sensor_time_ns % period;
+    if (sensor->config.sample(time_ns, sensor->registers, sensor->config.size, sensor->config.ctx) < 0)
+    {
+        return -1;
+    }
+
+    sensor->sampled     = true;
+    sensor->sample_time = time_ns;
+    sensor->stats.samples++;
+    return 0;
+}
+
+static int read_registers(sensor_t *sensor, uint8_t reg, uint8_t *data, size_t len)
+{
+    if (reg >= sensor->config.size || len > sensor->config.size - reg || refresh(sensor) < 0)
+        return -1;
+
+    memcpy(data, &sensor->registers[reg], len);
+    sensor->stats.reads++;
+    return 0;
+}
+
+static int write_registers(sensor_t *sensor, uint8_t reg, const uint8_t *data, size_t len)
+{
+    if (reg >= sensor->config.size || len > sensor->config.size - reg)
+        return -1;
+
+    // A configuration change shows in the next sample
+    memcpy(&sensor->registers[reg], data, len);
+    sensor->sampled = false;
+    return 0;
+}
+
+int simulith_sensor_read(int sensor_id, uint8_t reg, uint8_t *data, size_t len)
+{
+    sensor_t *sensor = get_sensor(sensor_id);
+
+    if (!sensor || !data)
+    {
+        return -1;
+    }
+    return read_registers(sensor, reg, data, len);
+}
+
+int simulith_sensor_write(int sensor_id, uint8_t reg, const uint8_t *data, size_t len)
+{
+    sensor_t *sensor = get_sensor(sensor_id);
+
+    if (!sensor || !data)
+    {
+        return -1;
+    }
+    return write_registers(sensor, reg, data, len);
+}
+
+static int sensor_i2c_read(uint8_t bus_id, uint16_t addr, uint8_t reg, uint8_t *data, size_t len, void *ctx)
+{
+    return read_registers(ctx, reg, data, len);
+}
+
+static int sensor_i2c_write(uint8_t bus_id, uint16_t addr, uint8_t reg, const uint8_t *data, size_t len, void *ctx)
+{
+    return write_registers(ctx, reg, data, len);
+}
+
+int simulith_sensor_attach_i2c(int sensor_id, uint8_t bus_id, uint16_t addr)
+{
+    const simulith_i2c_device_ops_t ops    = {.read = sensor_i2c_read, .write = sensor_i2c_write};
+    sensor_t                       *sensor = get_sensor(sensor_id);
+
+    if (!sensor)
+    {
+        return -1;
+    }
+    return simulith_i2c_attach(bus_id, addr, &ops, sensor);
+}
+
+static int sensor_spi_read(uint8_t bus_id, uint8_t cs_id, size_t reg, uint8_t *data, size_t len, void *ctx)
+{
+    return read_registers(ctx, (uint8_t)reg, data, len);
+}
+
+static int sensor_spi_write(uint8_t bus_id, uint8_t cs_id, size_t reg, const uint8_t *data, size_t len, void *ctx)
+{
+    return write_registers(ctx, (uint8_t)reg, data, len);
+}
+
+int simulith_sensor_attach_spi(int sensor_id, uint8_t bus_id, uint8_t cs_id)
+{
+    const simulith_spi_register_ops_t ops    = {.read = sensor_spi_read, .write = sensor_spi_write};
+    sensor_t                         *sensor = get_sensor(sensor_id);
+
+    if (!sensor)
+    {
+        return -1;
+    }
+    return simulith_spi_attach_registers(bus_id, cs_id, sensor->config.size, &ops, sensor);
+}
+
+int simulith_sensor_get_stats(int sensor_id, simulith_sensor_stats_t *stats)
+{
+    sensor_t *sensor = get_sensor(sensor_id);
+
+    if (!sensor || !stats)
+    {
+        return -1;
+    }
+
+    *stats = sensor->stats;
+    return 0;
+}
+
+int simulith_sensor_destroy(int sensor_id)
+{
+    sensor_t *sensor = get_sensor(sensor_id);
+
+    if (!sensor)
+    {
+        return -1;
+    }
+
+    sensor->active = false;
+    return 0;
+}
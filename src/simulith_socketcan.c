@@ -0,0 +1,349 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // recvmmsg, sendmmsg
+#endif
+
+#include "simulith_socketcan.h"
+#include "simulith.h"
+
+#define MAX_BRIDGES 8 // One per CAN bus
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+typedef struct
+{
+    bool                       active;
+    int                        fd;
+    int                        node_id;
+    uint32_t                   generation;   // Bus generation the node belongs to
+    uint64_t                   node_dropped; // Node queue drops already counted in stats
+    simulith_socketcan_stats_t stats;
+} can_bridge_t;
+
+static can_bridge_t bridges[MAX_BRIDGES] = {0};
+
+static can_bridge_t *get_bridge(uint8_t bus_id)
+{
+    if (bus_id >= MAX_BRIDGES || !bridges[bus_id].active)
+        return NULL;
+    return &bridges[bus_id];
+}
+
+// Convert a datagram from the socket, false for error frames and unknown sizes
+static bool frame_from_socket(const struct canfd_frame *frame, size_t size, simulith_can_fd_message_t *msg)
+{
+    if ((size != CAN_MTU && size != CANFD_MTU) || (frame->can_id & CAN_ERR_FLAG))
+        return false;
+
+    memset(msg, 0, sizeof(*msg));
+    msg->is_extended = (frame->can_id & CAN_EFF_FLAG) ? 1 : 0;
+    msg->id          = frame->can_id & (msg->is_extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+    msg->len         = frame->len;
+
+    if (size == CANFD_MTU)
+    {
+        msg->flags = SIMULITH_CAN_FLAG_FDF;
+        msg->flags |= (frame->flags & CANFD_BRS) ? SIMULITH_CAN_FLAG_BRS : 0;
+        msg->flags |= (frame->flags & CANFD_ESI) ? SIMULITH_CAN_FLAG_ESI : 0;
+    }
+    else if (frame->can_id & CAN_RTR_FLAG)
+    {
+        msg->flags = SIMULITH_CAN_FLAG_RTR;
+        return true;
+    }
+
+    if (msg->len > sizeof(msg->data))
+        return false;
+    memcpy(msg->data, frame->data, msg->len);
+    return true;
+}
+
+// Convert a bus frame to a socket datagram, returns its size
+static size_t frame_to_socket(const simulith_can_fd_message_t *msg, struct canfd_frame *frame)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->can_id = msg->id | (msg->is_extended ? CAN_EFF_FLAG : 0);
+    frame->len    = msg->len;
+    memcpy(frame->data, msg->data, msg->len);
+
+    if (!(msg->flags & SIMULITH_CAN_FLAG_FDF))
+    {
+        frame->can_id |= (msg->flags & SIMULITH_CAN_FLAG_RTR) ? CAN_RTR_FLAG : 0;
+        return CAN_MTU;
+    }
+
+    frame->flags |= (msg->flags & SIMULITH_CAN_FLAG_BRS) ? CANFD_BRS : 0;
+    frame->flags |= (msg->flags & SIMULITH_CAN_FLAG_ESI) ? CANFD_ESI : 0;
+    return CANFD_MTU;
+}
+
+int simulith_socketcan_attach_fd(uint8_t bus_id, int fd)
+{
+    if (bus_id >= MAX_BRIDGES || bridges[bus_id].active || fd < 0)
+    {
+        return -1;
+    }
+
+    int node_id = simulith_can_attach(bus_id, NULL);
+    if (node_id < 0)
+    {
+        return -1;
+    }
+
+    // The bridge forwards everything, filtering is up to the software on the socket
+    simulith_can_filter_t std_filter = {.id = 0, .mask = 0, .is_extended = 0};
+    simulith_can_filter_t ext_filter = {.id = 0, .mask = 0, .is_extended = 1};
+    if (simulith_can_node_add_filter(bus_id, node_id, &std_filter, NULL, NULL) < 0 ||
+        simulith_can_node_add_filter(bus_id, node_id, &ext_filter, NULL, NULL) < 0)
+    {
+        simulith_can_detach(bus_id, node_id);
+        return -1;
+    }
+
+    bridges[bus_id].fd           = fd;
+    bridges[bus_id].node_id      = node_id;
+    bridges[bus_id].generation   = simulith_can_get_generation(bus_id);
+    bridges[bus_id].node_dropped = 0;
+    memset(&bridges[bus_id].stats, 0, sizeof(bridges[bus_id].stats));
+    bridges[bus_id].active = true;
+
+    simulith_log("CAN%d bridged to socket %d as node %d\n", bus_id, fd, node_id);
+    return 0;
+}
+
+int simulith_socketcan_open(uint8_t bus_id, const char *ifname)
+{
+    struct sockaddr_can addr   = {0};
+    int                 enable = 1;
+
+    if (bus_id >= MAX_BRIDGES || bridges[bus_id].active || !ifname)
+    {
+        return -1;
+    }
+
+    int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (fd < 0)
+    {
+        simulith_log("CAN%d SocketCAN socket failed: %s\n", bus_id, strerror(errno));
+        return -1;
+    }
+
+    // Classic frames still work on interfaces without CAN FD
+    if (setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) < 0)
+    {
+        simulith_log("CAN%d %s does not support CAN FD frames\n", bus_id, ifname);
+    }
+
+    addr.can_family  = AF_CAN;
+    addr.can_ifindex = if_nametoindex(ifname);
+    if (addr.can_ifindex == 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        simulith_log("CAN%d cannot bind to %s: %s\n", bus_id, ifname, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (simulith_socketcan_attach_fd(bus_id, fd) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+// Send the frames written to the socket since the last tick on the bus
+static int socket_to_bus(uint8_t bus_id, can_bridge_t *bridge)
+{
+    struct canfd_frame frames[SIMULITH_SOCKETCAN_BATCH];
+    struct iovec       iov[SIMULITH_SOCKETCAN_BATCH];
+    struct mmsghdr     msgs[SIMULITH_SOCKETCAN_BATCH];
+    int                moved = 0;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < SIMULITH_SOCKETCAN_BATCH; i++)
+    {
+        iov[i].iov_base            = &frames[i];
+        iov[i].iov_len             = sizeof(frames[i]);
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (true)
+    {
+        int count = recvmmsg(bridge->fd, msgs, SIMULITH_SOCKETCAN_BATCH, MSG_DONTWAIT, NULL);
+        if (count < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            simulith_log("CAN%d bridge receive failed: %s\n", bus_id, strerror(errno));
+            return -1;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            simulith_can_fd_message_t msg;
+            if (!frame_from_socket(&frames[i], msgs[i].msg_len, &msg) ||
+                simulith_can_node_send(bus_id, bridge->node_id, &msg) < 0)
+            {
+                bridge->stats.dropped++;
+                continue;
+            }
+            bridge->stats.rx_frames++;
+            moved++;
+        }
+
+        if (count < SIMULITH_SOCKETCAN_BATCH)
+            break;
+    }
+    return moved;
+}
+
+// Write the frames received on the bus to the socket
+static int bus_to_socket(uint8_t bus_id, can_bridge_t *bridge)
+{
+    struct canfd_frame frames[SIMULITH_SOCKETCAN_BATCH];
+    struct iovec       iov[SIMULITH_SOCKETCAN_BATCH];
+    struct mmsghdr     msgs[SIMULITH_SOCKETCAN_BATCH];
+    int                moved = 0;
+    uint64_t           dropped;
+
+    // Frames beyond the node queue between two ticks never reach the bridge, count them too
+    if (simulith_can_node_get_dropped(bus_id, bridge->node_id, &dropped) == 0)
+    {
+        bridge->stats.dropped += dropped - bridge->node_dropped;
+        bridge->node_dropped = dropped;
+    }
+
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < SIMULITH_SOCKETCAN_BATCH; i++)
+    {
+        iov[i].iov_base            = &frames[i];
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (true)
+    {
+        simulith_can_fd_message_t msg;
+        int                       count = 0;
+        int                       sent  = 0;
+
+        while (count < SIMULITH_SOCKETCAN_BATCH && simulith_can_node_receive(bus_id, bridge->node_id, &msg) == 1)
+        {
+            iov[count].iov_len = frame_to_socket(&msg, &frames[count]);
+            count++;
+        }
+        if (count == 0)
+            break;
+
+        while (sent < count)
+        {
+            int n = sendmmsg(bridge->fd, &msgs[sent], count - sent, MSG_DONTWAIT);
+            if (n < 0)
+            {
+                // A full transmit queue drops the rest of the batch, like a bus without a listener
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS)
+                    simulith_log("CAN%d bridge send failed: %s\n", bus_id, strerror(errno));
+                bridge->stats.dropped += count - sent;
+                break;
+            }
+            sent += n;
+        }
+
+        bridge->stats.tx_frames += sent;
+        moved += sent;
+
+        if (count < SIMULITH_SOCKETCAN_BATCH)
+            break;
+    }
+    return moved;
+}
+
+int simulith_socketcan_tick(uint8_t bus_id)
+{
+    can_bridge_t *bridge = get_bridge(bus_id);
+
+    if (!bridge)
+    {
+        return -1;
+    }
+
+    int received = socket_to_bus(bus_id, bridge);
+    if (received < 0)
+    {
+        return -1;
+    }
+
+    return received + bus_to_socket(bus_id, bridge);
+}
+
+int simulith_socketcan_get_stats(uint8_t bus_id, simulith_socketcan_stats_t *stats)
+{
+    can_bridge_t *bridge = get_bridge(bus_id);
+
+    if (!bridge || !stats)
+    {
+        return -1;
+    }
+
+    *stats = bridge->stats;
+    return 0;
+}
+
+int simulith_socketcan_close(uint8_t bus_id)
+{
+    can_bridge_t *bridge = get_bridge(bus_id);
+
+    if (!bridge)
+    {
+        return -1;
+    }
+
+    // Once the bus is closed the node is gone, and after a new simulith_can_init the same
+    // node identifier may belong to someone else
+    if (simulith_can_get_generation(bus_id) == bridge->generation)
+    {
+        simulith_can_detach(bus_id, bridge->node_id);
+    }
+    close(bridge->fd);
+    bridge->active = false;
+
+    simulith_log("CAN%d bridge closed\n", bus_id);
+    return 0;
+}
+
+#else // !__linux__
+
+int simulith_socketcan_open(uint8_t bus_id, const char *ifname)
+{
+    simulith_log("SocketCAN is only available on Linux\n");
+    return -1;
+}
+
+int simulith_socketcan_attach_fd(uint8_t bus_id, int fd)
+{
+    simulith_log("SocketCAN is only available on Linux\n");
+    return -1;
+}
+
+int simulith_socketcan_tick(uint8_t bus_id)
+{
+    return -1;
+}
+
+int simulith_socketcan_get_stats(uint8_t bus_id, simulith_socketcan_stats_t *stats)
+{
+    return -1;
+}
+
+int simulith_socketcan_close(uint8_t bus_id)
+{
+    return -1;
+}
+
+#endif // __linux__
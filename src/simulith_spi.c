@@ -1,15 +1,35 @@
 #include "simulith_spi.h"
 #include "simulith.h"
+#include "simulith_crc.h"
+#include <limits.h>
 #include <string.h>
 
 #define MAX_SPI_BUSES 8
 #define MAX_DATA_BITS 16
+#define MAX_LOG_BYTES 64 // Longer transfers are logged without their data
+
+typedef struct
+{
+    simulith_spi_device_callback callback;
+    simulith_spi_stream_callback stream_callback;
+    simulith_spi_register_ops_t  registers; // Register device when registers.read is set
+    simulith_spi_cs_callback     cs_callback;
+    void                        *ctx;
+    size_t                       cursor; // Bytes since the chip select was asserted
+    uint8_t                      crc;    // CRC field checked on data received from the device
+
+    // Register command state, reset when the chip select is asserted
+    size_t reg_count;
+    size_t reg;      // Register of the next data byte
+    bool   reg_read; // The command byte had SIMULITH_SPI_REG_READ set
+} spi_device_t;
 
 typedef struct
 {
     bool                           initialized;
     simulith_spi_config_t          config;
     simulith_spi_transfer_callback transfer_callback;
+    spi_device_t                   devices[SIMULITH_SPI_MAX_CS]; // Indexed by chip select
 } spi_bus_t;
 
 static spi_bus_t spi_buses[MAX_SPI_BUSES] = {0};
@@ -56,12 +76,6 @@ int simulith_spi_init(uint8_t bus_id, const simulith_spi_config_t *config, simul
         return -1;
     }
 
-    if (!transfer_cb)
-    {
-        simulith_log("Transfer callback cannot be NULL\n");
-        return -1;
-    }
-
     spi_bus_t *bus = &spi_buses[bus_id];
 
     if (bus->initialized)
@@ -73,7 +87,8 @@ int simulith_spi_init(uint8_t bus_id, const simulith_spi_config_t *config, simul
     // Initialize bus structure
     memcpy(&bus->config, config, sizeof(simulith_spi_config_t));
     bus->transfer_callback = transfer_cb;
-    bus->initialized       = true;
+    memset(bus->devices, 0, sizeof(bus->devices));
+    bus->initialized = true;
 
     simulith_log("SPI bus %d initialized: %lu Hz, mode %d, %d bits %s first\n", bus_id, (unsigned long)config->clock_hz,
                  config->mode, config->data_bits, config->bit_order == SIMULITH_SPI_MSB_FIRST ? "MSB" : "LSB");
@@ -81,6 +96,184 @@ int simulith_spi_init(uint8_t bus_id, const simulith_spi_config_t *config, simul
     return 0;
 }
 
+static bool has_device(const spi_device_t *device)
+{
+    return device->callback || device->stream_callback || device->registers.read;
+}
+
+int simulith_spi_attach(uint8_t bus_id, uint8_t cs_id, simulith_spi_device_callback device_cb, void *ctx)
+{
+    if (bus_id >= MAX_SPI_BUSES || !spi_buses[bus_id].initialized || cs_id >= SIMULITH_SPI_MAX_CS)
+    {
+        return -1;
+    }
+
+    spi_device_t *device = &spi_buses[bus_id].devices[cs_id];
+
+    if (device_cb && has_device(device))
+    {
+        simulith_log("SPI%d.CS%d already has a device\n", bus_id, cs_id);
+        return -1;
+    }
+
+    device->callback        = device_cb;
+    device->stream_callback = NULL;
+    device->ctx             = ctx;
+    memset(&device->registers, 0, sizeof(device->registers));
+    simulith_log("SPI%d.CS%d device %s\n", bus_id, cs_id, device_cb ? "attached" : "detached");
+    return 0;
+}
+
+int simulith_spi_attach_stream(uint8_t bus_id, uint8_t cs_id, simulith_spi_stream_callback stream_cb, void *ctx)
+{
+    if (bus_id >= MAX_SPI_BUSES || !spi_buses[bus_id].initialized || cs_id >= SIMULITH_SPI_MAX_CS)
+    {
+        return -1;
+    }
+
+    spi_device_t *device = &spi_buses[bus_id].devices[cs_id];
+
+    if (stream_cb && has_device(device))
+    {
+        simulith_log("SPI%d.CS%d already has a device\n", bus_id, cs_id);
+        return -1;
+    }
+
+    device->callback        = NULL;
+    device->stream_callback = stream_cb;
+    device->ctx             = ctx;
+    memset(&device->registers, 0, sizeof(device->registers));
+    simulith_log("SPI%d.CS%d streaming device %s\n", bus_id, cs_id, stream_cb ? "attached" : "detached");
+    return 0;
+}
+
+int simulith_spi_attach_registers(uint8_t bus_id, uint8_t cs_id, size_t size, const simulith_spi_register_ops_t *ops,
+                                  void *ctx)
+{
+    if (bus_id >= MAX_SPI_BUSES || !spi_buses[bus_id].initialized || cs_id >= SIMULITH_SPI_MAX_CS)
+    {
+        return -1;
+    }
+
+    spi_device_t *device = &spi_buses[bus_id].devices[cs_id];
+
+    if (ops && (!ops->read || !ops->write))
+    {
+        simulith_log("Invalid SPI register operations\n");
+        return -1;
+    }
+
+    if (ops && has_device(device))
+    {
+        simulith_log("SPI%d.CS%d already has a device\n", bus_id, cs_id);
+        return -1;
+    }
+
+    device->callback        = NULL;
+    device->stream_callback = NULL;
+    device->ctx             = ctx;
+    device->reg_count       = size;
+    if (ops)
+        device->registers = *ops;
+    else
+        memset(&device->registers, 0, sizeof(device->registers));
+    simulith_log("SPI%d.CS%d register device %s\n", bus_id, cs_id, ops ? "attached" : "detached");
+    return 0;
+}
+
+int simulith_spi_set_cs_callback(uint8_t bus_id, uint8_t cs_id, simulith_spi_cs_callback cs_cb)
+{
+    if (bus_id >= MAX_SPI_BUSES || !spi_buses[bus_id].initialized || cs_id >= SIMULITH_SPI_MAX_CS)
+    {
+        return -1;
+    }
+
+    spi_buses[bus_id].devices[cs_id].cs_callback = cs_cb;
+    return 0;
+}
+
+static void set_cs(uint8_t bus_id, uint8_t cs_id, spi_device_t *device, bool asserted)
+{
+    device->cursor = 0;
+    if (device->cs_callback)
+    {
+        device->cs_callback(bus_id, cs_id, asserted, device->ctx);
+    }
+}
+
+// Command byte, then data bytes reading or writing registers from there on
+static int register_transfer(uint8_t bus_id, uint8_t cs_id, spi_device_t *device, const uint8_t *tx_data,
+                             uint8_t *rx_data, size_t len)
+{
+    size_t i = 0;
+
+    if (len > 0 && device->cursor == 0)
+    {
+        uint8_t command  = tx_data ? tx_data[0] : 0xFF;
+        device->reg      = command & ~SIMULITH_SPI_REG_READ;
+        device->reg_read = command & SIMULITH_SPI_REG_READ;
+        if (rx_data)
+            rx_data[0] = 0xFF;
+        i = 1;
+    }
+
+    // Data bytes past the last register read as 0xFF and are not written
+    size_t count  = len - i;
+    size_t avail  = (device->reg < device->reg_count) ? device->reg_count - device->reg : 0;
+    size_t inside = (count < avail) ? count : avail;
+
+    if (rx_data)
+        memset(rx_data + i, 0xFF, count);
+    if (inside > 0 && device->reg_read && rx_data &&
+        device->registers.read(bus_id, cs_id, device->reg, rx_data + i, inside, device->ctx) < 0)
+        return -1;
+    if (inside > 0 && !device->reg_read && tx_data &&
+        device->registers.write(bus_id, cs_id, device->reg, tx_data + i, inside, device->ctx) < 0)
+        return -1;
+
+    device->reg += count;
+    device->cursor += len;
+    return len;
+}
+
+// Transfer through the device on the chip select, or the bus callback
+static int device_transfer(uint8_t bus_id, uint8_t cs_id, spi_bus_t *bus, const uint8_t *tx_data,
+                           uint8_t *rx_data, size_t len)
+{
+    spi_device_t *device = &bus->devices[cs_id];
+
+    if (device->stream_callback)
+    {
+        // Chunk by chunk, with the cursor moving on
+        for (size_t done = 0; done < len;)
+        {
+            size_t chunk  = (len - done < SIMULITH_SPI_STREAM_CHUNK) ? len - done : SIMULITH_SPI_STREAM_CHUNK;
+            int    result = device->stream_callback(bus_id, cs_id, device->cursor, tx_data ? tx_data + done : NULL,
+                                                    rx_data ? rx_data + done : NULL, chunk, device->ctx);
+            if (result < 0)
+                return -1;
+            device->cursor += chunk;
+            done += chunk;
+        }
+        return len;
+    }
+
+    if (device->registers.read)
+    {
+        return register_transfer(bus_id, cs_id, device, tx_data, rx_data, len);
+    }
+    if (device->callback)
+    {
+        return device->callback(bus_id, cs_id, tx_data, rx_data, len, device->ctx);
+    }
+    if (!bus->transfer_callback)
+    {
+        simulith_log("SPI%d.CS%d has no device\n", bus_id, cs_id);
+        return -1;
+    }
+    return bus->transfer_callback(bus_id, cs_id, tx_data, rx_data, len);
+}
+
 int simulith_spi_transfer(uint8_t bus_id, uint8_t cs_id, const uint8_t *tx_data, uint8_t *rx_data, size_t len)
 {
     if (bus_id >= MAX_SPI_BUSES || !spi_buses[bus_id].initialized)
@@ -88,7 +281,7 @@ int simulith_spi_transfer(uint8_t bus_id, uint8_t cs_id, const uint8_t *tx_data,
         return -1;
     }
 
-    if (cs_id >= MAX_SPI_BUSES)
+    if (cs_id >= SIMULITH_SPI_MAX_CS)
     {
         simulith_log("Invalid CS ID: %d\n", cs_id);
         return -1;
@@ -100,16 +293,27 @@ int simulith_spi_transfer(uint8_t bus_id, uint8_t cs_id, const uint8_t *tx_data,
         return -1;
     }
 
+    if (len > INT_MAX)
+    {
+        simulith_log("SPI%d.CS%d transfer of %zu bytes is too long\n", bus_id, cs_id, len);
+        return -1;
+    }
+
     if (len == 0)
     {
         return 0;
     }
 
-    spi_bus_t *bus = &spi_buses[bus_id];
+    spi_bus_t *bus  = &spi_buses[bus_id];
+    bool       dump = !bus->devices[cs_id].stream_callback && len <= MAX_LOG_BYTES;
 
-    // Log transfer details
+    // Log transfer details, the data only for short transfers
     simulith_log("SPI%d.CS%d transfer: ", bus_id, cs_id);
-    if (tx_data)
+    if (!dump)
+    {
+        simulith_log("%zu bytes", len);
+    }
+    else if (tx_data)
     {
         simulith_log("TX[");
         for (size_t i = 0; i < len; i++)
@@ -119,10 +323,11 @@ int simulith_spi_transfer(uint8_t bus_id, uint8_t cs_id, const uint8_t *tx_data,
         simulith_log("] ");
     }
 
-    // Perform transfer through callback
-    int result = bus->transfer_callback(bus_id, cs_id, tx_data, rx_data, len);
+    set_cs(bus_id, cs_id, &bus->devices[cs_id], true);
+    int result = device_transfer(bus_id, cs_id, bus, tx_data, rx_data, len);
+    set_cs(bus_id, cs_id, &bus->devices[cs_id], false);
 
-    if (result > 0 && rx_data)
+    if (dump && result > 0 && rx_data)
     {
         simulith_log("RX[");
         for (size_t i = 0; i < result; i++)
@@ -133,9 +338,155 @@ int simulith_spi_transfer(uint8_t bus_id, uint8_t cs_id, const uint8_t *tx_data,
     }
     simulith_log("\n");
 
+    if (result > 0 && rx_data && !simulith_crc_check(bus->devices[cs_id].crc, rx_data, result))
+    {
+        simulith_log("SPI%d.CS%d CRC error\n", bus_id, cs_id);
+        return -1;
+    }
+
     return result;
 }
 
+int simulith_spi_transact(uint8_t bus_id, uint8_t cs_id, const simulith_spi_segment_t *segments, size_t count)
+{
+    if (bus_id >= MAX_SPI_BUSES || !spi_buses[bus_id].initialized)
+    {
+        return -1;
+    }
+
+    if (cs_id >= SIMULITH_SPI_MAX_CS)
+    {
+        simulith_log("Invalid CS ID: %d\n", cs_id);
+        return -1;
+    }
+
+    if (!segments || count == 0)
+    {
+        return -1;
+    }
+
+    // Validate up front, so a bad segment cannot leave the device mid-transaction
+    size_t length = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!segments[i].tx_data && !segments[i].rx_data && segments[i].len > 0)
+        {
+            simulith_log("SPI%d.CS%d segment %zu has neither tx_data nor rx_data\n", bus_id, cs_id, i);
+            return -1;
+        }
+        if (segments[i].len > INT_MAX - length)
+        {
+            simulith_log("SPI%d.CS%d transaction is too long\n", bus_id, cs_id);
+            return -1;
+        }
+        length += segments[i].len;
+    }
+
+    spi_bus_t *bus      = &spi_buses[bus_id];
+    size_t     total    = 0;
+    uint8_t   *last_rx  = NULL;
+    int        last_len = 0;
+    int        result   = 0;
+
+    set_cs(bus_id, cs_id, &bus->devices[cs_id], true);
+    for (size_t i = 0; i < count && result >= 0; i++)
+    {
+        if (segments[i].len == 0)
+            continue;
+
+        result = device_transfer(bus_id, cs_id, bus, segments[i].tx_data, segments[i].rx_data, segments[i].len);
+        if (result > 0)
+        {
+            total += result;
+            if (segments[i].rx_data)
+            {
+                last_rx  = segments[i].rx_data;
+                last_len = result;
+            }
+        }
+    }
+    set_cs(bus_id, cs_id, &bus->devices[cs_id], false);
+
+    simulith_log("SPI%d.CS%d transaction: %zu segments, %zu bytes%s\n", bus_id, cs_id, count, total,
+                 result < 0 ? ", failed" : "");
+
+    if (result < 0)
+    {
+        return -1;
+    }
+
+    if (last_rx && !simulith_crc_check(bus->devices[cs_id].crc, last_rx, last_len))
+    {
+        simulith_log("SPI%d.CS%d CRC error\n", bus_id, cs_id);
+        return -1;
+    }
+
+    return total;
+}
+
+int simulith_spi_stream(uint8_t bus_id, uint8_t cs_id, size_t len, simulith_spi_chunk_callback fill_tx,
+                        simulith_spi_chunk_callback take_rx, void *ctx)
+{
+    uint8_t tx_chunk[SIMULITH_SPI_STREAM_CHUNK];
+    uint8_t rx_chunk[SIMULITH_SPI_STREAM_CHUNK];
+
+    if (bus_id >= MAX_SPI_BUSES || !spi_buses[bus_id].initialized)
+    {
+        return -1;
+    }
+
+    if (cs_id >= SIMULITH_SPI_MAX_CS)
+    {
+        simulith_log("Invalid CS ID: %d\n", cs_id);
+        return -1;
+    }
+
+    if ((!fill_tx && !take_rx) || len > INT_MAX)
+    {
+        return -1;
+    }
+
+    spi_bus_t *bus    = &spi_buses[bus_id];
+    size_t     done   = 0;
+    int        result = 0;
+
+    set_cs(bus_id, cs_id, &bus->devices[cs_id], true);
+    while (done < len)
+    {
+        size_t chunk = (len - done < SIMULITH_SPI_STREAM_CHUNK) ? len - done : SIMULITH_SPI_STREAM_CHUNK;
+
+        if (fill_tx && fill_tx(bus_id, cs_id, done, tx_chunk, chunk, ctx) < 0)
+        {
+            result = -1;
+            break;
+        }
+
+        result = device_transfer(bus_id, cs_id, bus, fill_tx ? tx_chunk : NULL, take_rx ? rx_chunk : NULL, chunk);
+        if (result < 0 || (take_rx && take_rx(bus_id, cs_id, done, rx_chunk, chunk, ctx) < 0))
+        {
+            result = -1;
+            break;
+        }
+        done += chunk;
+    }
+    set_cs(bus_id, cs_id, &bus->devices[cs_id], false);
+
+    simulith_log("SPI%d.CS%d stream: %zu of %zu bytes%s\n", bus_id, cs_id, done, len, result < 0 ? ", failed" : "");
+    return (result < 0) ? -1 : (int)done;
+}
+
+int simulith_spi_set_crc(uint8_t bus_id, uint8_t cs_id, uint8_t crc)
+{
+    if (bus_id >= MAX_SPI_BUSES || !spi_buses[bus_id].initialized || cs_id >= SIMULITH_SPI_MAX_CS ||
+        crc > SIMULITH_CRC_CRC16_X25)
+    {
+        return -1;
+    }
+
+    spi_buses[bus_id].devices[cs_id].crc = crc;
+    return 0;
+}
+
 int simulith_spi_close(uint8_t bus_id)
 {
     if (bus_id >= MAX_SPI_BUSES || !spi_buses[bus_id].initialized)
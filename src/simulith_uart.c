@@ -1,18 +1,85 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // memmem
+#endif
+
 #include "simulith_uart.h"
 #include "simulith.h"
+#include "simulith_crc.h"
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define MAX_UART_PORTS 8
-#define RX_BUFFER_SIZE 1024
+#define TX_LOG_BYTES   32 // Bytes shown in the log line of a send
+#define NS_PER_SEC     1000000000ULL
+#define ASM_LEN        4 // Bytes in an attached sync marker
+
+// Byte stuffing of the deframers
+#define SLIP_END     0xC0
+#define SLIP_ESC     0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+#define HDLC_FLAG    0x7E
+#define HDLC_ESC     0x7D
+#define HDLC_XOR     0x20
+
+typedef struct
+{
+    bool                      active;
+    uint8_t                   address;
+    uint8_t                   mask;
+    simulith_uart_rx_callback rx_callback;
+} uart_endpoint_t;
 
 typedef struct
 {
     bool                      initialized;
     simulith_uart_config_t    config;
     simulith_uart_rx_callback rx_callback;
-    uint8_t                   rx_buffer[RX_BUFFER_SIZE];
-    size_t                    rx_buffer_head;
-    size_t                    rx_buffer_tail;
+    uint8_t                  *rx_buffer;      // Power-of-two ring allocated at init
+    size_t                    rx_buffer_mask; // Size - 1
+    _Atomic uint32_t         *rx_commit;      // Length of a published span at its first byte, 0 elsewhere
+    _Atomic size_t            rx_buffer_reserve; // Free-running byte counters: claimed by producers,
+    size_t                    rx_buffer_head;    // collected by the consumer,
+    _Atomic size_t            rx_buffer_tail;    // and consumed
+
+    // Baud rate pacing, see simulith_uart_set_pacing
+    bool     pacing;
+    uint8_t *tx_buffer; // Backlog ring, same size as the receive ring
+    size_t   tx_buffer_head;
+    size_t   tx_buffer_tail;
+    uint32_t char_bits;     // Start, data, parity and stop bits of one character
+    uint64_t bit_credit;    // Whole bit times elapsed and not yet used by a character
+    uint64_t bit_remainder; // Fraction of a bit time, in units of 1 / NS_PER_SEC
+    uint64_t time_ns;
+    uint64_t tx_bytes;
+    uint64_t tx_dropped;
+    size_t   tx_backlog_max;
+    double   last_tx_bytes_per_s;
+    double   last_utilization;
+
+    // Frame delivery, see simulith_uart_set_framing
+    simulith_uart_framing_t framing;
+    uint8_t                *frame; // Frame being decoded, framing.max_len bytes
+    size_t                  frame_len;
+    bool                    frame_escape;   // Last byte was an escape
+    bool                    frame_overflow; // Frame is dropped when it ends
+    bool                    frame_sync;     // Marker found, collecting the frame
+    uint8_t                 sync_marker[ASM_LEN];
+    uint8_t                 sync_tail[ASM_LEN - 1]; // End of the last chunk, the start of a split marker
+    size_t                  sync_tail_len;
+    uint64_t                frame_bytes;     // Bytes fed to the deframer
+    uint64_t                frame_idle_mark; // frame_bytes at frame_idle_ns
+    uint64_t                frame_idle_ns;
+    uint64_t                rx_frames;
+    uint64_t                rx_frames_dropped;
+    uint64_t                rx_crc_errors;
+
+    // Multi-drop endpoints, see simulith_uart_attach
+    uart_endpoint_t endpoints[SIMULITH_UART_MAX_ENDPOINTS];
+    uint32_t        endpoint_mask;      // Bit per attached endpoint
+    uint32_t        address_match[256]; // Endpoints reached by each first byte
+    uint64_t        rx_unaddressed;
 } uart_port_t;
 
 static uart_port_t uart_ports[MAX_UART_PORTS] = {0};
@@ -51,6 +118,12 @@ static bool is_valid_config(const simulith_uart_config_t *config)
     if (config->flow_control > SIMULITH_UART_FLOW_SOFTWARE)
         return false;
 
+    // Validate receive buffer size (0 for the default, else a power of two)
+    if (config->rx_buffer_size != 0 &&
+        (config->rx_buffer_size < SIMULITH_UART_RX_BUFFER_MIN || config->rx_buffer_size > SIMULITH_UART_RX_BUFFER_MAX ||
+         (config->rx_buffer_size & (config->rx_buffer_size - 1)) != 0))
+        return false;
+
     return true;
 }
 
@@ -76,12 +149,36 @@ int simulith_uart_init(uint8_t port_id, const simulith_uart_config_t *config, si
         return -1;
     }
 
+    size_t rx_buffer_size = config->rx_buffer_size ? config->rx_buffer_size : SIMULITH_UART_RX_BUFFER_DEFAULT;
+
+    port->rx_buffer = malloc(rx_buffer_size);
+    port->rx_commit = calloc(rx_buffer_size, sizeof(*port->rx_commit));
+    if (!port->rx_buffer || !port->rx_commit)
+    {
+        free(port->rx_buffer);
+        free((void *)port->rx_commit);
+        simulith_log("Cannot allocate %zu byte receive buffer for UART port %d\n", rx_buffer_size, port_id);
+        return -1;
+    }
+
     // Initialize port structure
     memcpy(&port->config, config, sizeof(simulith_uart_config_t));
     port->rx_callback    = rx_cb;
+    port->rx_buffer_mask = rx_buffer_size - 1;
+    atomic_init(&port->rx_buffer_reserve, 0);
     port->rx_buffer_head = 0;
-    port->rx_buffer_tail = 0;
-    port->initialized    = true;
+    atomic_init(&port->rx_buffer_tail, 0);
+    port->pacing         = false;
+    port->tx_buffer      = NULL;
+    port->tx_buffer_head = 0;
+    port->tx_buffer_tail = 0;
+    port->char_bits      = 1 + config->data_bits + (config->parity != SIMULITH_UART_PARITY_NONE) + config->stop_bits;
+    port->framing.type   = SIMULITH_UART_FRAMING_NONE;
+    port->frame          = NULL;
+    port->endpoint_mask  = 0;
+    port->rx_unaddressed = 0;
+    memset(port->endpoints, 0, sizeof(port->endpoints));
+    port->initialized = true;
 
     simulith_log("UART port %d initialized: %d baud, %d-%d-%c\n", port_id, config->baud_rate, config->data_bits,
                  config->stop_bits, config->parity == 0 ? 'N' : (config->parity == 1 ? 'O' : 'E'));
@@ -89,6 +186,416 @@ int simulith_uart_init(uint8_t port_id, const simulith_uart_config_t *config, si
     return 0;
 }
 
+// Queue bytes in the receive ring, see simulith_uart_inject
+static size_t rx_enqueue(uart_port_t *port, const uint8_t *data, size_t len)
+{
+    size_t size  = port->rx_buffer_mask + 1;
+    size_t start = atomic_load_explicit(&port->rx_buffer_reserve, memory_order_relaxed);
+    size_t count;
+
+    // Claim a span of the buffer, producers never write the same bytes
+    do
+    {
+        size_t tail = atomic_load_explicit(&port->rx_buffer_tail, memory_order_acquire);
+        size_t used = start - tail;
+
+        // A stale start is older than the tail, the CAS below fails and reloads it
+        if ((ptrdiff_t)used < 0)
+            used = 0;
+        count = size - used;
+        if (count > len)
+            count = len;
+        if (count == 0)
+            return 0;
+    } while (!atomic_compare_exchange_weak_explicit(&port->rx_buffer_reserve, &start, start + count,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    // At most two copies, the second one when the span wraps around the end of the ring
+    size_t offset = start & port->rx_buffer_mask;
+    size_t first  = (count < size - offset) ? count : size - offset;
+    memcpy(&port->rx_buffer[offset], data, first);
+    memcpy(port->rx_buffer, data + first, count - first);
+
+    // Publish the span on its own, the receiver stops at the first span still being copied so a
+    // preempted producer only holds back the bytes behind it and never the other producers
+    atomic_store_explicit(&port->rx_commit[offset], (uint32_t)count, memory_order_release);
+
+    return count;
+}
+
+// Move the head over the spans published contiguously after it, receiver side only
+static size_t rx_collect(uart_port_t *port)
+{
+    size_t head = port->rx_buffer_head;
+    size_t count;
+
+    // Clearing the entry before the tail passes it keeps it from reading as published a lap later
+    while ((count = atomic_load_explicit(&port->rx_commit[head & port->rx_buffer_mask], memory_order_acquire)) != 0)
+    {
+        atomic_store_explicit(&port->rx_commit[head & port->rx_buffer_mask], 0, memory_order_relaxed);
+        head += count;
+    }
+    port->rx_buffer_head = head;
+    return head;
+}
+
+int simulith_uart_set_callback(uint8_t port_id, simulith_uart_rx_callback rx_cb)
+{
+    if (port_id >= MAX_UART_PORTS || !uart_ports[port_id].initialized)
+    {
+        return -1;
+    }
+
+    uart_ports[port_id].rx_callback = rx_cb;
+    return 0;
+}
+
+static uint64_t char_time_ns(const uart_port_t *port)
+{
+    return (port->char_bits * NS_PER_SEC + port->config.baud_rate - 1) / port->config.baud_rate;
+}
+
+// Hand bytes or a frame to the matching endpoints or the receive callback, or loop them back
+static int hand_over(uint8_t port_id, uart_port_t *port, const uint8_t *data, size_t len)
+{
+    if (port->endpoint_mask)
+    {
+        // The lookup table saves testing every endpoint's address on every frame
+        uint32_t match = port->address_match[data[0]];
+        if (!match)
+        {
+            port->rx_unaddressed++;
+        }
+        for (int i = 0; match; i++, match >>= 1)
+        {
+            if (match & 1)
+                port->endpoints[i].rx_callback(port_id, data, len);
+        }
+        return len;
+    }
+
+    if (port->rx_callback)
+    {
+        return port->rx_callback(port_id, data, len);
+    }
+    return rx_enqueue(port, data, len);
+}
+
+static void frame_reset(uart_port_t *port)
+{
+    port->frame_len      = 0;
+    port->frame_escape   = false;
+    port->frame_overflow = false;
+    port->frame_sync     = false;
+    port->sync_tail_len  = 0;
+}
+
+static void frame_append(uart_port_t *port, const uint8_t *data, size_t len)
+{
+    if (port->frame_len + len > port->framing.max_len)
+    {
+        port->frame_overflow = true;
+    }
+    if (!port->frame_overflow)
+    {
+        memcpy(&port->frame[port->frame_len], data, len);
+        port->frame_len += len;
+    }
+}
+
+// Hand over the decoded frame and start the next one
+static void frame_end(uint8_t port_id, uart_port_t *port)
+{
+    const uint8_t *data     = port->frame;
+    size_t         len      = port->frame_len;
+    bool           overflow = port->frame_overflow;
+
+    port->frame_len      = 0;
+    port->frame_overflow = false;
+
+    if (overflow)
+    {
+        port->rx_frames_dropped++;
+        return;
+    }
+
+    // KISS frames start with a type byte, the low nibble is 0 for data frames
+    if (port->framing.type == SIMULITH_UART_FRAMING_KISS && len > 0)
+    {
+        if ((data[0] & 0x0F) != 0)
+            return;
+        data++;
+        len--;
+    }
+
+    if (len > 0 && !simulith_crc_check(port->framing.crc, data, len))
+    {
+        port->rx_crc_errors++;
+        return;
+    }
+
+    // The HDLC FCS belongs to the framing, the frame goes on without it
+    if (port->framing.type == SIMULITH_UART_FRAMING_HDLC)
+        len -= (len > 0) ? simulith_crc_size(port->framing.crc) : 0;
+
+    if (len > 0)
+    {
+        port->rx_frames++;
+        hand_over(port_id, port, data, len);
+    }
+}
+
+// SLIP, KISS and HDLC: copy the runs between flag and escape bytes, which memchr finds
+// a vector at a time
+static void deframe_stuffed(uint8_t port_id, uart_port_t *port, const uint8_t *data, size_t len)
+{
+    bool           hdlc    = port->framing.type == SIMULITH_UART_FRAMING_HDLC;
+    uint8_t        flag    = hdlc ? HDLC_FLAG : SLIP_END;
+    uint8_t        esc     = hdlc ? HDLC_ESC : SLIP_ESC;
+    const uint8_t *end     = data + len;
+    const uint8_t *flag_at = memchr(data, flag, len);
+
+    while (data < end)
+    {
+        if (port->frame_escape)
+        {
+            port->frame_escape = false;
+
+            // An escaped flag aborts the frame, the flag still ends it
+            if (*data == flag)
+            {
+                port->frame_overflow = true;
+                continue;
+            }
+
+            uint8_t byte = hdlc ? *data ^ HDLC_XOR
+                                : (*data == SLIP_ESC_END ? SLIP_END : (*data == SLIP_ESC_ESC ? SLIP_ESC : *data));
+            frame_append(port, &byte, 1);
+            data++;
+            continue;
+        }
+
+        const uint8_t *stop   = flag_at ? flag_at : end;
+        const uint8_t *esc_at = memchr(data, esc, stop - data);
+        if (esc_at)
+            stop = esc_at;
+
+        frame_append(port, data, stop - data);
+        data = stop;
+        if (data == end)
+            break;
+
+        if (data == esc_at)
+        {
+            port->frame_escape = true;
+        }
+        else
+        {
+            frame_end(port_id, port);
+            flag_at = memchr(data + 1, flag, end - data - 1);
+        }
+        data++;
+    }
+}
+
+// ASM: find the marker with memmem, including one split across chunks, then collect the frame
+static void deframe_asm(uint8_t port_id, uart_port_t *port, const uint8_t *data, size_t len)
+{
+    const uint8_t *end = data + len;
+
+    while (data < end)
+    {
+        size_t left = end - data;
+
+        if (port->frame_sync)
+        {
+            size_t count = port->framing.max_len - port->frame_len;
+            if (count > left)
+                count = left;
+
+            memcpy(&port->frame[port->frame_len], data, count);
+            port->frame_len += count;
+            data += count;
+
+            if (port->frame_len == port->framing.max_len)
+            {
+                port->frame_sync = false;
+                frame_end(port_id, port);
+            }
+            continue;
+        }
+
+        const uint8_t *start = NULL; // First byte after the marker
+
+        if (port->sync_tail_len > 0)
+        {
+            uint8_t window[2 * (ASM_LEN - 1)];
+            size_t  head  = (left < ASM_LEN - 1) ? left : ASM_LEN - 1;
+            size_t  total = port->sync_tail_len + head;
+
+            memcpy(window, port->sync_tail, port->sync_tail_len);
+            memcpy(&window[port->sync_tail_len], data, head);
+
+            const uint8_t *at = memmem(window, total, port->sync_marker, ASM_LEN);
+            if (at)
+            {
+                start = data + (at - window) + ASM_LEN - port->sync_tail_len;
+            }
+            else if (head < ASM_LEN - 1)
+            {
+                // Short chunk, the split marker may still complete later
+                size_t keep = (total < ASM_LEN - 1) ? total : ASM_LEN - 1;
+                memmove(port->sync_tail, &window[total - keep], keep);
+                port->sync_tail_len = keep;
+                return;
+            }
+        }
+
+        if (!start)
+        {
+            const uint8_t *at = memmem(data, left, port->sync_marker, ASM_LEN);
+            if (!at)
+            {
+                size_t keep = (left < ASM_LEN - 1) ? left : ASM_LEN - 1;
+                memcpy(port->sync_tail, end - keep, keep);
+                port->sync_tail_len = keep;
+                return;
+            }
+            start = at + ASM_LEN;
+        }
+
+        port->sync_tail_len = 0;
+        port->frame_sync    = true;
+        data                = start;
+    }
+}
+
+// Rebuild the address lookup table after an endpoint change
+static void update_address_match(uart_port_t *port)
+{
+    for (int address = 0; address < 256; address++)
+    {
+        uint32_t match = 0;
+
+        for (int i = 0; i < SIMULITH_UART_MAX_ENDPOINTS; i++)
+        {
+            const uart_endpoint_t *endpoint = &port->endpoints[i];
+
+            if (endpoint->active && (address == SIMULITH_UART_ADDRESS_BROADCAST ||
+                                     (address & endpoint->mask) == (endpoint->address & endpoint->mask)))
+                match |= 1U << i;
+        }
+        port->address_match[address] = match;
+    }
+}
+
+int simulith_uart_attach(uint8_t port_id, uint8_t address, uint8_t mask, simulith_uart_rx_callback rx_cb)
+{
+    if (port_id >= MAX_UART_PORTS || !uart_ports[port_id].initialized || !rx_cb)
+    {
+        return -1;
+    }
+
+    uart_port_t *port = &uart_ports[port_id];
+
+    for (int i = 0; i < SIMULITH_UART_MAX_ENDPOINTS; i++)
+    {
+        if (!port->endpoints[i].active)
+        {
+            port->endpoints[i].active      = true;
+            port->endpoints[i].address     = address;
+            port->endpoints[i].mask        = mask;
+            port->endpoints[i].rx_callback = rx_cb;
+            port->endpoint_mask |= 1U << i;
+            update_address_match(port);
+
+            simulith_log("UART port %d endpoint %d attached at address 0x%02X/0x%02X\n", port_id, i, address, mask);
+            return i;
+        }
+    }
+
+    simulith_log("UART port %d has no free endpoint\n", port_id);
+    return -1;
+}
+
+int simulith_uart_detach(uint8_t port_id, int endpoint_id)
+{
+    if (port_id >= MAX_UART_PORTS || !uart_ports[port_id].initialized || endpoint_id < 0 ||
+        endpoint_id >= SIMULITH_UART_MAX_ENDPOINTS || !uart_ports[port_id].endpoints[endpoint_id].active)
+    {
+        return -1;
+    }
+
+    uart_port_t *port = &uart_ports[port_id];
+
+    port->endpoints[endpoint_id].active = false;
+    port->endpoint_mask &= ~(1U << endpoint_id);
+    update_address_match(port);
+    return 0;
+}
+
+// Hand bytes that went over the line to the deframer or the receive callback, or loop them back
+static int deliver(uint8_t port_id, uart_port_t *port, const uint8_t *data, size_t len)
+{
+    switch (port->framing.type)
+    {
+        case SIMULITH_UART_FRAMING_NONE:
+            return hand_over(port_id, port, data, len);
+        case SIMULITH_UART_FRAMING_ASM:
+            deframe_asm(port_id, port, data, len);
+            break;
+        default:
+            deframe_stuffed(port_id, port, data, len);
+            break;
+    }
+    port->frame_bytes += len;
+    return len;
+}
+
+// Drop a partial frame when no data arrived for the idle time
+static void frame_idle(uart_port_t *port, uint64_t now_ns)
+{
+    if (port->framing.type == SIMULITH_UART_FRAMING_NONE)
+    {
+        return;
+    }
+
+    if (port->frame_bytes != port->frame_idle_mark || now_ns < port->frame_idle_ns)
+    {
+        port->frame_idle_mark = port->frame_bytes;
+        port->frame_idle_ns   = now_ns;
+        return;
+    }
+
+    bool partial = port->frame_len > 0 || port->frame_escape || port->frame_overflow || port->frame_sync;
+    if (partial && now_ns - port->frame_idle_ns >= port->framing.idle_chars * char_time_ns(port))
+    {
+        frame_reset(port);
+        port->rx_frames_dropped++;
+    }
+}
+
+// Deliver up to count bytes from the head of the TX backlog, in at most two chunks
+static size_t tx_release(uint8_t port_id, uart_port_t *port, size_t count)
+{
+    size_t size    = port->rx_buffer_mask + 1;
+    size_t backlog = port->tx_buffer_head - port->tx_buffer_tail;
+
+    if (count > backlog)
+        count = backlog;
+
+    size_t offset = port->tx_buffer_tail & port->rx_buffer_mask;
+    size_t first  = (count < size - offset) ? count : size - offset;
+    if (first > 0)
+        deliver(port_id, port, &port->tx_buffer[offset], first);
+    if (count > first)
+        deliver(port_id, port, port->tx_buffer, count - first);
+
+    port->tx_buffer_tail += count;
+    port->tx_bytes += count;
+    return count;
+}
+
 int simulith_uart_send(uint8_t port_id, const uint8_t *data, size_t len)
 {
     if (port_id >= MAX_UART_PORTS || !uart_ports[port_id].initialized)
@@ -102,23 +609,52 @@ int simulith_uart_send(uint8_t port_id, const uint8_t *data, size_t len)
     }
 
     uart_port_t *port = &uart_ports[port_id];
+    char         hex[TX_LOG_BYTES * 3 + 1];
+    size_t       shown = (len < TX_LOG_BYTES) ? len : TX_LOG_BYTES;
 
     // In a real implementation, we would handle flow control here
-    // For simulation, we just log the data
-    simulith_log("UART%d TX: ", port_id);
-    for (size_t i = 0; i < len; i++)
+    // For simulation, we just log the start of the data
+    for (size_t i = 0; i < shown; i++)
     {
-        simulith_log("%02X ", data[i]);
+        snprintf(&hex[i * 3], 4, "%02X ", data[i]);
     }
-    simulith_log("\n");
+    hex[shown * 3] = '\0';
+    if (shown < len)
+        simulith_log("UART%d TX: %s... (%zu bytes)\n", port_id, hex, len);
+    else
+        simulith_log("UART%d TX: %s\n", port_id, hex);
 
-    // If there's a receive callback, simulate loopback
-    if (port->rx_callback)
+    if (port->pacing)
     {
-        return port->rx_callback(port_id, data, len);
+        // Queue for simulith_uart_advance, what does not fit in the backlog is lost
+        size_t size    = port->rx_buffer_mask + 1;
+        size_t backlog = port->tx_buffer_head - port->tx_buffer_tail;
+        size_t count   = (len < size - backlog) ? len : size - backlog;
+        size_t offset  = port->tx_buffer_head & port->rx_buffer_mask;
+        size_t first   = (count < size - offset) ? count : size - offset;
+
+        memcpy(&port->tx_buffer[offset], data, first);
+        memcpy(port->tx_buffer, data + first, count - first);
+        port->tx_buffer_head += count;
+        port->tx_dropped += len - count;
+        if (backlog + count > port->tx_backlog_max)
+            port->tx_backlog_max = backlog + count;
+        return count;
     }
 
-    return len;
+    // If there's a receive callback, simulate loopback, otherwise loop back into the receive buffer
+    port->tx_bytes += len;
+    return deliver(port_id, port, data, len);
+}
+
+int simulith_uart_inject(uint8_t port_id, const uint8_t *data, size_t len)
+{
+    if (port_id >= MAX_UART_PORTS || !uart_ports[port_id].initialized || !data)
+    {
+        return -1;
+    }
+
+    return rx_enqueue(&uart_ports[port_id], data, len);
 }
 
 int simulith_uart_receive(uint8_t port_id, uint8_t *data, size_t max_len)
@@ -129,14 +665,16 @@ int simulith_uart_receive(uint8_t port_id, uint8_t *data, size_t max_len)
     }
 
     uart_port_t *port            = &uart_ports[port_id];
-    size_t       bytes_available = (port->rx_buffer_head - port->rx_buffer_tail) % RX_BUFFER_SIZE;
+    size_t       size            = port->rx_buffer_mask + 1;
+    size_t       tail            = atomic_load_explicit(&port->rx_buffer_tail, memory_order_relaxed);
+    size_t       bytes_available = rx_collect(port) - tail;
     size_t       bytes_to_read   = (bytes_available < max_len) ? bytes_available : max_len;
 
-    for (size_t i = 0; i < bytes_to_read; i++)
-    {
-        data[i]              = port->rx_buffer[port->rx_buffer_tail];
-        port->rx_buffer_tail = (port->rx_buffer_tail + 1) % RX_BUFFER_SIZE;
-    }
+    size_t offset = tail & port->rx_buffer_mask;
+    size_t first  = (bytes_to_read < size - offset) ? bytes_to_read : size - offset;
+    memcpy(data, &port->rx_buffer[offset], first);
+    memcpy(data + first, port->rx_buffer, bytes_to_read - first);
+    atomic_store_explicit(&port->rx_buffer_tail, tail + bytes_to_read, memory_order_release);
 
     return bytes_to_read;
 }
@@ -148,8 +686,185 @@ int simulith_uart_available(uint8_t port_id)
         return -1;
     }
 
+    // Moves the head, the receiving thread's own state
+    uart_port_t *port = &uart_ports[port_id];
+    return rx_collect(port) - atomic_load_explicit(&port->rx_buffer_tail, memory_order_relaxed);
+}
+
+int simulith_uart_set_pacing(uint8_t port_id, bool enable)
+{
+    if (port_id >= MAX_UART_PORTS || !uart_ports[port_id].initialized)
+    {
+        return -1;
+    }
+
     uart_port_t *port = &uart_ports[port_id];
-    return (port->rx_buffer_head - port->rx_buffer_tail) % RX_BUFFER_SIZE;
+
+    if (enable && !port->tx_buffer)
+    {
+        port->tx_buffer = malloc(port->rx_buffer_mask + 1);
+        if (!port->tx_buffer)
+        {
+            simulith_log("Cannot allocate TX backlog for UART port %d\n", port_id);
+            return -1;
+        }
+    }
+
+    if (!enable && port->pacing)
+    {
+        // Deliver the backlog at once
+        tx_release(port_id, port, port->tx_buffer_head - port->tx_buffer_tail);
+    }
+    else if (enable && !port->pacing)
+    {
+        port->tx_buffer_head      = 0;
+        port->tx_buffer_tail      = 0;
+        port->bit_credit          = 0;
+        port->bit_remainder       = 0;
+        port->time_ns             = 0;
+        port->tx_bytes            = 0;
+        port->tx_dropped          = 0;
+        port->tx_backlog_max      = 0;
+        port->last_tx_bytes_per_s = 0.0;
+        port->last_utilization    = 0.0;
+    }
+
+    port->pacing = enable;
+    simulith_log("UART port %d baud pacing %s\n", port_id, enable ? "enabled" : "disabled");
+    return 0;
+}
+
+int simulith_uart_advance(uint8_t port_id, uint64_t now_ns)
+{
+    if (port_id >= MAX_UART_PORTS || !uart_ports[port_id].initialized)
+    {
+        return -1;
+    }
+
+    uart_port_t *port = &uart_ports[port_id];
+
+    if (!port->pacing)
+    {
+        frame_idle(port, now_ns);
+        return 0;
+    }
+
+    if (now_ns < port->time_ns)
+    {
+        simulith_log("UART port %d cannot advance backwards to %llu ns\n", port_id, (unsigned long long)now_ns);
+        return -1;
+    }
+
+    uint64_t elapsed = now_ns - port->time_ns;
+    uint64_t baud    = port->config.baud_rate;
+
+    // Bit times in the interval, split so that long intervals cannot overflow
+    uint64_t fraction = (elapsed % NS_PER_SEC) * baud + port->bit_remainder;
+    port->bit_credit += (elapsed / NS_PER_SEC) * baud + fraction / NS_PER_SEC;
+    port->bit_remainder = fraction % NS_PER_SEC;
+
+    size_t released = tx_release(port_id, port, port->bit_credit / port->char_bits);
+    port->bit_credit -= released * port->char_bits;
+
+    // An idle line does not save up time for later bytes
+    if (port->tx_buffer_head == port->tx_buffer_tail)
+    {
+        port->bit_credit    = 0;
+        port->bit_remainder = 0;
+    }
+
+    if (elapsed > 0)
+    {
+        double seconds            = (double)elapsed / NS_PER_SEC;
+        port->last_tx_bytes_per_s = released / seconds;
+        port->last_utilization    = (double)released * port->char_bits / (seconds * baud);
+
+        // Bit time saved from the previous interval can push a busy line slightly over
+        if (port->last_utilization > 1.0)
+            port->last_utilization = 1.0;
+    }
+    port->time_ns = now_ns;
+    frame_idle(port, now_ns);
+
+    return released;
+}
+
+int simulith_uart_set_framing(uint8_t port_id, const simulith_uart_framing_t *framing)
+{
+    if (port_id >= MAX_UART_PORTS || !uart_ports[port_id].initialized)
+    {
+        return -1;
+    }
+
+    if (framing && (framing->type > SIMULITH_UART_FRAMING_ASM || framing->crc > SIMULITH_CRC_CRC16_X25))
+    {
+        simulith_log("Invalid framing %d for UART port %d\n", framing->type, port_id);
+        return -1;
+    }
+
+    uart_port_t *port = &uart_ports[port_id];
+
+    free(port->frame);
+    port->frame        = NULL;
+    port->framing.type = SIMULITH_UART_FRAMING_NONE;
+    frame_reset(port);
+    port->frame_bytes       = 0;
+    port->frame_idle_mark   = 0;
+    port->frame_idle_ns     = 0;
+    port->rx_frames         = 0;
+    port->rx_frames_dropped = 0;
+    port->rx_crc_errors     = 0;
+
+    if (!framing || framing->type == SIMULITH_UART_FRAMING_NONE)
+    {
+        simulith_log("UART port %d framing disabled\n", port_id);
+        return 0;
+    }
+
+    simulith_uart_framing_t config = *framing;
+    config.max_len     = config.max_len ? config.max_len : SIMULITH_UART_FRAME_DEFAULT;
+    config.sync_marker = config.sync_marker ? config.sync_marker : SIMULITH_UART_CCSDS_ASM;
+    config.idle_chars  = config.idle_chars ? config.idle_chars : SIMULITH_UART_IDLE_CHARS_DEFAULT;
+
+    port->frame = malloc(config.max_len);
+    if (!port->frame)
+    {
+        simulith_log("Cannot allocate frame buffer for UART port %d\n", port_id);
+        return -1;
+    }
+
+    for (int i = 0; i < ASM_LEN; i++)
+    {
+        port->sync_marker[i] = config.sync_marker >> (8 * (ASM_LEN - 1 - i));
+    }
+    port->framing = config;
+
+    simulith_log("UART port %d framing %d, frames up to %d bytes\n", port_id, config.type, config.max_len);
+    return 0;
+}
+
+int simulith_uart_get_stats(uint8_t port_id, simulith_uart_stats_t *stats)
+{
+    if (port_id >= MAX_UART_PORTS || !uart_ports[port_id].initialized || !stats)
+    {
+        return -1;
+    }
+
+    uart_port_t *port = &uart_ports[port_id];
+
+    stats->pacing              = port->pacing;
+    stats->char_time_ns        = char_time_ns(port);
+    stats->tx_bytes            = port->tx_bytes;
+    stats->tx_dropped          = port->tx_dropped;
+    stats->tx_backlog          = port->pacing ? port->tx_buffer_head - port->tx_buffer_tail : 0;
+    stats->tx_backlog_max      = port->tx_backlog_max;
+    stats->last_tx_bytes_per_s = port->last_tx_bytes_per_s;
+    stats->last_utilization    = port->last_utilization;
+    stats->rx_frames           = port->rx_frames;
+    stats->rx_frames_dropped   = port->rx_frames_dropped;
+    stats->rx_crc_errors       = port->rx_crc_errors;
+    stats->rx_unaddressed      = port->rx_unaddressed;
+    return 0;
 }
 
 int simulith_uart_close(uint8_t port_id)
@@ -160,6 +875,14 @@ int simulith_uart_close(uint8_t port_id)
     }
 
     uart_ports[port_id].initialized = false;
+    free(uart_ports[port_id].rx_buffer);
+    free((void *)uart_ports[port_id].rx_commit);
+    free(uart_ports[port_id].tx_buffer);
+    free(uart_ports[port_id].frame);
+    uart_ports[port_id].rx_buffer = NULL;
+    uart_ports[port_id].rx_commit = NULL;
+    uart_ports[port_id].tx_buffer = NULL;
+    uart_ports[port_id].frame     = NULL;
     simulith_log("UART port %d closed\n", port_id);
     return 0;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "simulith_can.h"
 #include "unity.h"
+#include <pthread.h>
+#include <stdatomic.h>
 #include <string.h>
 
 static int                    test_rx_count = 0;
@@ -23,6 +25,13 @@ static int test_can_rx_cb(uint8_t bus_id, const simulith_can_message_t *msg)
     return 0;
 }
 
+static int test_filter_cb(uint8_t bus_id, const simulith_can_fd_message_t *msg, void *ctx)
+{
+    int *count = (int *)ctx;
+    (*count)++;
+    return 0;
+}
+
 void test_can_init(void)
 {
     simulith_can_config_t config = {.bitrate = SIMULITH_CAN_BITRATE_500K, .sample_point = 75, .sync_jump = 1};
@@ -161,6 +170,452 @@ void test_can_multiple_buses(void)
     }
 }
 
+void test_can_batch(void)
+{
+    simulith_can_config_t config = {.bitrate = SIMULITH_CAN_BITRATE_500K, .sample_point = 75, .sync_jump = 1};
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_init(0, &config, test_can_rx_cb));
+
+    // Send more frames than fit in one pass so the ring wraps
+    simulith_can_message_t tx_msgs[20];
+    for (int i = 0; i < 20; i++)
+    {
+        tx_msgs[i] = (simulith_can_message_t) {.id = 0x100 + i, .dlc = 1, .data = {(uint8_t)i}};
+    }
+
+    TEST_ASSERT_EQUAL_INT(20, simulith_can_send_batch(0, tx_msgs, 20));
+
+    simulith_can_message_t rx_msgs[20];
+    TEST_ASSERT_EQUAL_INT(15, simulith_can_receive_batch(0, rx_msgs, 15));
+    TEST_ASSERT_EQUAL_INT(20, simulith_can_send_batch(0, tx_msgs, 20));
+
+    // 5 left from the first batch plus 20 from the second
+    TEST_ASSERT_EQUAL_INT(20, simulith_can_receive_batch(0, rx_msgs, 20));
+    TEST_ASSERT_EQUAL_UINT32(0x10F, rx_msgs[0].id);
+    TEST_ASSERT_EQUAL_UINT32(0x113, rx_msgs[4].id);
+    TEST_ASSERT_EQUAL_UINT32(0x100, rx_msgs[5].id);
+    TEST_ASSERT_EQUAL_UINT8(14, rx_msgs[19].data[0]);
+    TEST_ASSERT_EQUAL_INT(5, simulith_can_receive_batch(0, rx_msgs, 20));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_receive_batch(0, rx_msgs, 20));
+
+    // One invalid frame rejects the whole batch
+    tx_msgs[3].dlc = 9;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_send_batch(0, tx_msgs, 20));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_receive_batch(0, rx_msgs, 20));
+
+    // Invalid parameters
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_send_batch(0, NULL, 1));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_receive_batch(0, NULL, 1));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_send_batch(1, tx_msgs, 1));
+
+    // Clean up
+    simulith_can_close(0);
+}
+
+void test_can_fd(void)
+{
+    simulith_can_config_t config = {.bitrate = SIMULITH_CAN_BITRATE_500K, .sample_point = 75, .sync_jump = 1};
+
+    simulith_can_fd_message_t tx_fd = {.id = 0x321, .flags = SIMULITH_CAN_FLAG_BRS, .len = 64};
+    for (int i = 0; i < 64; i++)
+    {
+        tx_fd.data[i] = (uint8_t)i;
+    }
+
+    // FD frames need a data phase bitrate
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_init(0, &config, test_can_rx_cb));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_send_fd(0, &tx_fd));
+    simulith_can_close(0);
+
+    // Data phase bitrate must not be below the nominal bitrate
+    config.data_bitrate = SIMULITH_CAN_BITRATE_250K;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_init(0, &config, test_can_rx_cb));
+
+    config.data_bitrate = SIMULITH_CAN_FD_BITRATE_2M;
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_init(0, &config, test_can_rx_cb));
+
+    // FD and classic frames share one queue and keep their order
+    simulith_can_message_t tx_msg = {.id = 0x100, .dlc = 2, .data = {0xAA, 0xBB}};
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &tx_msg));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send_fd(0, &tx_fd));
+
+    simulith_can_message_t rx_msg;
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_receive(0, &rx_msg));
+    TEST_ASSERT_EQUAL_UINT32(0x100, rx_msg.id);
+
+    // The classic API refuses to truncate an FD frame
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_receive(0, &rx_msg));
+
+    simulith_can_fd_message_t rx_fd;
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_receive_fd(0, &rx_fd));
+    TEST_ASSERT_EQUAL_UINT32(0x321, rx_fd.id);
+    TEST_ASSERT_EQUAL_UINT8(64, rx_fd.len);
+    TEST_ASSERT_EQUAL_UINT8(SIMULITH_CAN_FLAG_FDF | SIMULITH_CAN_FLAG_BRS, rx_fd.flags);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(tx_fd.data, rx_fd.data, 64);
+
+    // Classic frames come back through the FD API with FDF clear
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &tx_msg));
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_receive_fd(0, &rx_fd));
+    TEST_ASSERT_EQUAL_UINT8(0, rx_fd.flags);
+    TEST_ASSERT_EQUAL_UINT8(2, rx_fd.len);
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_receive_fd(0, &rx_fd));
+
+    // Invalid FD lengths and flags
+    tx_fd.len = 13;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_send_fd(0, &tx_fd));
+    tx_fd.len   = 12;
+    tx_fd.flags = SIMULITH_CAN_FLAG_RTR;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_send_fd(0, &tx_fd));
+
+    // The queue holds many more small frames than 64-byte ones
+    tx_fd.flags = 0;
+    tx_fd.len   = 64;
+
+    int fd_count = 0;
+    while (fd_count < 1000)
+    {
+        simulith_can_send_fd(0, &tx_fd);
+        if (simulith_can_receive_fd(0, &rx_fd) != 1)
+            break;
+        fd_count++;
+    }
+    TEST_ASSERT_EQUAL_INT(1000, fd_count);
+
+    // Clean up
+    simulith_can_close(0);
+}
+
+void test_can_dispatch(void)
+{
+    simulith_can_config_t config = {.bitrate = SIMULITH_CAN_BITRATE_500K, .sample_point = 75, .sync_jump = 1};
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_init(0, &config, test_can_rx_cb));
+
+    int                   filter_hits = 0;
+    simulith_can_filter_t filter      = {.id = 0x200, .mask = 0x700, .is_extended = 0};
+    TEST_ASSERT_GREATER_OR_EQUAL_INT(0, simulith_can_add_filter_callback(0, &filter, test_filter_cb, &filter_hits));
+
+    simulith_can_message_t matching = {.id = 0x234, .dlc = 1, .data = {0x01}};
+    simulith_can_message_t other    = {.id = 0x123, .dlc = 1, .data = {0x02}};
+    simulith_can_message_t rx_msg;
+
+    // Poll mode queues everything and calls nothing
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &matching));
+    TEST_ASSERT_EQUAL_INT(0, filter_hits);
+    TEST_ASSERT_EQUAL_INT(0, test_rx_count);
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_receive(0, &rx_msg));
+
+    // Immediate mode routes to the filter callback, then the bus callback
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_set_dispatch_mode(0, SIMULITH_CAN_DISPATCH_IMMEDIATE));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &matching));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &other));
+    TEST_ASSERT_EQUAL_INT(1, filter_hits);
+    TEST_ASSERT_EQUAL_INT(1, test_rx_count);
+    TEST_ASSERT_EQUAL_UINT32(0x123, last_received_msg.id);
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_receive(0, &rx_msg));
+
+    // Deferred mode holds frames until the tick drain
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_set_dispatch_mode(0, SIMULITH_CAN_DISPATCH_DEFERRED));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &matching));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &matching));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &other));
+    TEST_ASSERT_EQUAL_INT(1, filter_hits);
+    TEST_ASSERT_EQUAL_INT(1, test_rx_count);
+    TEST_ASSERT_EQUAL_INT(3, simulith_can_dispatch(0));
+    TEST_ASSERT_EQUAL_INT(3, filter_hits);
+    TEST_ASSERT_EQUAL_INT(2, test_rx_count);
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_dispatch(0));
+
+    // Invalid parameters
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_set_dispatch_mode(0, 3));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_dispatch(1));
+
+    // Clean up
+    simulith_can_close(0);
+}
+
+void test_can_multi_node(void)
+{
+    simulith_can_config_t config = {.bitrate = SIMULITH_CAN_BITRATE_500K, .sample_point = 75, .sync_jump = 1};
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_init(0, &config, NULL));
+
+    // Node 0 has no callback and no filter, so it hears nothing
+    int node_a = simulith_can_attach(0, test_can_rx_cb);
+    int node_b = simulith_can_attach(0, NULL);
+    int node_c = simulith_can_attach(0, NULL);
+    TEST_ASSERT_EQUAL_INT(1, node_a);
+    TEST_ASSERT_EQUAL_INT(2, node_b);
+    TEST_ASSERT_EQUAL_INT(3, node_c);
+
+    // Node B only accepts 0x1xx, node C accepts everything standard
+    simulith_can_filter_t filter_b = {.id = 0x100, .mask = 0x700, .is_extended = 0};
+    simulith_can_filter_t filter_c = {.id = 0x000, .mask = 0x000, .is_extended = 0};
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_add_filter(0, node_b, &filter_b, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_add_filter(0, node_c, &filter_c, NULL, NULL));
+
+    simulith_can_fd_message_t tx_msg = {.id = 0x123, .len = 2, .data = {0x12, 0x34}};
+    simulith_can_fd_message_t rx_msg;
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_send(0, node_a, &tx_msg));
+    tx_msg.id = 0x234;
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_send(0, node_a, &tx_msg));
+
+    // The sender does not hear itself, the others filter independently
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_receive(0, node_a, &rx_msg));
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, node_b, &rx_msg));
+    TEST_ASSERT_EQUAL_UINT32(0x123, rx_msg.id);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(tx_msg.data, rx_msg.data, 2);
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_receive(0, node_b, &rx_msg));
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, node_c, &rx_msg));
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, node_c, &rx_msg));
+    TEST_ASSERT_EQUAL_UINT32(0x234, rx_msg.id);
+
+    // Frames sent from node 0 reach attached nodes
+    simulith_can_message_t classic = {.id = 0x150, .dlc = 1, .data = {0x55}};
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &classic));
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, node_b, &rx_msg));
+    TEST_ASSERT_EQUAL_UINT32(0x150, rx_msg.id);
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, node_c, &rx_msg));
+
+    // Node A dispatches immediately
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_set_dispatch_mode(0, node_a, SIMULITH_CAN_DISPATCH_IMMEDIATE));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_send(0, node_b, &tx_msg));
+    TEST_ASSERT_EQUAL_INT(1, test_rx_count);
+    TEST_ASSERT_EQUAL_UINT32(0x234, last_received_msg.id);
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, node_c, &rx_msg));
+
+    // Slots return to the shared pool once every node has consumed them
+    for (int i = 0; i < 1000; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(0, simulith_can_node_send(0, node_a, &tx_msg));
+        TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, node_c, &rx_msg));
+    }
+
+    // Detached nodes release their queued frames and stop receiving
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_send(0, node_a, &tx_msg));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_detach(0, node_c));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_node_receive(0, node_c, &rx_msg));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_detach(0, 0));
+
+    // Clean up
+    simulith_can_close(0);
+}
+
+void test_can_lagging_nodes(void)
+{
+    simulith_can_config_t     config = {.bitrate      = SIMULITH_CAN_BITRATE_500K,
+                                        .sample_point = 75,
+                                        .sync_jump    = 1,
+                                        .data_bitrate = SIMULITH_CAN_FD_BITRATE_2M};
+    simulith_can_filter_t     filter = {.id = 0x000, .mask = 0x000, .is_extended = 0};
+    simulith_can_fd_message_t frame  = {.id = 0x321, .len = 64};
+    simulith_can_fd_message_t rx_msg;
+    uint64_t                  dropped;
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_init(0, &config, NULL));
+
+    // One active node, every other node polls but never receives
+    int active = simulith_can_attach(0, NULL);
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_add_filter(0, active, &filter, NULL, NULL));
+    for (int i = 2; i < SIMULITH_CAN_MAX_NODES; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(i, simulith_can_attach(0, NULL));
+        TEST_ASSERT_EQUAL_INT(0, simulith_can_node_add_filter(0, i, &filter, NULL, NULL));
+    }
+
+    // Their full queues hold frames in the pool, yet the bus keeps going for the active node
+    for (int i = 0; i < 500; i++)
+    {
+        frame.flags = (i < 250) ? SIMULITH_CAN_FLAG_FDF : 0;
+        frame.len   = (i < 250) ? 64 : 8;
+        TEST_ASSERT_EQUAL_INT(0, simulith_can_node_send(0, 0, &frame));
+        TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, active, &rx_msg));
+        TEST_ASSERT_EQUAL_UINT32(0x321, rx_msg.id);
+    }
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_get_dropped(0, active, &dropped));
+    TEST_ASSERT_EQUAL_UINT64(0, dropped);
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_get_dropped(0, SIMULITH_CAN_MAX_NODES - 1, &dropped));
+    TEST_ASSERT_EQUAL_UINT64(500 - 32, dropped);
+
+    // A lagging node still gets the oldest frames it kept
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, 2, &rx_msg));
+    TEST_ASSERT_EQUAL_UINT8(64, rx_msg.len);
+
+    simulith_can_close(0);
+}
+
+void test_can_timing(void)
+{
+    simulith_can_config_t config = {
+        .bitrate = SIMULITH_CAN_BITRATE_500K, .sample_point = 75, .sync_jump = 1, .data_bitrate = SIMULITH_CAN_FD_BITRATE_2M};
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_init(0, &config, NULL));
+    int node = simulith_can_attach(0, NULL);
+    TEST_ASSERT_EQUAL_INT(1, node);
+
+    simulith_can_filter_t filter = {.id = 0x000, .mask = 0x000, .is_extended = 0};
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_add_filter(0, node, &filter, NULL, NULL));
+
+    // 47 bits plus 6 stuff bits in the run of zeros, 2 us per bit at 500 kbit/s
+    simulith_can_fd_message_t frame = {.id = 0x000, .len = 0};
+    TEST_ASSERT_EQUAL_INT64(53 * 2000, simulith_can_frame_duration_ns(0, &frame));
+
+    // Longer frames take longer, bit rate switching shortens the data phase
+    int64_t empty = simulith_can_frame_duration_ns(0, &frame);
+    frame.len     = 8;
+    TEST_ASSERT_TRUE(simulith_can_frame_duration_ns(0, &frame) >= empty + 64 * 2000);
+    frame.len     = 64;
+    frame.flags   = SIMULITH_CAN_FLAG_FDF;
+    int64_t slow  = simulith_can_frame_duration_ns(0, &frame);
+    frame.flags  |= SIMULITH_CAN_FLAG_BRS;
+    int64_t fast  = simulith_can_frame_duration_ns(0, &frame);
+    TEST_ASSERT_TRUE(fast < slow / 2);
+    frame.len = 65;
+    TEST_ASSERT_EQUAL_INT64(-1, simulith_can_frame_duration_ns(0, &frame));
+
+    // Frames sent together are delivered in ID order as time advances
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_set_timing(0, true));
+    simulith_can_message_t msgs[3] = {
+        {.id = 0x200, .dlc = 8}, {.id = 0x100, .dlc = 8}, {.id = 0x300, .dlc = 8}};
+    TEST_ASSERT_EQUAL_INT(3, simulith_can_send_batch(0, msgs, 3));
+
+    simulith_can_fd_message_t rx_msg;
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_advance(0, 1000));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_receive(0, node, &rx_msg));
+    TEST_ASSERT_EQUAL_INT(3, simulith_can_advance(0, 1000000));
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, node, &rx_msg));
+    TEST_ASSERT_EQUAL_UINT32(0x100, rx_msg.id);
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, node, &rx_msg));
+    TEST_ASSERT_EQUAL_UINT32(0x200, rx_msg.id);
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, node, &rx_msg));
+    TEST_ASSERT_EQUAL_UINT32(0x300, rx_msg.id);
+
+    // Utilization is the time spent transmitting over the elapsed time
+    int64_t busy = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        simulith_can_fd_message_t fd = {.id = msgs[i].id, .len = 8};
+        busy += simulith_can_frame_duration_ns(0, &fd);
+    }
+
+    simulith_can_bus_stats_t stats;
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(1000000, stats.time_ns);
+    TEST_ASSERT_EQUAL_UINT64(busy, stats.busy_ns);
+    TEST_ASSERT_EQUAL_UINT64(3, stats.frames);
+    TEST_ASSERT_EQUAL_UINT64(busy, stats.max_latency_ns);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.pending);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, (float)busy / 1000000.0f, (float)stats.utilization);
+
+    // Time cannot go backwards, disabling delivers what is still pending
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_advance(0, 999));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &msgs[0]));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT32(1, stats.pending);
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_set_timing(0, false));
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_node_receive(0, node, &rx_msg));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_advance(0, 0));
+
+    // A batch stops at the first frame that does not fit in the transmit queue
+    simulith_can_message_t batch[70];
+    for (int i = 0; i < 70; i++)
+    {
+        batch[i] = (simulith_can_message_t) {.id = 0x400 + i, .dlc = 1};
+    }
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_set_timing(0, true));
+    TEST_ASSERT_EQUAL_INT(64, simulith_can_send_batch(0, batch, 70));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_can_send_batch(0, batch, 1));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_set_timing(0, false));
+
+    // Clean up
+    simulith_can_close(0);
+}
+
+#define CONCURRENT_SENDERS 4
+#define CONCURRENT_FRAMES  2000
+
+static atomic_int senders_done;
+
+static void *concurrent_sender(void *arg)
+{
+    int                       node = *(int *)arg;
+    simulith_can_fd_message_t msg  = {.id = node, .len = 4};
+
+    for (uint32_t i = 0; i < CONCURRENT_FRAMES; i++)
+    {
+        memcpy(msg.data, &i, sizeof(i));
+        simulith_can_node_send(0, node, &msg);
+    }
+    atomic_fetch_add(&senders_done, 1);
+    return NULL;
+}
+
+void test_can_concurrent(void)
+{
+    simulith_can_config_t config = {.bitrate = SIMULITH_CAN_BITRATE_1M, .sample_point = 75, .sync_jump = 1};
+    simulith_can_filter_t filter = {.id = 0x000, .mask = 0x000, .is_extended = 0};
+    pthread_t             threads[CONCURRENT_SENDERS];
+    int                   nodes[CONCURRENT_SENDERS];
+    int64_t               last_seq[CONCURRENT_SENDERS + 1];
+    int                   received = 0;
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_init(0, &config, NULL));
+    TEST_ASSERT_TRUE(simulith_can_add_filter(0, &filter) >= 0);
+    atomic_store(&senders_done, 0);
+
+    for (int i = 0; i < CONCURRENT_SENDERS; i++)
+    {
+        nodes[i]        = simulith_can_attach(0, NULL);
+        last_seq[i + 1] = -1;
+        TEST_ASSERT_EQUAL_INT(i + 1, nodes[i]);
+    }
+    for (int i = 0; i < CONCURRENT_SENDERS; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, concurrent_sender, &nodes[i]));
+    }
+
+    // Frames from one sender arrive in order, a full queue may drop some
+    simulith_can_message_t msg;
+    while (true)
+    {
+        bool done = atomic_load(&senders_done) == CONCURRENT_SENDERS;
+        int  result;
+
+        while ((result = simulith_can_receive(0, &msg)) == 1)
+        {
+            uint32_t seq;
+            memcpy(&seq, msg.data, sizeof(seq));
+            TEST_ASSERT_TRUE(msg.id >= 1 && msg.id <= CONCURRENT_SENDERS);
+            TEST_ASSERT_TRUE((int64_t)seq > last_seq[msg.id]);
+            last_seq[msg.id] = seq;
+            received++;
+        }
+        TEST_ASSERT_EQUAL_INT(0, result);
+        if (done)
+            break;
+    }
+
+    for (int i = 0; i < CONCURRENT_SENDERS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    TEST_ASSERT_TRUE(received > 0);
+    TEST_ASSERT_TRUE(received <= CONCURRENT_SENDERS * CONCURRENT_FRAMES);
+
+    // Every slot went back to the pool
+    simulith_can_message_t tx_msg = {.id = 0x100, .dlc = 1};
+    for (int i = 0; i < 1000; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &tx_msg));
+        TEST_ASSERT_EQUAL_INT(1, simulith_can_receive(0, &msg));
+    }
+
+    // Clean up
+    simulith_can_close(0);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -169,6 +624,13 @@ int main(void)
     RUN_TEST(test_can_filters);
     RUN_TEST(test_can_send_receive);
     RUN_TEST(test_can_multiple_buses);
+    RUN_TEST(test_can_batch);
+    RUN_TEST(test_can_fd);
+    RUN_TEST(test_can_dispatch);
+    RUN_TEST(test_can_multi_node);
+    RUN_TEST(test_can_lagging_nodes);
+    RUN_TEST(test_can_timing);
+    RUN_TEST(test_can_concurrent);
 
     return UNITY_END();
 }
\ No newline at end of file
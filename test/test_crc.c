@@ -0,0 +1,130 @@
+#include "simulith_crc.h"
+#include "unity.h"
+#include <string.h>
+
+void setUp(void)
+{
+    // Setup code if needed
+}
+
+void tearDown(void)
+{
+    // Cleanup code if needed
+}
+
+// Bit at a time references
+static uint16_t crc16_bitwise(const uint8_t *data, size_t len)
+{
+    uint16_t crc = SIMULITH_CRC16_CCITT_INIT;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i] << 8;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+static uint16_t crc16_x25_bitwise(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+    }
+    return ~crc;
+}
+
+static uint32_t crc32c_bitwise(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+    }
+    return ~crc;
+}
+
+void test_crc_check_values(void)
+{
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, simulith_crc16_ccitt(SIMULITH_CRC16_CCITT_INIT, "123456789", 9));
+    TEST_ASSERT_EQUAL_HEX16(0x906E, simulith_crc16_x25(0, "123456789", 9));
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283, simulith_crc32c(0, "123456789", 9));
+    TEST_ASSERT_EQUAL_HEX16(SIMULITH_CRC16_CCITT_INIT, simulith_crc16_ccitt(SIMULITH_CRC16_CCITT_INIT, "", 0));
+    TEST_ASSERT_EQUAL_HEX32(0, simulith_crc32c(0, "", 0));
+}
+
+void test_crc_matches_bitwise(void)
+{
+    uint8_t data[1031];
+
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(i * 131 + 7);
+
+    // Every alignment and tail length of the eight byte steps, and pieces
+    for (size_t offset = 0; offset < 8; offset++)
+    {
+        for (size_t len = 0; len < 40; len++)
+        {
+            TEST_ASSERT_EQUAL_HEX16(crc16_bitwise(&data[offset], len),
+                                    simulith_crc16_ccitt(SIMULITH_CRC16_CCITT_INIT, &data[offset], len));
+            TEST_ASSERT_EQUAL_HEX16(crc16_x25_bitwise(&data[offset], len), simulith_crc16_x25(0, &data[offset], len));
+            TEST_ASSERT_EQUAL_HEX32(crc32c_bitwise(&data[offset], len), simulith_crc32c(0, &data[offset], len));
+        }
+    }
+
+    uint16_t crc16  = simulith_crc16_ccitt(SIMULITH_CRC16_CCITT_INIT, data, 513);
+    uint16_t x25    = simulith_crc16_x25(0, data, 513);
+    uint32_t crc32c = simulith_crc32c(0, data, 513);
+    TEST_ASSERT_EQUAL_HEX16(crc16_bitwise(data, sizeof(data)), simulith_crc16_ccitt(crc16, &data[513], 518));
+    TEST_ASSERT_EQUAL_HEX16(crc16_x25_bitwise(data, sizeof(data)), simulith_crc16_x25(x25, &data[513], 518));
+    TEST_ASSERT_EQUAL_HEX32(crc32c_bitwise(data, sizeof(data)), simulith_crc32c(crc32c, &data[513], 518));
+}
+
+void test_crc_stamp_check(void)
+{
+    uint8_t frame[16] = {0x08, 0x00, 0xC0, 0x00, 0x00, 0x03, 0x01, 0x02, 0x03, 0x04};
+
+    TEST_ASSERT_EQUAL_size_t(0, simulith_crc_size(SIMULITH_CRC_NONE));
+    TEST_ASSERT_EQUAL_size_t(2, simulith_crc_size(SIMULITH_CRC_CRC16_CCITT));
+    TEST_ASSERT_EQUAL_size_t(2, simulith_crc_size(SIMULITH_CRC_CRC16_X25));
+    TEST_ASSERT_EQUAL_size_t(4, simulith_crc_size(SIMULITH_CRC_CRC32C));
+
+    TEST_ASSERT_EQUAL_size_t(10, simulith_crc_stamp(SIMULITH_CRC_NONE, frame, 10));
+    TEST_ASSERT_TRUE(simulith_crc_check(SIMULITH_CRC_NONE, frame, 10));
+
+    // FECF, most significant byte first
+    TEST_ASSERT_EQUAL_size_t(12, simulith_crc_stamp(SIMULITH_CRC_CRC16_CCITT, frame, 10));
+    TEST_ASSERT_EQUAL_HEX16(simulith_crc16_ccitt(SIMULITH_CRC16_CCITT_INIT, frame, 10), frame[10] << 8 | frame[11]);
+    TEST_ASSERT_TRUE(simulith_crc_check(SIMULITH_CRC_CRC16_CCITT, frame, 12));
+    frame[3] ^= 0x10;
+    TEST_ASSERT_FALSE(simulith_crc_check(SIMULITH_CRC_CRC16_CCITT, frame, 12));
+
+    // HDLC FCS, least significant byte first
+    frame[3] ^= 0x10;
+    TEST_ASSERT_EQUAL_size_t(12, simulith_crc_stamp(SIMULITH_CRC_CRC16_X25, frame, 10));
+    TEST_ASSERT_EQUAL_HEX16(simulith_crc16_x25(0, frame, 10), frame[11] << 8 | frame[10]);
+    TEST_ASSERT_TRUE(simulith_crc_check(SIMULITH_CRC_CRC16_X25, frame, 12));
+
+    TEST_ASSERT_EQUAL_size_t(14, simulith_crc_stamp(SIMULITH_CRC_CRC32C, frame, 10));
+    TEST_ASSERT_TRUE(simulith_crc_check(SIMULITH_CRC_CRC32C, frame, 14));
+    frame[13] ^= 0x01;
+    TEST_ASSERT_FALSE(simulith_crc_check(SIMULITH_CRC_CRC32C, frame, 14));
+    TEST_ASSERT_FALSE(simulith_crc_check(SIMULITH_CRC_CRC32C, frame, 3));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_crc_check_values);
+    RUN_TEST(test_crc_matches_bitwise);
+    RUN_TEST(test_crc_stamp_check);
+    return UNITY_END();
+}
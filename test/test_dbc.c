@@ -0,0 +1,144 @@
+#include "simulith_can.h"
+#include "sat_dbc.h"
+#include "unity.h"
+#include <string.h>
+
+static int                 eps_count = 0;
+static sat_eps_status_t    last_eps;
+static sat_adcs_attitude_t last_attitude;
+
+void setUp(void)
+{
+    eps_count = 0;
+    memset(&last_eps, 0, sizeof(last_eps));
+    memset(&last_attitude, 0, sizeof(last_attitude));
+}
+
+void tearDown(void)
+{
+    // Cleanup code if needed
+}
+
+static int on_eps_status(uint8_t bus_id, const sat_eps_status_t *msg, void *ctx)
+{
+    eps_count++;
+    memcpy(&last_eps, msg, sizeof(*msg));
+    return 0;
+}
+
+static int on_adcs_attitude(uint8_t bus_id, const sat_adcs_attitude_t *msg, void *ctx)
+{
+    int *count = (int *)ctx;
+    (*count)++;
+    memcpy(&last_attitude, msg, sizeof(*msg));
+    return 0;
+}
+
+void test_dbc_intel_signals(void)
+{
+    sat_eps_status_t msg = {.bus_voltage = 28000, .bus_current = -150, .mode = 0xA, .temperature = -20};
+    sat_eps_status_t decoded;
+    uint8_t          data[SAT_EPS_STATUS_LEN];
+
+    sat_eps_status_pack(data, &msg);
+    TEST_ASSERT_EQUAL_HEX8(0x60, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x6D, data[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x6A, data[2]);
+    TEST_ASSERT_EQUAL_HEX8(0xAF, data[3]);
+    TEST_ASSERT_EQUAL_HEX8(0xEC, data[4]);
+
+    sat_eps_status_unpack(&decoded, data);
+    TEST_ASSERT_EQUAL_UINT16(28000, decoded.bus_voltage);
+    TEST_ASSERT_EQUAL_INT16(-150, decoded.bus_current);
+    TEST_ASSERT_EQUAL_UINT8(0xA, decoded.mode);
+    TEST_ASSERT_EQUAL_INT8(-20, decoded.temperature);
+
+    // Physical values
+    TEST_ASSERT_EQUAL_UINT16(28000, sat_eps_status_bus_voltage_encode(28.0));
+    TEST_ASSERT_EQUAL_INT16(-150, sat_eps_status_bus_current_encode(-1.5));
+    TEST_ASSERT_EQUAL_INT8(-20, sat_eps_status_temperature_encode(-50.0));
+    TEST_ASSERT_TRUE(sat_eps_status_temperature_decode(decoded.temperature) == -50.0);
+}
+
+void test_dbc_motorola_signals(void)
+{
+    sat_adcs_attitude_t msg = {.roll = -2, .pitch = 0x1234, .valid = 1, .counter = 0x2A};
+    sat_adcs_attitude_t decoded;
+    uint8_t             data[SAT_ADCS_ATTITUDE_LEN];
+
+    sat_adcs_attitude_pack(data, &msg);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xFE, data[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x12, data[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x34, data[3]);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, data[4]);
+
+    sat_adcs_attitude_unpack(&decoded, data);
+    TEST_ASSERT_EQUAL_INT16(-2, decoded.roll);
+    TEST_ASSERT_EQUAL_INT16(0x1234, decoded.pitch);
+    TEST_ASSERT_EQUAL_UINT8(1, decoded.valid);
+    TEST_ASSERT_EQUAL_UINT8(0x2A, decoded.counter);
+}
+
+void test_dbc_dispatch(void)
+{
+    simulith_can_config_t config = {.bitrate = SIMULITH_CAN_BITRATE_500K, .sample_point = 75, .sync_jump = 1};
+    int                   attitude_count = 0;
+    sat_handlers_t        handlers       = {
+        .on_eps_status = on_eps_status, .on_adcs_attitude = on_adcs_attitude, .ctx = &attitude_count};
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_init(0, &config, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_set_dispatch_mode(0, SIMULITH_CAN_DISPATCH_IMMEDIATE));
+
+    // One filter per ID format routes every frame through the generated table
+    simulith_can_filter_t std_filter = {.id = 0, .mask = 0, .is_extended = 0};
+    simulith_can_filter_t ext_filter = {.id = 0, .mask = 0, .is_extended = 1};
+    TEST_ASSERT_TRUE(simulith_can_add_filter_callback(0, &std_filter, sat_dispatch, &handlers) >= 0);
+    TEST_ASSERT_TRUE(simulith_can_add_filter_callback(0, &ext_filter, sat_dispatch, &handlers) >= 0);
+
+    sat_eps_status_t       eps   = {.bus_voltage = 3300, .mode = 2};
+    simulith_can_message_t frame = {.id = SAT_EPS_STATUS_ID, .dlc = SAT_EPS_STATUS_LEN};
+    sat_eps_status_pack(frame.data, &eps);
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &frame));
+    TEST_ASSERT_EQUAL_INT(1, eps_count);
+    TEST_ASSERT_EQUAL_UINT16(3300, last_eps.bus_voltage);
+    TEST_ASSERT_EQUAL_UINT8(2, last_eps.mode);
+
+    sat_adcs_attitude_t attitude = {.roll = 100, .pitch = -100};
+    frame.id          = SAT_ADCS_ATTITUDE_ID;
+    frame.is_extended = SAT_ADCS_ATTITUDE_IS_EXTENDED;
+    sat_adcs_attitude_pack(frame.data, &attitude);
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &frame));
+    TEST_ASSERT_EQUAL_INT(1, attitude_count);
+    TEST_ASSERT_EQUAL_INT16(-100, last_attitude.pitch);
+
+    // The same ID in the other format, unknown IDs and unhandled messages are ignored
+    frame.is_extended = 0;
+    frame.id          = SAT_ADCS_ATTITUDE_ID & SIMULITH_CAN_ID_STD_MAX;
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &frame));
+    frame.id = 0x7FF;
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &frame));
+    TEST_ASSERT_EQUAL_INT(1, eps_count);
+    TEST_ASSERT_EQUAL_INT(1, attitude_count);
+
+    simulith_can_fd_message_t block = {.id = SAT_PAYLOAD_BLOCK_ID, .len = SAT_PAYLOAD_BLOCK_LEN};
+    TEST_ASSERT_EQUAL_INT(0, sat_dispatch(0, &block, &handlers));
+
+    // Frames shorter than the message are rejected
+    simulith_can_fd_message_t short_frame = {.id = SAT_EPS_STATUS_ID, .len = 4};
+    TEST_ASSERT_EQUAL_INT(-1, sat_dispatch(0, &short_frame, &handlers));
+
+    // Clean up
+    simulith_can_close(0);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_dbc_intel_signals);
+    RUN_TEST(test_dbc_motorola_signals);
+    RUN_TEST(test_dbc_dispatch);
+
+    return UNITY_END();
+}
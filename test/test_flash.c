@@ -0,0 +1,282 @@
+#include "simulith_flash.h"
+#include "simulith_i2c.h"
+#include "simulith_spi.h"
+#include "unity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define IMAGE_SIZE (128 * 1024)
+
+static char image_path[] = "/tmp/simulith_flash_XXXXXX";
+
+void setUp(void)
+{
+    simulith_spi_config_t config = {.clock_hz    = 10000000,
+                                    .mode        = SIMULITH_SPI_MODE_0,
+                                    .bit_order   = SIMULITH_SPI_MSB_FIRST,
+                                    .cs_polarity = SIMULITH_SPI_CS_ACTIVE_LOW,
+                                    .data_bits   = 8};
+    uint8_t               block[4096];
+
+    strcpy(image_path, "/tmp/simulith_flash_XXXXXX");
+    int fd = mkstemp(image_path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    for (int i = 0; i < IMAGE_SIZE / (int)sizeof(block); i++)
+    {
+        for (size_t j = 0; j < sizeof(block); j++)
+            block[j] = (uint8_t)(i + j);
+        TEST_ASSERT_EQUAL_INT(sizeof(block), write(fd, block, sizeof(block)));
+    }
+    close(fd);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_init(0, &config, NULL));
+}
+
+void tearDown(void)
+{
+    simulith_spi_close(0);
+    unlink(image_path);
+}
+
+static int spi_command(const uint8_t *command, size_t command_len, uint8_t *rx_data, size_t rx_len)
+{
+    simulith_spi_segment_t segments[] = {
+        {.tx_data = command, .rx_data = NULL, .len = command_len},
+        {.tx_data = NULL, .rx_data = rx_data, .len = rx_len},
+    };
+    return simulith_spi_transact(0, 0, segments, rx_data ? 2 : 1);
+}
+
+void test_flash_open(void)
+{
+    simulith_flash_config_t config = {.type = SIMULITH_FLASH_NOR};
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_flash_open("/tmp/simulith_no_such_image", &config));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_flash_open(image_path, NULL));
+    config.page_size = 300;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_flash_open(image_path, &config));
+    config.page_size = 0;
+
+    int flash_id = simulith_flash_open(image_path, &config);
+    TEST_ASSERT_TRUE(flash_id >= 0);
+    TEST_ASSERT_EQUAL_UINT64(IMAGE_SIZE, simulith_flash_size(flash_id));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_flash_attach_spi(flash_id, 1, 0));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_flash_attach_spi(flash_id, 0, SIMULITH_SPI_MAX_CS));
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_close(flash_id));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_flash_close(flash_id));
+    TEST_ASSERT_EQUAL_UINT64(0, simulith_flash_size(flash_id));
+}
+
+void test_flash_spi_nor(void)
+{
+    simulith_flash_config_t config    = {.type = SIMULITH_FLASH_NOR, .jedec_id = 0xEF4018};
+    const uint8_t           jedec[]   = {0x9F};
+    const uint8_t           read[]    = {0x03, 0x01, 0x23, 0x40};
+    const uint8_t           wren[]    = {0x06};
+    const uint8_t           status[]  = {0x05};
+    const uint8_t           program[] = {0x02, 0x00, 0x10, 0xFE, 0x0F, 0x0F, 0x0F, 0x0F};
+    const uint8_t           erase[]   = {0x20, 0x00, 0x20, 0x10};
+    uint8_t                 data[16];
+
+    int flash_id = simulith_flash_open(image_path, &config);
+    TEST_ASSERT_TRUE(flash_id >= 0);
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_attach_spi(flash_id, 0, 0));
+
+    TEST_ASSERT_EQUAL_INT(4, spi_command(jedec, sizeof(jedec), data, 3));
+    TEST_ASSERT_EQUAL_HEX8(0xEF, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x40, data[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x18, data[2]);
+
+    // Block 0x12 holds 0x12 + offset
+    TEST_ASSERT_EQUAL_INT(20, spi_command(read, sizeof(read), data, 16));
+    for (int i = 0; i < 16; i++)
+        TEST_ASSERT_EQUAL_HEX8((uint8_t)(0x12 + 0x340 + i), data[i]);
+
+    // Programming needs write enable, only clears bits and wraps within the page
+    TEST_ASSERT_EQUAL_INT(8, spi_command(program, sizeof(program), NULL, 0));
+    TEST_ASSERT_EQUAL_INT(1, simulith_flash_read(flash_id, 0x10FE, data, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x01 + 0xFE, data[0]);
+
+    TEST_ASSERT_EQUAL_INT(1, spi_command(wren, sizeof(wren), NULL, 0));
+    TEST_ASSERT_EQUAL_INT(2, spi_command(status, sizeof(status), data, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x02, data[0]);
+    TEST_ASSERT_EQUAL_INT(8, spi_command(program, sizeof(program), NULL, 0));
+    TEST_ASSERT_EQUAL_INT(2, spi_command(status, sizeof(status), data, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x00, data[0]);
+
+    TEST_ASSERT_EQUAL_INT(2, simulith_flash_read(flash_id, 0x10FE, data, 2));
+    TEST_ASSERT_EQUAL_HEX8(0xFF & 0x0F, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00 & 0x0F, data[1]);
+    TEST_ASSERT_EQUAL_INT(2, simulith_flash_read(flash_id, 0x1000, data, 2));
+    TEST_ASSERT_EQUAL_HEX8(0x01 & 0x0F, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x02 & 0x0F, data[1]);
+
+    // Data split across segments fills one page buffer, the last byte replacing the first
+    const uint8_t          page_program[] = {0x02, 0x00, 0x51, 0x00};
+    uint8_t                fill[256];
+    simulith_spi_segment_t segments[]     = {
+        {.tx_data = page_program, .len = sizeof(page_program)},
+        {.tx_data = fill, .len = 200},
+        {.tx_data = fill + 1, .len = 57},
+    };
+    memset(fill, 0xFF, sizeof(fill));
+    fill[0]  = 0x01;
+    fill[57] = 0x04;
+    TEST_ASSERT_EQUAL_INT(1, spi_command(wren, sizeof(wren), NULL, 0));
+    TEST_ASSERT_EQUAL_INT(261, simulith_spi_transact(0, 0, segments, 3));
+    TEST_ASSERT_EQUAL_INT(1, simulith_flash_read(flash_id, 0x5100, data, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x04 & 0x05, data[0]);
+
+    // Sector erase takes effect when the chip select is released
+    TEST_ASSERT_EQUAL_INT(1, spi_command(wren, sizeof(wren), NULL, 0));
+    TEST_ASSERT_EQUAL_INT(4, spi_command(erase, sizeof(erase), NULL, 0));
+    TEST_ASSERT_EQUAL_INT(16, simulith_flash_read(flash_id, 0x2000, data, 16));
+    for (int i = 0; i < 16; i++)
+        TEST_ASSERT_EQUAL_HEX8(0xFF, data[i]);
+    TEST_ASSERT_EQUAL_INT(1, simulith_flash_read(flash_id, 0x3000, data, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x03, data[0]);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_close(flash_id));
+
+    // Copy-on-write left the image alone
+    FILE *image = fopen(image_path, "rb");
+    TEST_ASSERT_NOT_NULL(image);
+    TEST_ASSERT_EQUAL_INT(0, fseek(image, 0x2000, SEEK_SET));
+    TEST_ASSERT_EQUAL_INT(2, fread(data, 1, 2, image));
+    fclose(image);
+    TEST_ASSERT_EQUAL_HEX8(0x02, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x03, data[1]);
+}
+
+void test_flash_persist_eeprom(void)
+{
+    simulith_flash_config_t config = {.type = SIMULITH_FLASH_EEPROM, .page_size = 64, .persist = true};
+    const uint8_t           bytes[] = {0x00, 0x55, 0xAA};
+    uint8_t                 data[3];
+
+    int flash_id = simulith_flash_open(image_path, &config);
+    TEST_ASSERT_TRUE(flash_id >= 0);
+
+    // EEPROM bytes are overwritten, not ANDed
+    TEST_ASSERT_EQUAL_INT(3, simulith_flash_program(flash_id, 0x100, bytes, sizeof(bytes)));
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_close(flash_id));
+
+    flash_id = simulith_flash_open(image_path, &config);
+    TEST_ASSERT_TRUE(flash_id >= 0);
+    TEST_ASSERT_EQUAL_INT(3, simulith_flash_read(flash_id, 0x100, data, 3));
+    TEST_ASSERT_EQUAL_MEMORY(bytes, data, 3);
+    TEST_ASSERT_EQUAL_INT(-1, simulith_flash_read(flash_id, IMAGE_SIZE - 1, data, 3));
+
+    // Longer than a page, the last 64 bytes wrap around the page and the first 6 are lost
+    uint8_t block[70];
+    for (int i = 0; i < 70; i++)
+        block[i] = i;
+    TEST_ASSERT_EQUAL_INT(70, simulith_flash_program(flash_id, 0x200, block, sizeof(block)));
+    TEST_ASSERT_EQUAL_INT(3, simulith_flash_read(flash_id, 0x205, data, 3));
+    TEST_ASSERT_EQUAL_HEX8(69, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(6, data[1]);
+    TEST_ASSERT_EQUAL_HEX8(7, data[2]);
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_close(flash_id));
+}
+
+void test_flash_i2c_eeprom(void)
+{
+    simulith_flash_config_t config    = {.type = SIMULITH_FLASH_EEPROM, .page_size = 32};
+    uint8_t                 pointer[] = {0x01, 0x23};
+    uint8_t                 write[]   = {0x00, 0x1E, 0xA0, 0xA1, 0xA2, 0xA3};
+    uint8_t                 data[4];
+    simulith_i2c_msg_t      random[]  = {{.addr = 0x50, .buf = pointer, .len = sizeof(pointer)},
+                                         {.addr = 0x50, .flags = SIMULITH_I2C_M_RD, .buf = data, .len = 4}};
+    simulith_i2c_msg_t      current   = {.addr = 0x50, .flags = SIMULITH_I2C_M_RD, .buf = data, .len = 2};
+    simulith_i2c_msg_t      page      = {.addr = 0x50, .buf = write, .len = sizeof(write)};
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_init(0, NULL, NULL));
+
+    // Too large for a two byte address pointer
+    int flash_id = simulith_flash_open(image_path, &config);
+    TEST_ASSERT_TRUE(flash_id >= 0);
+    TEST_ASSERT_EQUAL_INT(-1, simulith_flash_attach_i2c(flash_id, 0, 0x50));
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_close(flash_id));
+
+    // A 24C32: two byte pointer, 32 byte pages
+    TEST_ASSERT_EQUAL_INT(0, truncate(image_path, 4096));
+    flash_id = simulith_flash_open(image_path, &config);
+    TEST_ASSERT_TRUE(flash_id >= 0);
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_attach_i2c(flash_id, 0, 0x50));
+
+    TEST_ASSERT_EQUAL_INT(2, simulith_i2c_transfer(0, random, 2));
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL_HEX8(0x23 + i, data[i]);
+
+    // The pointer stays where the last read stopped
+    TEST_ASSERT_EQUAL_INT(1, simulith_i2c_transfer(0, &current, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x27, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x28, data[1]);
+
+    // A page write wraps within the page, and so does the pointer
+    TEST_ASSERT_EQUAL_INT(1, simulith_i2c_transfer(0, &page, 1));
+    TEST_ASSERT_EQUAL_INT(3, simulith_flash_read(flash_id, 0x1E, data, 3));
+    TEST_ASSERT_EQUAL_HEX8(0xA0, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xA1, data[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x20, data[2]);
+    TEST_ASSERT_EQUAL_INT(3, simulith_flash_read(flash_id, 0x00, data, 3));
+    TEST_ASSERT_EQUAL_HEX8(0xA2, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xA3, data[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x02, data[2]);
+    TEST_ASSERT_EQUAL_INT(1, simulith_i2c_transfer(0, &current, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x02, data[0]);
+
+    // A one byte register select is not a whole pointer
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_read(0, 0x50, 0x00, data, 1));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_attach(0, 0x50, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_close(flash_id));
+
+    // A 24C02 has a one byte pointer, register accesses work as well
+    TEST_ASSERT_EQUAL_INT(0, truncate(image_path, 256));
+    config.page_size = 8;
+    flash_id         = simulith_flash_open(image_path, &config);
+    TEST_ASSERT_TRUE(flash_id >= 0);
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_attach_i2c(flash_id, 0, 0x50));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_write(0, 0x50, 0x16, &write[2], 3));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(0, 0x50, 0x10, data, 4));
+    TEST_ASSERT_EQUAL_HEX8(0xA2, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x11, data[1]);
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(0, 0x50, 0x16, data, 2));
+    TEST_ASSERT_EQUAL_HEX8(0xA0, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xA1, data[1]);
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_attach(0, 0x50, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_close(flash_id));
+}
+
+void test_flash_large_image(void)
+{
+    simulith_flash_config_t config  = {.type = SIMULITH_FLASH_NOR};
+    const uint8_t           read4[] = {0x13, 0x7F, 0xFF, 0xF0, 0x00};
+    uint8_t                 data[8];
+
+    // A sparse 2 GB image maps instantly, only the pages read are touched
+    TEST_ASSERT_EQUAL_INT(0, truncate(image_path, 2048LL * 1024 * 1024));
+    int flash_id = simulith_flash_open(image_path, &config);
+    TEST_ASSERT_TRUE(flash_id >= 0);
+    TEST_ASSERT_EQUAL_UINT64(2048ULL * 1024 * 1024, simulith_flash_size(flash_id));
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_attach_spi(flash_id, 0, 0));
+
+    TEST_ASSERT_EQUAL_INT(13, spi_command(read4, sizeof(read4), data, sizeof(data)));
+    TEST_ASSERT_EQUAL_HEX8(0x00, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, data[7]);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_flash_close(flash_id));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_flash_open);
+    RUN_TEST(test_flash_spi_nor);
+    RUN_TEST(test_flash_persist_eeprom);
+    RUN_TEST(test_flash_i2c_eeprom);
+    RUN_TEST(test_flash_large_image);
+    return UNITY_END();
+}
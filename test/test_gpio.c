@@ -124,6 +124,81 @@ void test_gpio_multiple_ports(void)
     }
 }
 
+void test_gpio_port(void)
+{
+    simulith_gpio_config_t output = {.mode = SIMULITH_GPIO_MODE_OUTPUT, .initial_state = 0};
+    simulith_gpio_config_t pullup = {.mode = SIMULITH_GPIO_MODE_INPUT_PULLUP};
+    uint32_t               mask;
+    uint8_t                value;
+
+    for (uint8_t pin = 0; pin < 8; pin++)
+    {
+        TEST_ASSERT_EQUAL_INT(0, simulith_gpio_init(1, pin, &output));
+    }
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_init(1, 31, &pullup));
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_port_read(1, &mask));
+    TEST_ASSERT_EQUAL_HEX32(0x80000000, mask);
+
+    // Only the pins in the mask change
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_port_write(1, 0x0F, 0xFFFFFFA5));
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_port_read(1, &mask));
+    TEST_ASSERT_EQUAL_HEX32(0x80000005, mask);
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_read(1, 2, &value));
+    TEST_ASSERT_EQUAL_UINT8(1, value);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_port_toggle(1, 0xF0 | 0x01));
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_port_read(1, &mask));
+    TEST_ASSERT_EQUAL_HEX32(0x800000F4, mask);
+
+    // An input or uninitialized pin in the mask fails the whole operation
+    TEST_ASSERT_EQUAL_INT(-1, simulith_gpio_port_write(1, 0x80000001, 0));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_gpio_port_toggle(1, 0x00000101));
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_port_read(1, &mask));
+    TEST_ASSERT_EQUAL_HEX32(0x800000F4, mask);
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_gpio_port_read(SIMULITH_GPIO_MAX_PORTS, &mask));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_gpio_port_read(1, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_gpio_port_write(SIMULITH_GPIO_MAX_PORTS, 0x01, 0x01));
+}
+
+void test_gpio_snapshot(void)
+{
+    simulith_gpio_config_t   output = {.mode = SIMULITH_GPIO_MODE_OUTPUT, .initial_state = 0};
+    simulith_gpio_snapshot_t before;
+    simulith_gpio_snapshot_t after;
+    simulith_gpio_snapshot_t changed;
+
+    for (uint8_t port = 0; port < SIMULITH_GPIO_MAX_PORTS; port++)
+    {
+        TEST_ASSERT_EQUAL_INT(0, simulith_gpio_init(port, 0, &output));
+        TEST_ASSERT_EQUAL_INT(0, simulith_gpio_init(port, 31, &output));
+    }
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_snapshot(&before));
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_diff(&before, &before, &changed));
+
+    // One tick of activity on two ports
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_port_toggle(2, 0x80000001));
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_write(7, 31, 1));
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_snapshot(&after));
+
+    TEST_ASSERT_EQUAL_INT(3, simulith_gpio_diff(&before, &after, &changed));
+    TEST_ASSERT_EQUAL_HEX32(0x80000001, changed.state[2]);
+    TEST_ASSERT_EQUAL_HEX32(0x80000000, changed.state[7]);
+    TEST_ASSERT_EQUAL_HEX32(0, changed.state[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x80000001, after.state[2]);
+
+    // Closing a pin clears its state
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_close(2, 0));
+    TEST_ASSERT_EQUAL_INT(0, simulith_gpio_snapshot(&before));
+    TEST_ASSERT_EQUAL_HEX32(0x80000000, before.state[2]);
+    TEST_ASSERT_EQUAL_INT(1, simulith_gpio_diff(&before, &after, NULL));
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_gpio_snapshot(NULL));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_gpio_diff(NULL, &after, NULL));
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -132,6 +207,8 @@ int main(void)
     RUN_TEST(test_gpio_output);
     RUN_TEST(test_gpio_input);
     RUN_TEST(test_gpio_multiple_ports);
+    RUN_TEST(test_gpio_port);
+    RUN_TEST(test_gpio_snapshot);
 
     return UNITY_END();
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "simulith_i2c.h"
 #include "unity.h"
+#include <errno.h>
 
 void setUp(void)
 {
@@ -78,6 +79,212 @@ void test_i2c_invalid_params(void)
     TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_write(0, 0x50, 0x00, data, 0)); // Zero length
 }
 
+typedef struct
+{
+    uint8_t regs[16];
+    int     accesses;
+} test_device_t;
+
+static int test_device_read(uint8_t bus_id, uint16_t addr, uint8_t reg, uint8_t *data, size_t len, void *ctx)
+{
+    test_device_t *device = ctx;
+
+    device->accesses++;
+    for (size_t i = 0; i < len; i++)
+        data[i] = device->regs[(reg + i) % sizeof(device->regs)];
+    return 0;
+}
+
+static int test_device_write(uint8_t bus_id, uint16_t addr, uint8_t reg, const uint8_t *data, size_t len, void *ctx)
+{
+    test_device_t *device = ctx;
+
+    device->accesses++;
+    for (size_t i = 0; i < len; i++)
+        device->regs[(reg + i) % sizeof(device->regs)] = data[i];
+    return 0;
+}
+
+void test_i2c_attach(void)
+{
+    const simulith_i2c_device_ops_t ops       = {.read = test_device_read, .write = test_device_write};
+    const simulith_i2c_device_ops_t no_write  = {.read = test_device_read};
+    test_device_t                   sensor    = {.regs = {0x11, 0x22}};
+    test_device_t                   sensor_10 = {.regs = {0x33}};
+    uint8_t                         data[2];
+
+    // A bus without callbacks NACKs addresses without a device
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_init(1, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_attach(1, 0x80, &ops, &sensor));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_attach(1, SIMULITH_I2C_ADDR_10BIT | 0x400, &ops, &sensor));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_attach(1, 0x48, &no_write, &sensor));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_attach(2, 0x48, &ops, &sensor));
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_attach(1, 0x48, &ops, &sensor));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_attach(1, 0x48, &ops, &sensor_10));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_attach(1, SIMULITH_I2C_ADDR_10BIT | 0x048, &ops, &sensor_10));
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(1, 0x48, 0x00, data, 2));
+    TEST_ASSERT_EQUAL_HEX8(0x11, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x22, data[1]);
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_write(1, SIMULITH_I2C_ADDR_10BIT | 0x048, 0x01, data, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x11, sensor_10.regs[1]);
+    TEST_ASSERT_EQUAL_INT(1, sensor.accesses);
+    TEST_ASSERT_EQUAL_INT(1, sensor_10.accesses);
+
+    errno = 0;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_read(1, 0x49, 0x00, data, 2));
+    TEST_ASSERT_EQUAL_INT(ENXIO, errno);
+
+    // Detached devices NACK
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_attach(1, 0x48, NULL, NULL));
+    errno = 0;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_write(1, 0x48, 0x00, data, 1));
+    TEST_ASSERT_EQUAL_INT(ENXIO, errno);
+    TEST_ASSERT_EQUAL_INT(1, sensor.accesses);
+
+    // Attached devices take precedence over the bus callbacks, which still get the rest
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_init(0, test_i2c_read_cb, test_i2c_write_cb));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_attach(0, 0x48, &ops, &sensor));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(0, 0x48, 0x00, data, 2));
+    TEST_ASSERT_EQUAL_INT(2, sensor.accesses);
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(0, 0x50, 0x00, data, 2));
+    TEST_ASSERT_EQUAL_HEX8(0xAA, data[0]);
+}
+
+typedef struct
+{
+    size_t calls;
+    size_t msgs;
+} test_combined_t;
+
+// Answers each read with the length of the message before it
+static int test_device_transfer(uint8_t bus_id, uint16_t addr, const simulith_i2c_msg_t *msgs, size_t count,
+                                void *ctx)
+{
+    test_combined_t *combined = ctx;
+
+    combined->calls++;
+    combined->msgs += count;
+    for (size_t i = 1; i < count; i++)
+    {
+        if (msgs[i].flags & SIMULITH_I2C_M_RD)
+            msgs[i].buf[0] = (uint8_t)msgs[i - 1].len;
+    }
+    return 0;
+}
+
+void test_i2c_transfer(void)
+{
+    const simulith_i2c_device_ops_t ops        = {.read = test_device_read, .write = test_device_write};
+    const simulith_i2c_device_ops_t combined   = {.read     = test_device_read,
+                                                  .write    = test_device_write,
+                                                  .transfer = test_device_transfer};
+    test_device_t                   sensor     = {.regs = {0x11, 0x22, 0x33}};
+    test_combined_t                 imu        = {0};
+    uint8_t                         select[]   = {0x01};
+    uint8_t                         write[]    = {0x02, 0x44, 0x55};
+    uint8_t                         burst[2]   = {0};
+    uint8_t                         imu_cmd[3] = {0x3B, 0x00, 0x00};
+    uint8_t                         imu_data[1];
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_init(1, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_attach(1, 0x1E, &ops, &sensor));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_attach(1, 0x68, &combined, &imu));
+
+    // Register write, register read with a repeated start, and a combined IMU burst
+    simulith_i2c_msg_t msgs[] = {
+        {.addr = 0x1E, .flags = 0, .buf = write, .len = sizeof(write)},
+        {.addr = 0x1E, .flags = 0, .buf = select, .len = sizeof(select)},
+        {.addr = 0x1E, .flags = SIMULITH_I2C_M_RD, .buf = burst, .len = sizeof(burst)},
+        {.addr = 0x68, .flags = 0, .buf = imu_cmd, .len = sizeof(imu_cmd)},
+        {.addr = 0x68, .flags = SIMULITH_I2C_M_RD, .buf = imu_data, .len = sizeof(imu_data)},
+    };
+    TEST_ASSERT_EQUAL_INT(5, simulith_i2c_transfer(1, msgs, 5));
+    TEST_ASSERT_EQUAL_HEX8(0x22, burst[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x44, burst[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x55, sensor.regs[3]);
+    TEST_ASSERT_EQUAL_INT(2, sensor.accesses);
+    TEST_ASSERT_EQUAL_size_t(1, imu.calls);
+    TEST_ASSERT_EQUAL_size_t(2, imu.msgs);
+    TEST_ASSERT_EQUAL_HEX8(3, imu_data[0]);
+
+    // A NACK anywhere leaves every device untouched
+    msgs[4].addr = 0x69;
+    errno        = 0;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_transfer(1, msgs, 5));
+    TEST_ASSERT_EQUAL_INT(ENXIO, errno);
+    TEST_ASSERT_EQUAL_INT(2, sensor.accesses);
+    TEST_ASSERT_EQUAL_size_t(1, imu.calls);
+
+    // A read without a register select cannot reach a register device
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_transfer(1, &msgs[2], 1));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_transfer(1, &msgs[1], 1));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_transfer(1, msgs, 0));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_transfer(1, NULL, 1));
+    TEST_ASSERT_EQUAL_INT(2, sensor.accesses);
+}
+
+void test_i2c_timing(void)
+{
+    const simulith_i2c_device_ops_t ops    = {.read = test_device_read, .write = test_device_write};
+    test_device_t                   sensor = {0};
+    simulith_i2c_bus_stats_t        stats;
+    uint8_t                         data[6];
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_init(1, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_attach(1, 0x1E, &ops, &sensor));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_set_speed(1, 5000000));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_set_clock_stretch(1, 0x1F, 1000));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_set_speed(1, SIMULITH_I2C_SPEED_STANDARD));
+
+    // Start, address, register, repeated start, address, six bytes, stop: 84 clocks of 10 us
+    simulith_i2c_msg_t msgs[] = {{.addr = 0x1E, .len = 1}, {.addr = 0x1E, .flags = SIMULITH_I2C_M_RD, .len = 6}};
+    TEST_ASSERT_EQUAL_INT64(840000, simulith_i2c_transaction_duration_ns(1, msgs, 2));
+
+    // Ten-bit reads send both address bytes, then the first again
+    simulith_i2c_msg_t msg_10 = {.addr = SIMULITH_I2C_ADDR_10BIT | 0x123, .flags = SIMULITH_I2C_M_RD, .len = 2};
+    TEST_ASSERT_EQUAL_INT64(480000, simulith_i2c_transaction_duration_ns(1, &msg_10, 1));
+
+    // One read fits a 1 ms tick
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(1, 0x1E, 0x00, data, 6));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_advance(1, 1000000));
+
+    // Two reads and a NACK do not, and clock stretching adds up per message
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_set_clock_stretch(1, 0x1E, 20000));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(1, 0x1E, 0x00, data, 6));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(1, 0x1E, 0x00, data, 6));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_transfer(1, msgs, 0)); // Rejected before the start condition
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_read(1, 0x1F, 0x00, data, 6));
+    TEST_ASSERT_EQUAL_INT(1, simulith_i2c_advance(1, 2000000));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_advance(1, 1000000));
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_get_stats(1, &stats));
+    TEST_ASSERT_EQUAL_UINT64(2000000, stats.time_ns);
+    TEST_ASSERT_EQUAL_UINT64(4, stats.transactions);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.nacks);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT64(2 * (840000 + 2 * 20000) + 110000, stats.last_busy_ns);
+    TEST_ASSERT_EQUAL_UINT64(840000 + stats.last_busy_ns, stats.busy_ns);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.87f, (float)stats.last_utilization);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.355f, (float)stats.utilization);
+
+    // Without a speed, transactions take no time
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_set_speed(1, 0));
+    TEST_ASSERT_EQUAL_INT64(0, simulith_i2c_transaction_duration_ns(1, msgs, 2));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(1, 0x1E, 0x00, data, 6));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_advance(1, 3000000));
+
+    // A ten-bit register read sends both address bytes for the register, then only the first
+    // one again for the data: 2 + 1 + 27 + 63 clocks
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_attach(1, SIMULITH_I2C_ADDR_10BIT | 0x123, &ops, &sensor));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_set_speed(1, SIMULITH_I2C_SPEED_STANDARD));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(1, SIMULITH_I2C_ADDR_10BIT | 0x123, 0x00, data, 6));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_advance(1, 4000000));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_get_stats(1, &stats));
+    TEST_ASSERT_EQUAL_UINT64(930000, stats.last_busy_ns);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -85,6 +292,9 @@ int main(void)
     RUN_TEST(test_i2c_init);
     RUN_TEST(test_i2c_read_write);
     RUN_TEST(test_i2c_invalid_params);
+    RUN_TEST(test_i2c_attach);
+    RUN_TEST(test_i2c_transfer);
+    RUN_TEST(test_i2c_timing);
 
     return UNITY_END();
 }
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "simulith_pty.h"
+#include "simulith_uart.h"
+#include "unity.h"
+#include <fcntl.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+// The terminal side plays the ground software
+static int ground_fd = -1;
+
+void setUp(void)
+{
+    simulith_uart_config_t config = {.baud_rate = 9600,
+                                     .data_bits = 8,
+                                     .stop_bits = 1,
+                                     .parity    = SIMULITH_UART_PARITY_NONE};
+    char                   path[64];
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_init(0, &config, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_pty_open(0, path, sizeof(path)));
+    ground_fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    TEST_ASSERT_TRUE(ground_fd >= 0);
+    TEST_ASSERT_EQUAL_INT(1, isatty(ground_fd));
+}
+
+void tearDown(void)
+{
+    close(ground_fd);
+    simulith_pty_close(0);
+    simulith_uart_close(0);
+}
+
+// Read what the terminal has, allowing the line discipline a moment to pass it on
+static size_t ground_read(uint8_t *data, size_t len)
+{
+    size_t total = 0;
+
+    for (int i = 0; i < 50 && total < len; i++)
+    {
+        ssize_t n = read(ground_fd, data + total, len - total);
+        if (n > 0)
+            total += n;
+        else
+            usleep(1000);
+    }
+    return total;
+}
+
+void test_pty_invalid(void)
+{
+    simulith_pty_stats_t stats;
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_pty_open(0, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_pty_open(1, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_pty_open(8, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_pty_tick(1, 0));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_pty_get_stats(1, &stats));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_pty_get_stats(0, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_pty_close(1));
+}
+
+void test_pty_bridge(void)
+{
+    const char           uplink[]   = "ping\r\n";
+    const char           downlink[] = "pong\r\n";
+    uint8_t              data[16]   = {0};
+    simulith_pty_stats_t stats;
+
+    TEST_ASSERT_EQUAL_INT(6, write(ground_fd, uplink, 6));
+    usleep(10000);
+    TEST_ASSERT_EQUAL_INT(6, simulith_pty_tick(0, 0));
+    TEST_ASSERT_EQUAL_INT(6, simulith_uart_receive(0, data, sizeof(data)));
+    TEST_ASSERT_EQUAL_MEMORY(uplink, data, 6);
+
+    TEST_ASSERT_EQUAL_INT(6, simulith_uart_send(0, (const uint8_t *)downlink, 6));
+    TEST_ASSERT_EQUAL_INT(6, simulith_pty_tick(0, 0));
+    TEST_ASSERT_EQUAL_INT(6, ground_read(data, sizeof(data)));
+    TEST_ASSERT_EQUAL_MEMORY(downlink, data, 6);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_pty_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(6, stats.rx_bytes);
+    TEST_ASSERT_EQUAL_UINT64(6, stats.tx_bytes);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.dropped);
+
+    // Closing the bridge gives the port its loopback back
+    TEST_ASSERT_EQUAL_INT(0, simulith_pty_close(0));
+    TEST_ASSERT_EQUAL_INT(6, simulith_uart_send(0, (const uint8_t *)downlink, 6));
+    TEST_ASSERT_EQUAL_INT(6, simulith_uart_receive(0, data, sizeof(data)));
+}
+
+void test_pty_pacing(void)
+{
+    uint8_t data[100];
+    uint8_t received[100];
+
+    for (int i = 0; i < 100; i++)
+        data[i] = i;
+
+    // 9600 baud 8N1 carries 9 characters in 10 ms, both ways
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_pacing(0, true));
+    TEST_ASSERT_EQUAL_INT(100, write(ground_fd, data, sizeof(data)));
+    TEST_ASSERT_EQUAL_INT(100, simulith_uart_send(0, data, sizeof(data)));
+    usleep(10000);
+
+    TEST_ASSERT_EQUAL_INT(18, simulith_pty_tick(0, 10000000));
+    TEST_ASSERT_EQUAL_INT(9, simulith_uart_receive(0, received, sizeof(received)));
+    TEST_ASSERT_EQUAL_MEMORY(data, received, 9);
+    TEST_ASSERT_EQUAL_INT(9, ground_read(received, sizeof(received)));
+    TEST_ASSERT_EQUAL_MEMORY(data, received, 9);
+
+    // The rest waits in the terminal and arrives on later ticks
+    TEST_ASSERT_EQUAL_INT(182, simulith_pty_tick(0, 200000000));
+    TEST_ASSERT_EQUAL_INT(91, simulith_uart_receive(0, received, sizeof(received)));
+    TEST_ASSERT_EQUAL_MEMORY(&data[9], received, 91);
+    TEST_ASSERT_EQUAL_INT(91, ground_read(received, sizeof(received)));
+    TEST_ASSERT_EQUAL_MEMORY(&data[9], received, 91);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pty_invalid);
+    RUN_TEST(test_pty_bridge);
+    RUN_TEST(test_pty_pacing);
+    return UNITY_END();
+}
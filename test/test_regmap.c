@@ -0,0 +1,161 @@
+#include "simulith_regmap.h"
+#include "simulith_i2c.h"
+#include "simulith_spi.h"
+#include "unity.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define REGMAP_NAME "/simulith_test_regmap"
+#define UPDATES     20000
+
+void setUp(void)
+{
+    // Setup code if needed
+}
+
+void tearDown(void)
+{
+    // Cleanup code if needed
+}
+
+void test_regmap_create_open(void)
+{
+    const uint8_t field[] = {0x12, 0x34, 0x56};
+    uint8_t       data[3];
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_regmap_create("no_slash", 16));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_regmap_create(REGMAP_NAME, 0));
+
+    int env = simulith_regmap_create(REGMAP_NAME, 16);
+    TEST_ASSERT_TRUE(env >= 0);
+
+    // A second mapping of the segment, as the flight software process would have
+    int fsw = simulith_regmap_open(REGMAP_NAME);
+    TEST_ASSERT_TRUE(fsw >= 0);
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_read(fsw, 0, data, 3));
+    TEST_ASSERT_EQUAL_HEX8(0x00, data[0]);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_write(env, 13, field, sizeof(field)));
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_read(fsw, 13, data, 3));
+    TEST_ASSERT_EQUAL_MEMORY(field, data, 3);
+    TEST_ASSERT_EQUAL_UINT32(1, simulith_regmap_updates(fsw));
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_regmap_write(env, 14, field, sizeof(field)));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_regmap_read(fsw, 17, data, 0));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_regmap_read(fsw, 0, NULL, 1));
+
+    // Closing the creator removes the segment
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_close(fsw));
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_close(env));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_regmap_close(env));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_regmap_open(REGMAP_NAME));
+}
+
+void test_regmap_bus_access(void)
+{
+    simulith_spi_config_t config = {.clock_hz    = 10000000,
+                                    .mode        = SIMULITH_SPI_MODE_3,
+                                    .bit_order   = SIMULITH_SPI_MSB_FIRST,
+                                    .cs_polarity = SIMULITH_SPI_CS_ACTIVE_LOW,
+                                    .data_bits   = 8};
+    const uint8_t         field[]  = {0x01, 0x02, 0x03, 0x04};
+    uint8_t               tx[5]    = {0x02 | SIMULITH_REGMAP_SPI_READ};
+    uint8_t               rx[5];
+    uint8_t               data[4];
+
+    int env = simulith_regmap_create(REGMAP_NAME, 8);
+    TEST_ASSERT_TRUE(env >= 0);
+    int fsw = simulith_regmap_open(REGMAP_NAME);
+    TEST_ASSERT_TRUE(fsw >= 0);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_init(0, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_init(0, &config, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_attach_i2c(fsw, 0, 0x1E));
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_attach_spi(fsw, 0, 1));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_regmap_attach_i2c(fsw + 1, 0, 0x1F));
+
+    // The environment updates once, both buses read it from shared memory
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_write(env, 2, field, sizeof(field)));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(0, 0x1E, 0x03, data, 2));
+    TEST_ASSERT_EQUAL_HEX8(0x02, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x03, data[1]);
+    TEST_ASSERT_EQUAL_INT(-1, simulith_i2c_read(0, 0x1E, 0x07, data, 2));
+
+    TEST_ASSERT_EQUAL_INT(5, simulith_spi_transfer(0, 1, tx, rx, 5));
+    TEST_ASSERT_EQUAL_MEMORY(field, &rx[1], 4);
+
+    // Bytes past the end read as 0xFF
+    tx[0] = 0x06 | SIMULITH_REGMAP_SPI_READ;
+    TEST_ASSERT_EQUAL_INT(5, simulith_spi_transfer(0, 1, tx, rx, 5));
+    TEST_ASSERT_EQUAL_HEX8(0x00, rx[1]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, rx[3]);
+
+    // Writes from the flight software reach the environment
+    tx[0] = 0x00;
+    tx[1] = 0xA5;
+    TEST_ASSERT_EQUAL_INT(2, simulith_spi_transfer(0, 1, tx, NULL, 2));
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_write(0, 0x1E, 0x01, &tx[1], 1));
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_read(env, 0, data, 2));
+    TEST_ASSERT_EQUAL_HEX8(0xA5, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xA5, data[1]);
+
+    simulith_spi_attach(0, 1, NULL, NULL);
+    simulith_spi_close(0);
+    simulith_i2c_attach(0, 0x1E, NULL, NULL);
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_close(fsw));
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_close(env));
+}
+
+static atomic_bool writer_done;
+
+// Every update sets all registers to the same value
+static void *environment_writer(void *arg)
+{
+    int     env = *(int *)arg;
+    uint8_t block[64];
+
+    for (int i = 0; i < UPDATES; i++)
+    {
+        memset(block, i & 0xFF, sizeof(block));
+        simulith_regmap_write(env, 0, block, sizeof(block));
+    }
+    atomic_store(&writer_done, true);
+    return NULL;
+}
+
+void test_regmap_consistent_snapshots(void)
+{
+    pthread_t writer;
+    uint8_t   block[64];
+
+    int env = simulith_regmap_create(REGMAP_NAME, sizeof(block));
+    TEST_ASSERT_TRUE(env >= 0);
+    int fsw = simulith_regmap_open(REGMAP_NAME);
+    TEST_ASSERT_TRUE(fsw >= 0);
+
+    atomic_store(&writer_done, false);
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&writer, NULL, environment_writer, &env));
+
+    // No read ever mixes two updates
+    while (!atomic_load(&writer_done))
+    {
+        TEST_ASSERT_EQUAL_INT(0, simulith_regmap_read(fsw, 0, block, sizeof(block)));
+        for (size_t i = 1; i < sizeof(block); i++)
+            TEST_ASSERT_EQUAL_HEX8(block[0], block[i]);
+    }
+    pthread_join(writer, NULL);
+
+    TEST_ASSERT_EQUAL_UINT32(UPDATES, simulith_regmap_updates(fsw));
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_close(fsw));
+    TEST_ASSERT_EQUAL_INT(0, simulith_regmap_close(env));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_regmap_create_open);
+    RUN_TEST(test_regmap_bus_access);
+    RUN_TEST(test_regmap_consistent_snapshots);
+    return UNITY_END();
+}
@@ -0,0 +1,154 @@
+#include "simulith_sensor.h"
+#include "simulith_i2c.h"
+#include "simulith_spi.h"
+#include "unity.h"
+
+#define TICK_NS   1000000ULL // 1 ms
+#define RANGE_REG 0x00
+#define DATA_REG  0x01
+
+typedef struct
+{
+    uint64_t last_time_ns;
+} test_model_t;
+
+void setUp(void)
+{
+    simulith_sensor_advance(0);
+}
+
+void tearDown(void)
+{
+    // Cleanup code if needed
+}
+
+// Milliseconds since start, scaled by the range register, MSB first
+static int test_sample(uint64_t time_ns, uint8_t *registers, size_t size, void *ctx)
+{
+    test_model_t *model = ctx;
+    uint32_t      value = (uint32_t)(time_ns / TICK_NS) << registers[RANGE_REG];
+
+    model->last_time_ns     = time_ns;
+    registers[DATA_REG]     = value >> 8;
+    registers[DATA_REG + 1] = value & 0xFF;
+    return 0;
+}
+
+void test_sensor_lazy_sampling(void)
+{
+    test_model_t             model  = {0};
+    simulith_sensor_config_t config = {.size = 4, .sample = test_sample, .ctx = &model};
+    simulith_sensor_stats_t  stats;
+    uint8_t                  data[2];
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_sensor_create(NULL));
+    config.size = SIMULITH_SENSOR_MAX_REGS + 1;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_sensor_create(&config));
+    config.size = 4;
+
+    int sensor = simulith_sensor_create(&config);
+    TEST_ASSERT_TRUE(sensor >= 0);
+
+    // A thousand ticks, read every hundredth: only the reads sample
+    for (uint64_t tick = 1; tick <= 1000; tick++)
+    {
+        simulith_sensor_advance(tick * TICK_NS);
+        if (tick % 100 == 0)
+        {
+            TEST_ASSERT_EQUAL_INT(0, simulith_sensor_read(sensor, DATA_REG, data, 2));
+            TEST_ASSERT_EQUAL_UINT16(tick, data[0] << 8 | data[1]);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_get_stats(sensor, &stats));
+    TEST_ASSERT_EQUAL_UINT64(10, stats.samples);
+
+    // Reads within a tick share the cached sample, a write samples again
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_read(sensor, DATA_REG, data, 2));
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_read(sensor, DATA_REG, data, 1));
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_get_stats(sensor, &stats));
+    TEST_ASSERT_EQUAL_UINT64(10, stats.samples);
+    TEST_ASSERT_EQUAL_UINT64(12, stats.reads);
+
+    const uint8_t range = 2;
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_write(sensor, RANGE_REG, &range, 1));
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_read(sensor, DATA_REG, data, 2));
+    TEST_ASSERT_EQUAL_UINT16(4000, data[0] << 8 | data[1]);
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_sensor_read(sensor, 3, data, 2));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_sensor_write(sensor, 4, &range, 1));
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_destroy(sensor));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_sensor_read(sensor, DATA_REG, data, 2));
+}
+
+void test_sensor_output_period(void)
+{
+    test_model_t             model  = {0};
+    simulith_sensor_config_t config = {.size = 4, .period_ns = 10 * TICK_NS, .sample = test_sample, .ctx = &model};
+    simulith_sensor_stats_t  stats;
+    uint8_t                  data[2];
+
+    int sensor = simulith_sensor_create(&config);
+    TEST_ASSERT_TRUE(sensor >= 0);
+
+    // A 100 Hz sensor read at 1 kHz samples once per period, on the period boundary
+    for (uint64_t tick = 0; tick < 50; tick++)
+    {
+        simulith_sensor_advance(tick * TICK_NS);
+        TEST_ASSERT_EQUAL_INT(0, simulith_sensor_read(sensor, DATA_REG, data, 2));
+        TEST_ASSERT_EQUAL_UINT16(tick - tick % 10, data[0] << 8 | data[1]);
+    }
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_get_stats(sensor, &stats));
+    TEST_ASSERT_EQUAL_UINT64(5, stats.samples);
+    TEST_ASSERT_EQUAL_UINT64(40 * TICK_NS, model.last_time_ns);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_destroy(sensor));
+}
+
+void test_sensor_bus_access(void)
+{
+    simulith_spi_config_t    spi_config = {.clock_hz    = 10000000,
+                                           .mode        = SIMULITH_SPI_MODE_0,
+                                           .bit_order   = SIMULITH_SPI_MSB_FIRST,
+                                           .cs_polarity = SIMULITH_SPI_CS_ACTIVE_LOW,
+                                           .data_bits   = 8};
+    test_model_t             model      = {0};
+    simulith_sensor_config_t config     = {.size = 4, .sample = test_sample, .ctx = &model};
+    uint8_t                  tx[5]      = {DATA_REG | SIMULITH_SENSOR_SPI_READ};
+    uint8_t                  rx[5];
+    uint8_t                  data[2];
+
+    int sensor = simulith_sensor_create(&config);
+    TEST_ASSERT_TRUE(sensor >= 0);
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_init(0, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_init(0, &spi_config, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_attach_i2c(sensor, 0, 0x0C));
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_attach_spi(sensor, 0, 0));
+
+    simulith_sensor_advance(300 * TICK_NS);
+    TEST_ASSERT_EQUAL_INT(0, simulith_i2c_read(0, 0x0C, DATA_REG, data, 2));
+    TEST_ASSERT_EQUAL_UINT16(300, data[0] << 8 | data[1]);
+
+    // SPI register write of the range, then a read past the last register
+    tx[0] = RANGE_REG;
+    tx[1] = 1;
+    TEST_ASSERT_EQUAL_INT(2, simulith_spi_transfer(0, 0, tx, NULL, 2));
+    tx[0] = DATA_REG | SIMULITH_SENSOR_SPI_READ;
+    TEST_ASSERT_EQUAL_INT(5, simulith_spi_transfer(0, 0, tx, rx, 5));
+    TEST_ASSERT_EQUAL_UINT16(600, rx[1] << 8 | rx[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, rx[3]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, rx[4]);
+
+    simulith_spi_attach(0, 0, NULL, NULL);
+    simulith_spi_close(0);
+    simulith_i2c_attach(0, 0x0C, NULL, NULL);
+    TEST_ASSERT_EQUAL_INT(0, simulith_sensor_destroy(sensor));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sensor_lazy_sampling);
+    RUN_TEST(test_sensor_output_period);
+    RUN_TEST(test_sensor_bus_access);
+    return UNITY_END();
+}
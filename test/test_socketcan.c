@@ -0,0 +1,157 @@
+#include "simulith_can.h"
+#include "simulith_socketcan.h"
+#include "unity.h"
+#include <linux/can.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// The bridge end of the pair is owned by the bridge, the other end plays the flight software
+static int fsw_fd = -1;
+
+void setUp(void)
+{
+    simulith_can_config_t config = {.bitrate      = SIMULITH_CAN_BITRATE_500K,
+                                    .sample_point = 75,
+                                    .sync_jump    = 1,
+                                    .data_bitrate = SIMULITH_CAN_FD_BITRATE_2M};
+    int                   fds[2];
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_init(0, &config, NULL));
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+    TEST_ASSERT_EQUAL_INT(0, simulith_socketcan_attach_fd(0, fds[0]));
+    fsw_fd = fds[1];
+}
+
+void tearDown(void)
+{
+    simulith_socketcan_close(0);
+    simulith_can_close(0);
+    close(fsw_fd);
+}
+
+void test_socketcan_invalid(void)
+{
+    simulith_socketcan_stats_t stats;
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_socketcan_attach_fd(0, 42));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_socketcan_attach_fd(8, 42));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_socketcan_open(1, "simulith_no_such_if"));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_socketcan_tick(1));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_socketcan_get_stats(0, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_socketcan_get_stats(1, &stats));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_socketcan_close(1));
+}
+
+void test_socketcan_to_bus(void)
+{
+    struct can_frame   classic = {.can_id = 0x123, .len = 2, .data = {0xAB, 0xCD}};
+    struct canfd_frame fd      = {.can_id = 0x1234567 | CAN_EFF_FLAG, .len = 12, .flags = CANFD_BRS};
+    struct can_frame   error   = {.can_id = CAN_ERR_FLAG, .len = 8};
+    simulith_can_message_t    rx_msg;
+    simulith_can_fd_message_t rx_fd;
+
+    memset(fd.data, 0x5A, sizeof(fd.data));
+    TEST_ASSERT_EQUAL_INT(sizeof(classic), write(fsw_fd, &classic, sizeof(classic)));
+    TEST_ASSERT_EQUAL_INT(sizeof(fd), write(fsw_fd, &fd, sizeof(fd)));
+    TEST_ASSERT_EQUAL_INT(sizeof(error), write(fsw_fd, &error, sizeof(error)));
+
+    // Nothing reaches the bus before the tick
+    simulith_can_filter_t filter = {.id = 0, .mask = 0, .is_extended = 0};
+    TEST_ASSERT_TRUE(simulith_can_add_filter(0, &filter) >= 0);
+    filter.is_extended = 1;
+    TEST_ASSERT_TRUE(simulith_can_add_filter(0, &filter) >= 0);
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_receive(0, &rx_msg));
+
+    TEST_ASSERT_EQUAL_INT(2, simulith_socketcan_tick(0));
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_receive(0, &rx_msg));
+    TEST_ASSERT_EQUAL_UINT32(0x123, rx_msg.id);
+    TEST_ASSERT_EQUAL_UINT8(2, rx_msg.dlc);
+    TEST_ASSERT_EQUAL_HEX8(0xCD, rx_msg.data[1]);
+    TEST_ASSERT_EQUAL_INT(1, simulith_can_receive_fd(0, &rx_fd));
+    TEST_ASSERT_EQUAL_UINT32(0x1234567, rx_fd.id);
+    TEST_ASSERT_EQUAL_UINT8(1, rx_fd.is_extended);
+    TEST_ASSERT_EQUAL_UINT8(12, rx_fd.len);
+    TEST_ASSERT_EQUAL_UINT8(SIMULITH_CAN_FLAG_FDF | SIMULITH_CAN_FLAG_BRS, rx_fd.flags);
+    TEST_ASSERT_EQUAL_HEX8(0x5A, rx_fd.data[11]);
+
+    // Frames from the socket are not echoed back to it
+    struct canfd_frame echo;
+    TEST_ASSERT_EQUAL_INT(-1, recv(fsw_fd, &echo, sizeof(echo), MSG_DONTWAIT));
+
+    simulith_socketcan_stats_t stats;
+    TEST_ASSERT_EQUAL_INT(0, simulith_socketcan_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(2, stats.rx_frames);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.tx_frames);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.dropped);
+}
+
+void test_socketcan_from_bus(void)
+{
+    simulith_can_message_t    classic = {.id = 0x321, .is_rtr = 1, .dlc = 4};
+    simulith_can_fd_message_t fd      = {.id = 0x7FF, .len = 64, .flags = SIMULITH_CAN_FLAG_FDF};
+    struct canfd_frame        frame;
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &classic));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_send_fd(0, &fd));
+    TEST_ASSERT_EQUAL_INT(-1, recv(fsw_fd, &frame, sizeof(frame), MSG_DONTWAIT));
+
+    TEST_ASSERT_EQUAL_INT(2, simulith_socketcan_tick(0));
+    TEST_ASSERT_EQUAL_INT(CAN_MTU, recv(fsw_fd, &frame, sizeof(frame), MSG_DONTWAIT));
+    TEST_ASSERT_EQUAL_HEX32(0x321 | CAN_RTR_FLAG, frame.can_id);
+    TEST_ASSERT_EQUAL_UINT8(4, frame.len);
+    TEST_ASSERT_EQUAL_INT(CANFD_MTU, recv(fsw_fd, &frame, sizeof(frame), MSG_DONTWAIT));
+    TEST_ASSERT_EQUAL_HEX32(0x7FF, frame.can_id);
+    TEST_ASSERT_EQUAL_UINT8(64, frame.len);
+
+    // More frames than fit in one batch
+    for (int i = 0; i < SIMULITH_SOCKETCAN_BATCH + 5; i++)
+    {
+        classic.id     = i;
+        classic.is_rtr = 0;
+        TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &classic));
+        if (i == 20)
+            TEST_ASSERT_EQUAL_INT(21, simulith_socketcan_tick(0));
+    }
+    TEST_ASSERT_EQUAL_INT(SIMULITH_SOCKETCAN_BATCH + 5 - 21, simulith_socketcan_tick(0));
+    for (int i = 0; i < SIMULITH_SOCKETCAN_BATCH + 5; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(CAN_MTU, recv(fsw_fd, &frame, sizeof(frame), MSG_DONTWAIT));
+        TEST_ASSERT_EQUAL_HEX32(i, frame.can_id);
+    }
+
+    // The node queue fills up between two ticks, the frames lost there are counted
+    simulith_socketcan_stats_t stats;
+    for (int i = 0; i < 40; i++)
+        TEST_ASSERT_EQUAL_INT(0, simulith_can_send(0, &classic));
+    TEST_ASSERT_EQUAL_INT(32, simulith_socketcan_tick(0));
+    TEST_ASSERT_EQUAL_INT(0, simulith_socketcan_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(8, stats.dropped);
+}
+
+void test_socketcan_bus_reinit(void)
+{
+    simulith_can_config_t     config = {.bitrate = SIMULITH_CAN_BITRATE_500K, .sample_point = 75, .sync_jump = 1};
+    simulith_can_fd_message_t msg;
+
+    // A node attached after the bus was initialized again may reuse the bridge's identifier
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_close(0));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_init(0, &config, NULL));
+    int node = simulith_can_attach(0, NULL);
+    TEST_ASSERT_TRUE(node > 0);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_socketcan_close(0));
+    TEST_ASSERT_EQUAL_INT(0, simulith_can_node_receive(0, node, &msg));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_socketcan_invalid);
+    RUN_TEST(test_socketcan_to_bus);
+    RUN_TEST(test_socketcan_from_bus);
+    RUN_TEST(test_socketcan_bus_reinit);
+
+    return UNITY_END();
+}
@@ -1,5 +1,7 @@
+#include "simulith_crc.h"
 #include "simulith_spi.h"
 #include "unity.h"
+#include <limits.h>
 #include <string.h>
 
 void setUp(void)
@@ -47,8 +49,11 @@ void test_spi_init(void)
     // Test NULL config
     TEST_ASSERT_EQUAL_INT(-1, simulith_spi_init(0, NULL, test_spi_transfer_cb));
 
-    // Test NULL callback
-    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_init(0, &config, NULL));
+    // Without a bus callback, only chip selects with a device answer
+    uint8_t rx_data[2];
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_init(0, &config, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 0, NULL, rx_data, 2));
+    simulith_spi_close(0);
 
     // Test invalid clock frequency
     config.clock_hz = 500; // Below 1kHz
@@ -111,6 +116,327 @@ void test_spi_transfer(void)
     simulith_spi_close(0);
 }
 
+// Test device that answers with its register contents
+static int test_spi_device_cb(uint8_t bus_id, uint8_t cs_id, const uint8_t *tx_data, uint8_t *rx_data, size_t len,
+                              void *ctx)
+{
+    const uint8_t *regs = ctx;
+
+    if (rx_data)
+        memcpy(rx_data, regs, len);
+    return len;
+}
+
+void test_spi_crc(void)
+{
+    simulith_spi_config_t config = {.clock_hz    = 1000000,
+                                    .mode        = SIMULITH_SPI_MODE_0,
+                                    .bit_order   = SIMULITH_SPI_MSB_FIRST,
+                                    .cs_polarity = SIMULITH_SPI_CS_ACTIVE_LOW,
+                                    .data_bits   = 8};
+    uint8_t               frame[8] = {0xDE, 0xAD, 0xBE, 0xEF};
+    uint8_t               tx_data[8];
+    uint8_t               rx_data[8];
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_set_crc(0, 0, SIMULITH_CRC_CRC16_CCITT));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_init(0, &config, test_spi_transfer_cb));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_set_crc(0, 0, 4));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_set_crc(0, SIMULITH_SPI_MAX_CS, SIMULITH_CRC_CRC16_CCITT));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_set_crc(0, 0, SIMULITH_CRC_CRC16_CCITT));
+
+    // The echo device adds 1 to each byte, so send the frame minus 1
+    size_t len = simulith_crc_stamp(SIMULITH_CRC_CRC16_CCITT, frame, 4);
+    for (size_t i = 0; i < len; i++)
+        tx_data[i] = frame[i] - 1;
+
+    TEST_ASSERT_EQUAL_INT(len, simulith_spi_transfer(0, 0, tx_data, rx_data, len));
+    TEST_ASSERT_EQUAL_MEMORY(frame, rx_data, len);
+
+    // A corrupted frame fails the transfer
+    tx_data[1] ^= 0x40;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 0, tx_data, rx_data, len));
+
+    // Another device on the same bus sends plain data
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_attach(0, 1, test_spi_device_cb, tx_data));
+    TEST_ASSERT_EQUAL_INT(len, simulith_spi_transfer(0, 1, NULL, rx_data, len));
+    TEST_ASSERT_EQUAL_MEMORY(tx_data, rx_data, len);
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 0, tx_data, rx_data, len));
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_set_crc(0, 0, SIMULITH_CRC_NONE));
+    TEST_ASSERT_EQUAL_INT(len, simulith_spi_transfer(0, 0, tx_data, rx_data, len));
+
+    simulith_spi_close(0);
+}
+
+void test_spi_attach(void)
+{
+    simulith_spi_config_t config   = {.clock_hz    = 1000000,
+                                      .mode        = SIMULITH_SPI_MODE_0,
+                                      .bit_order   = SIMULITH_SPI_MSB_FIRST,
+                                      .cs_polarity = SIMULITH_SPI_CS_ACTIVE_LOW,
+                                      .data_bits   = 8};
+    uint8_t               regs_a[] = {0xA0, 0xA1};
+    uint8_t               regs_b[] = {0xB0, 0xB1};
+    uint8_t               rx_data[2];
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_attach(0, 1, test_spi_device_cb, regs_a));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_init(0, &config, test_spi_transfer_cb));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_attach(0, SIMULITH_SPI_MAX_CS, test_spi_device_cb, regs_a));
+
+    // Chip selects beyond the bus count, each with its own context
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_attach(0, 1, test_spi_device_cb, regs_a));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_attach(0, SIMULITH_SPI_MAX_CS - 1, test_spi_device_cb, regs_b));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_attach(0, 1, test_spi_device_cb, regs_b));
+
+    TEST_ASSERT_EQUAL_INT(2, simulith_spi_transfer(0, 1, NULL, rx_data, 2));
+    TEST_ASSERT_EQUAL_MEMORY(regs_a, rx_data, 2);
+    TEST_ASSERT_EQUAL_INT(2, simulith_spi_transfer(0, SIMULITH_SPI_MAX_CS - 1, NULL, rx_data, 2));
+    TEST_ASSERT_EQUAL_MEMORY(regs_b, rx_data, 2);
+
+    // Chip selects without a device still go to the bus callback
+    TEST_ASSERT_EQUAL_INT(2, simulith_spi_transfer(0, 0, NULL, rx_data, 2));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, rx_data[0]);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_attach(0, 1, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 1, NULL, rx_data, 2));
+
+    simulith_spi_close(0);
+}
+
+// Test memory with a read command: 0x03, one address byte, then data until CS is released
+typedef struct
+{
+    uint8_t data[64];
+    size_t  position; // Bytes since CS was asserted
+    uint8_t address;
+    int     selects;
+} test_spi_memory_t;
+
+static void test_spi_memory_cs(uint8_t bus_id, uint8_t cs_id, bool asserted, void *ctx)
+{
+    test_spi_memory_t *memory = ctx;
+
+    if (asserted)
+    {
+        memory->position = 0;
+        memory->selects++;
+    }
+}
+
+static int test_spi_memory_cb(uint8_t bus_id, uint8_t cs_id, const uint8_t *tx_data, uint8_t *rx_data, size_t len,
+                              void *ctx)
+{
+    test_spi_memory_t *memory = ctx;
+
+    for (size_t i = 0; i < len; i++, memory->position++)
+    {
+        if (memory->position == 0 && (!tx_data || tx_data[i] != 0x03))
+            return -1;
+        if (memory->position == 1)
+            memory->address = tx_data ? tx_data[i] : 0;
+        if (rx_data)
+            rx_data[i] = (memory->position >= 2) ? memory->data[(memory->address + memory->position - 2) % 64] : 0;
+    }
+    return len;
+}
+
+void test_spi_transact(void)
+{
+    simulith_spi_config_t config     = {.clock_hz    = 1000000,
+                                        .mode        = SIMULITH_SPI_MODE_0,
+                                        .bit_order   = SIMULITH_SPI_MSB_FIRST,
+                                        .cs_polarity = SIMULITH_SPI_CS_ACTIVE_LOW,
+                                        .data_bits   = 8};
+    test_spi_memory_t     memory     = {0};
+    const uint8_t         command[2] = {0x03, 0x10};
+    uint8_t               payload[8];
+    uint8_t               more[4];
+
+    for (int i = 0; i < 64; i++)
+        memory.data[i] = i;
+
+    // Command and payload from separate buffers under one chip select
+    simulith_spi_segment_t segments[] = {
+        {.tx_data = command, .rx_data = NULL, .len = sizeof(command)},
+        {.tx_data = NULL, .rx_data = payload, .len = sizeof(payload)},
+        {.tx_data = NULL, .rx_data = NULL, .len = 0},
+        {.tx_data = NULL, .rx_data = more, .len = sizeof(more)},
+    };
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transact(0, 0, segments, 4));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_init(0, &config, test_spi_transfer_cb));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_attach(0, 2, test_spi_memory_cb, &memory));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_set_cs_callback(0, 2, test_spi_memory_cs));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_set_cs_callback(0, SIMULITH_SPI_MAX_CS, test_spi_memory_cs));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transact(0, 2, NULL, 1));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transact(0, 2, segments, 0));
+
+    TEST_ASSERT_EQUAL_INT(14, simulith_spi_transact(0, 2, segments, 4));
+    TEST_ASSERT_EQUAL_INT(1, memory.selects);
+    for (int i = 0; i < 8; i++)
+        TEST_ASSERT_EQUAL_HEX8(0x10 + i, payload[i]);
+    TEST_ASSERT_EQUAL_HEX8(0x18, more[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x1B, more[3]);
+
+    // Separate transfers release the chip select in between, losing the command
+    TEST_ASSERT_EQUAL_INT(2, simulith_spi_transfer(0, 2, command, NULL, sizeof(command)));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 2, NULL, payload, sizeof(payload)));
+    TEST_ASSERT_EQUAL_INT(3, memory.selects);
+
+    // A segment with no buffers, or a total the result cannot hold, fails before the chip
+    // select is asserted
+    segments[2].len = 1;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transact(0, 2, segments, 4));
+    segments[2].len = 0;
+    segments[3].len = INT_MAX;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transact(0, 2, segments, 4));
+    TEST_ASSERT_EQUAL_INT(3, memory.selects);
+
+    simulith_spi_close(0);
+}
+
+// Test register bank of four registers
+static int test_spi_reg_read(uint8_t bus_id, uint8_t cs_id, size_t reg, uint8_t *data, size_t len, void *ctx)
+{
+    memcpy(data, (uint8_t *)ctx + reg, len);
+    return 0;
+}
+
+static int test_spi_reg_write(uint8_t bus_id, uint8_t cs_id, size_t reg, const uint8_t *data, size_t len, void *ctx)
+{
+    memcpy((uint8_t *)ctx + reg, data, len);
+    return 0;
+}
+
+void test_spi_attach_registers(void)
+{
+    simulith_spi_config_t             config    = {.clock_hz    = 1000000,
+                                                   .mode        = SIMULITH_SPI_MODE_0,
+                                                   .bit_order   = SIMULITH_SPI_MSB_FIRST,
+                                                   .cs_polarity = SIMULITH_SPI_CS_ACTIVE_LOW,
+                                                   .data_bits   = 8};
+    const simulith_spi_register_ops_t ops       = {.read = test_spi_reg_read, .write = test_spi_reg_write};
+    const simulith_spi_register_ops_t read_only = {.read = test_spi_reg_read};
+    uint8_t                           regs[4]   = {0};
+    const uint8_t                     write[]   = {0x01, 0x11, 0x12, 0x13, 0x14};
+    const uint8_t                     read      = 0x02 | SIMULITH_SPI_REG_READ;
+    uint8_t                           rx[5];
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_init(0, &config, test_spi_transfer_cb));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_attach_registers(0, 3, sizeof(regs), &read_only, regs));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_attach_registers(0, 3, sizeof(regs), &ops, regs));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_attach_registers(0, 3, sizeof(regs), &ops, regs));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_attach(0, 3, test_spi_device_cb, regs));
+
+    // Writes increment the register, bytes past the last one are dropped
+    TEST_ASSERT_EQUAL_INT(5, simulith_spi_transfer(0, 3, write, rx, sizeof(write)));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, rx[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, regs[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x11, regs[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x13, regs[3]);
+
+    // The command byte and the data may come in separate segments
+    simulith_spi_segment_t segments[] = {
+        {.tx_data = &read, .rx_data = NULL, .len = 1},
+        {.tx_data = NULL, .rx_data = rx, .len = 3},
+    };
+    TEST_ASSERT_EQUAL_INT(4, simulith_spi_transact(0, 3, segments, 2));
+    TEST_ASSERT_EQUAL_HEX8(0x12, rx[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x13, rx[1]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, rx[2]);
+
+    // Detached, the chip select goes to the bus callback, which has no device there
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_attach(0, 3, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 3, write, rx, sizeof(write)));
+
+    simulith_spi_close(0);
+}
+
+// Test camera generating its readout on demand, and counting what it receives
+typedef struct
+{
+    size_t   max_chunk;
+    size_t   received;
+    uint64_t checksum;
+} test_spi_camera_t;
+
+static int test_spi_camera_cb(uint8_t bus_id, uint8_t cs_id, size_t offset, const uint8_t *tx_chunk,
+                              uint8_t *rx_chunk, size_t len, void *ctx)
+{
+    test_spi_camera_t *camera = ctx;
+
+    if (len > camera->max_chunk)
+        camera->max_chunk = len;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (rx_chunk)
+            rx_chunk[i] = (uint8_t)((offset + i) ^ 0x5A);
+        if (tx_chunk)
+            camera->checksum += tx_chunk[i];
+    }
+    camera->received += tx_chunk ? len : 0;
+    return len;
+}
+
+static int test_spi_fill(uint8_t bus_id, uint8_t cs_id, size_t offset, uint8_t *chunk, size_t len, void *ctx)
+{
+    memset(chunk, 1, len);
+    return 0;
+}
+
+static int test_spi_check(uint8_t bus_id, uint8_t cs_id, size_t offset, uint8_t *chunk, size_t len, void *ctx)
+{
+    size_t *checked = ctx;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (chunk[i] != (uint8_t)((offset + i) ^ 0x5A))
+            return -1;
+    }
+    *checked += len;
+    return (*checked > 3 * 1024 * 1024) ? -1 : 0;
+}
+
+void test_spi_stream(void)
+{
+    simulith_spi_config_t config = {.clock_hz    = 50000000,
+                                    .mode        = SIMULITH_SPI_MODE_0,
+                                    .bit_order   = SIMULITH_SPI_MSB_FIRST,
+                                    .cs_polarity = SIMULITH_SPI_CS_ACTIVE_LOW,
+                                    .data_bits   = 8};
+    test_spi_camera_t     camera  = {0};
+    size_t                checked = 0;
+    uint8_t               rx_data[10000];
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_stream(0, 3, 16, test_spi_fill, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_init(0, &config, test_spi_transfer_cb));
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_attach_stream(0, 3, test_spi_camera_cb, &camera));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_attach(0, 3, test_spi_device_cb, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_stream(0, 3, 16, NULL, NULL, NULL));
+
+    // A 2 MB readout, one chunk at a time on both sides
+    TEST_ASSERT_EQUAL_INT(2 * 1024 * 1024 + 123,
+                          simulith_spi_stream(0, 3, 2 * 1024 * 1024 + 123, NULL, test_spi_check, &checked));
+    TEST_ASSERT_EQUAL_size_t(2 * 1024 * 1024 + 123, checked);
+    TEST_ASSERT_EQUAL_size_t(SIMULITH_SPI_STREAM_CHUNK, camera.max_chunk);
+
+    // Uploads, and plain transfers reach the device in chunks with the cursor
+    TEST_ASSERT_EQUAL_INT(100000, simulith_spi_stream(0, 3, 100000, test_spi_fill, NULL, NULL));
+    TEST_ASSERT_EQUAL_size_t(100000, camera.received);
+    TEST_ASSERT_EQUAL_UINT64(100000, camera.checksum);
+    TEST_ASSERT_EQUAL_INT(sizeof(rx_data), simulith_spi_transfer(0, 3, NULL, rx_data, sizeof(rx_data)));
+    TEST_ASSERT_EQUAL_HEX8((uint8_t)(9999 ^ 0x5A), rx_data[9999]);
+
+    // The consumer can stop a stream
+    checked = 0;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_stream(0, 3, 4 * 1024 * 1024, NULL, test_spi_check, &checked));
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_attach_stream(0, 3, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 3, NULL, rx_data, sizeof(rx_data)));
+
+    simulith_spi_close(0);
+}
+
 void test_spi_invalid_operations(void)
 {
     simulith_spi_config_t config = {.clock_hz    = 1000000,
@@ -129,9 +455,10 @@ void test_spi_invalid_operations(void)
     TEST_ASSERT_EQUAL_INT(0, simulith_spi_init(0, &config, test_spi_transfer_cb));
 
     // Test invalid parameters
-    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 8, data, data, sizeof(data))); // Invalid CS
-    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 0, NULL, NULL, sizeof(data))); // Both buffers NULL
-    TEST_ASSERT_EQUAL_INT(0, simulith_spi_transfer(0, 0, data, data, 0));             // Zero length
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, SIMULITH_SPI_MAX_CS, data, data, sizeof(data))); // Invalid CS
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 0, NULL, NULL, sizeof(data)));       // Both buffers NULL
+    TEST_ASSERT_EQUAL_INT(0, simulith_spi_transfer(0, 0, data, data, 0));                   // Zero length
+    TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 0, data, data, (size_t)INT_MAX + 1)); // Too long
 
     // Test transfer to non-existent device
     TEST_ASSERT_EQUAL_INT(-1, simulith_spi_transfer(0, 1, data, data, sizeof(data)));
@@ -176,6 +503,11 @@ int main(void)
 
     RUN_TEST(test_spi_init);
     RUN_TEST(test_spi_transfer);
+    RUN_TEST(test_spi_crc);
+    RUN_TEST(test_spi_attach);
+    RUN_TEST(test_spi_transact);
+    RUN_TEST(test_spi_attach_registers);
+    RUN_TEST(test_spi_stream);
     RUN_TEST(test_spi_invalid_operations);
     RUN_TEST(test_spi_multiple_buses);
 
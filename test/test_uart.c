@@ -1,5 +1,7 @@
+#include "simulith_crc.h"
 #include "simulith_uart.h"
 #include "unity.h"
+#include <pthread.h>
 #include <string.h>
 
 void setUp(void)
@@ -140,6 +142,445 @@ void test_uart_multiple_ports(void)
     }
 }
 
+void test_uart_ring_buffer(void)
+{
+    simulith_uart_config_t config = {.baud_rate      = 115200,
+                                     .data_bits      = 8,
+                                     .stop_bits      = 1,
+                                     .parity         = SIMULITH_UART_PARITY_NONE,
+                                     .flow_control   = SIMULITH_UART_FLOW_NONE,
+                                     .rx_buffer_size = 100};
+
+    uint8_t tx[64];
+    uint8_t rx[64];
+
+    for (size_t i = 0; i < sizeof(tx); i++)
+    {
+        tx[i] = (uint8_t)i;
+    }
+
+    // Sizes must be powers of two within limits
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_init(0, &config, NULL));
+    config.rx_buffer_size = 8;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_init(0, &config, NULL));
+    config.rx_buffer_size = 64;
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_init(0, &config, NULL));
+
+    // Without a callback, sent data loops back into the receive buffer
+    TEST_ASSERT_EQUAL_INT(40, simulith_uart_send(0, tx, 40));
+    TEST_ASSERT_EQUAL_INT(30, simulith_uart_receive(0, rx, 30));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(tx, rx, 30);
+
+    // Writes and reads that wrap around the end of the ring
+    TEST_ASSERT_EQUAL_INT(54, simulith_uart_inject(0, tx, sizeof(tx)));
+    TEST_ASSERT_EQUAL_INT(64, simulith_uart_available(0));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_send(0, tx, 1));
+    TEST_ASSERT_EQUAL_INT(64, simulith_uart_receive(0, rx, sizeof(rx)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&tx[30], rx, 10);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(tx, &rx[10], 54);
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_available(0));
+
+    // Clean up
+    simulith_uart_close(0);
+}
+
+void test_uart_pacing(void)
+{
+    simulith_uart_config_t config = {.baud_rate    = 9600,
+                                     .data_bits    = 8,
+                                     .stop_bits    = 1,
+                                     .parity       = SIMULITH_UART_PARITY_NONE,
+                                     .flow_control = SIMULITH_UART_FLOW_NONE};
+
+    simulith_uart_stats_t stats;
+    uint8_t               data[128] = {0};
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_set_pacing(0, true));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_init(0, &config, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_advance(0, 1000));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_pacing(0, true));
+
+    // 8N1 takes 10 bits per character, 9.6 characters per 10 ms at 9600 baud
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(1041667, stats.char_time_ns);
+
+    TEST_ASSERT_EQUAL_INT(100, simulith_uart_send(0, data, 100));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_available(0));
+    TEST_ASSERT_EQUAL_INT(9, simulith_uart_advance(0, 10000000));
+    TEST_ASSERT_EQUAL_INT(9, simulith_uart_available(0));
+    TEST_ASSERT_EQUAL_INT(10, simulith_uart_advance(0, 20000000));
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(19, stats.tx_bytes);
+    TEST_ASSERT_EQUAL_UINT32(81, stats.tx_backlog);
+    TEST_ASSERT_EQUAL_UINT32(100, stats.tx_backlog_max);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1000.0f, (float)stats.last_tx_bytes_per_s);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f, (float)stats.last_utilization);
+
+    // The backlog drains, then an idle line does not bank time
+    TEST_ASSERT_EQUAL_INT(81, simulith_uart_advance(0, 1000000000));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_advance(0, 999999999));
+    TEST_ASSERT_EQUAL_INT(100, simulith_uart_receive(0, data, 100));
+    TEST_ASSERT_EQUAL_INT(2, simulith_uart_send(0, data, 2));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_advance(0, 1001000000));
+    TEST_ASSERT_EQUAL_INT(1, simulith_uart_advance(0, 1002000000));
+
+    // Disabling delivers what is left
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_pacing(0, false));
+    TEST_ASSERT_EQUAL_INT(2, simulith_uart_available(0));
+
+    // Clean up
+    simulith_uart_close(0);
+}
+
+void test_uart_inject(void)
+{
+    simulith_uart_config_t config = {.baud_rate    = 115200,
+                                     .data_bits    = 8,
+                                     .stop_bits    = 1,
+                                     .parity       = SIMULITH_UART_PARITY_NONE,
+                                     .flow_control = SIMULITH_UART_FLOW_NONE};
+
+    uint8_t data[16];
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_inject(0, data, sizeof(data)));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_init(0, &config, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_inject(0, NULL, sizeof(data)));
+
+    const uint8_t test_data[] = {0x01, 0x02, 0x03};
+    TEST_ASSERT_EQUAL_INT(sizeof(test_data), simulith_uart_inject(0, test_data, sizeof(test_data)));
+    TEST_ASSERT_EQUAL_INT(sizeof(test_data), simulith_uart_available(0));
+    TEST_ASSERT_EQUAL_INT(2, simulith_uart_receive(0, data, 2));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(test_data, data, 2);
+    TEST_ASSERT_EQUAL_INT(1, simulith_uart_receive(0, data, sizeof(data)));
+    TEST_ASSERT_EQUAL_UINT8(0x03, data[0]);
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_available(0));
+
+    // A full buffer keeps what fits and reports it as available
+    uint8_t block[600] = {0};
+    TEST_ASSERT_EQUAL_INT(sizeof(block), simulith_uart_inject(0, block, sizeof(block)));
+    TEST_ASSERT_EQUAL_INT(SIMULITH_UART_RX_BUFFER_DEFAULT - sizeof(block), simulith_uart_inject(0, block, sizeof(block)));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_inject(0, block, 1));
+    TEST_ASSERT_EQUAL_INT(SIMULITH_UART_RX_BUFFER_DEFAULT, simulith_uart_available(0));
+
+    // Clean up
+    simulith_uart_close(0);
+}
+
+#define INJECT_THREADS 4
+#define INJECT_BYTES   5000
+
+static void *inject_thread(void *arg)
+{
+    uint8_t id = (uint8_t)(uintptr_t)arg;
+
+    // Each byte carries the thread ID and a 6-bit sequence number
+    for (int i = 0; i < INJECT_BYTES; i++)
+    {
+        uint8_t byte = (uint8_t)((id << 6) | (i & 0x3F));
+        while (simulith_uart_inject(0, &byte, 1) != 1)
+        {
+        }
+    }
+    return NULL;
+}
+
+void test_uart_concurrent_inject(void)
+{
+    simulith_uart_config_t config = {.baud_rate    = 115200,
+                                     .data_bits    = 8,
+                                     .stop_bits    = 1,
+                                     .parity       = SIMULITH_UART_PARITY_NONE,
+                                     .flow_control = SIMULITH_UART_FLOW_NONE};
+
+    pthread_t threads[INJECT_THREADS];
+    int       next[INJECT_THREADS] = {0};
+    int       total                = 0;
+    uint8_t   data[64];
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_init(0, &config, NULL));
+    for (uintptr_t i = 0; i < INJECT_THREADS; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, inject_thread, (void *)i));
+    }
+
+    // No byte is lost or reordered within a thread
+    while (total < INJECT_THREADS * INJECT_BYTES)
+    {
+        int count = simulith_uart_receive(0, data, sizeof(data));
+        TEST_ASSERT_TRUE(count >= 0);
+        for (int i = 0; i < count; i++)
+        {
+            int id = data[i] >> 6;
+            TEST_ASSERT_EQUAL_INT(next[id] & 0x3F, data[i] & 0x3F);
+            next[id]++;
+        }
+        total += count;
+    }
+
+    for (int i = 0; i < INJECT_THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+        TEST_ASSERT_EQUAL_INT(INJECT_BYTES, next[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_available(0));
+
+    // Clean up
+    simulith_uart_close(0);
+}
+
+static int     frames_received = 0;
+static uint8_t frame_buffer[4][64];
+static size_t  frame_lens[4];
+
+static int test_uart_frame_cb(uint8_t port_id, const uint8_t *data, size_t len)
+{
+    if (frames_received < 4 && len <= sizeof(frame_buffer[0]))
+    {
+        memcpy(frame_buffer[frames_received], data, len);
+        frame_lens[frames_received] = len;
+    }
+    frames_received++;
+    return len;
+}
+
+void test_uart_framing(void)
+{
+    simulith_uart_config_t  config = {.baud_rate    = 115200,
+                                      .data_bits    = 8,
+                                      .stop_bits    = 1,
+                                      .parity       = SIMULITH_UART_PARITY_NONE,
+                                      .flow_control = SIMULITH_UART_FLOW_NONE};
+    simulith_uart_framing_t slip   = {.type = SIMULITH_UART_FRAMING_SLIP, .max_len = 8};
+    simulith_uart_framing_t hdlc   = {.type = SIMULITH_UART_FRAMING_HDLC};
+    simulith_uart_framing_t kiss   = {.type = SIMULITH_UART_FRAMING_KISS};
+    simulith_uart_stats_t   stats;
+
+    const uint8_t slip_stream[] = {0xC0, 0x01, 0xDB, 0xDC, 0x02, 0xDB, 0xDD, 0xC0, 0xC0, 0x03, 0x04, 0xC0};
+    const uint8_t slip_frame[]  = {0x01, 0xC0, 0x02, 0xDB};
+    const uint8_t too_long[]    = {1, 2, 3, 4, 5, 6, 7, 8, 9, 0xC0};
+    const uint8_t hdlc_stream[] = {0x7E, 0x11, 0x7D, 0x5E, 0x7E, 0x22, 0x7D, 0x7E, 0x33, 0x7D, 0x5D, 0x7E};
+    const uint8_t kiss_stream[] = {0xC0, 0x00, 0x48, 0x69, 0xC0, 0xC0, 0x06, 0x01, 0xC0};
+    const uint8_t ppp_stream[]  = {0x7E, 0xFF, 0x7D, 0x23, 0xC0, 0x21, 0x7D, 0x21, 0x7D, 0x21, 0x7D, 0x20, 0x7D, 0x2A,
+                                   0x7D, 0x25, 0x7D, 0x26, 0x7D, 0x32, 0x34, 0x56, 0x78, 0x79, 0x7D, 0x20, 0x7E};
+    const uint8_t ppp_frame[]   = {0xFF, 0x03, 0xC0, 0x21, 0x01, 0x01, 0x00, 0x0A, 0x05, 0x06, 0x12, 0x34, 0x56, 0x78};
+    uint8_t       ppp_bad[sizeof(ppp_stream)];
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_set_framing(0, &slip));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_init(0, &config, test_uart_frame_cb));
+    slip.type = 9;
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_set_framing(0, &slip));
+    slip.type = SIMULITH_UART_FRAMING_SLIP;
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_framing(0, &slip));
+
+    // Frames split across sends, escapes and empty frames
+    frames_received = 0;
+    TEST_ASSERT_EQUAL_INT(3, simulith_uart_send(0, slip_stream, 3));
+    TEST_ASSERT_EQUAL_INT(0, frames_received);
+    TEST_ASSERT_EQUAL_INT(9, simulith_uart_send(0, &slip_stream[3], 9));
+    TEST_ASSERT_EQUAL_INT(2, frames_received);
+    TEST_ASSERT_EQUAL_size_t(4, frame_lens[0]);
+    TEST_ASSERT_EQUAL_MEMORY(slip_frame, frame_buffer[0], 4);
+    TEST_ASSERT_EQUAL_size_t(2, frame_lens[1]);
+    TEST_ASSERT_EQUAL_MEMORY(&slip_stream[9], frame_buffer[1], 2);
+
+    // Longer than max_len
+    TEST_ASSERT_EQUAL_INT(10, simulith_uart_send(0, too_long, sizeof(too_long)));
+    TEST_ASSERT_EQUAL_INT(2, frames_received);
+
+    // Partial frame on an idle line, 2 characters take about 174 us at 115200 baud
+    TEST_ASSERT_EQUAL_INT(2, simulith_uart_send(0, too_long, 2));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_advance(0, 1000000));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_advance(0, 1100000));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(1, stats.rx_frames_dropped);
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_advance(0, 1200000));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(2, stats.rx_frames);
+    TEST_ASSERT_EQUAL_UINT64(2, stats.rx_frames_dropped);
+
+    // HDLC escapes and an aborted frame
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_framing(0, &hdlc));
+    frames_received = 0;
+    TEST_ASSERT_EQUAL_INT(12, simulith_uart_send(0, hdlc_stream, sizeof(hdlc_stream)));
+    TEST_ASSERT_EQUAL_INT(2, frames_received);
+    TEST_ASSERT_EQUAL_size_t(2, frame_lens[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x7E, frame_buffer[0][1]);
+    TEST_ASSERT_EQUAL_size_t(2, frame_lens[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x33, frame_buffer[1][0]);
+    TEST_ASSERT_EQUAL_HEX8(0x7D, frame_buffer[1][1]);
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(1, stats.rx_frames_dropped);
+
+    // A PPP LCP Configure-Request with every control character escaped, the FCS is checked and removed
+    memcpy(ppp_bad, ppp_stream, sizeof(ppp_stream));
+    hdlc.crc = SIMULITH_CRC_CRC16_X25;
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_framing(0, &hdlc));
+    frames_received = 0;
+    TEST_ASSERT_EQUAL_INT(sizeof(ppp_stream), simulith_uart_send(0, ppp_stream, sizeof(ppp_stream)));
+    TEST_ASSERT_EQUAL_INT(1, frames_received);
+    TEST_ASSERT_EQUAL_size_t(sizeof(ppp_frame), frame_lens[0]);
+    TEST_ASSERT_EQUAL_MEMORY(ppp_frame, frame_buffer[0], sizeof(ppp_frame));
+    ppp_bad[13] ^= 0x01;
+    TEST_ASSERT_EQUAL_INT(sizeof(ppp_bad), simulith_uart_send(0, ppp_bad, sizeof(ppp_bad)));
+    TEST_ASSERT_EQUAL_INT(1, frames_received);
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(1, stats.rx_crc_errors);
+
+    // KISS data frames without the type byte, other frames skipped
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_framing(0, &kiss));
+    frames_received = 0;
+    TEST_ASSERT_EQUAL_INT(9, simulith_uart_send(0, kiss_stream, sizeof(kiss_stream)));
+    TEST_ASSERT_EQUAL_INT(1, frames_received);
+    TEST_ASSERT_EQUAL_size_t(2, frame_lens[0]);
+    TEST_ASSERT_EQUAL_MEMORY("Hi", frame_buffer[0], 2);
+
+    // Byte chunks again
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_framing(0, NULL));
+    frames_received = 0;
+    TEST_ASSERT_EQUAL_INT(9, simulith_uart_send(0, kiss_stream, sizeof(kiss_stream)));
+    TEST_ASSERT_EQUAL_INT(1, frames_received);
+    TEST_ASSERT_EQUAL_size_t(9, frame_lens[0]);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_close(0));
+}
+
+void test_uart_framing_asm(void)
+{
+    simulith_uart_config_t  config  = {.baud_rate    = 115200,
+                                       .data_bits    = 8,
+                                       .stop_bits    = 1,
+                                       .parity       = SIMULITH_UART_PARITY_NONE,
+                                       .flow_control = SIMULITH_UART_FLOW_NONE};
+    simulith_uart_framing_t framing = {.type = SIMULITH_UART_FRAMING_ASM, .max_len = 4};
+    simulith_uart_stats_t   stats;
+    uint8_t                 data[16];
+
+    // Noise, a marker split over three sends, and back to back frames
+    const uint8_t stream[] = {0x55, 0x1A, 0xCF, 0xFC, 0x1D, 0xA0, 0xA1, 0xA2, 0xA3,
+                              0x1A, 0xCF, 0xFC, 0x1D, 0xB0, 0xB1, 0xB2, 0xB3, 0x1A};
+    const uint8_t custom[] = {0xEB, 0x90, 0xEB, 0x90, 'a', 'b', 'c', 'd', 0xEB, 0x90, 0xEB, 0x90};
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_init(0, &config, test_uart_frame_cb));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_framing(0, &framing));
+
+    frames_received = 0;
+    TEST_ASSERT_EQUAL_INT(2, simulith_uart_send(0, stream, 2));
+    TEST_ASSERT_EQUAL_INT(1, simulith_uart_send(0, &stream[2], 1));
+    TEST_ASSERT_EQUAL_INT(15, simulith_uart_send(0, &stream[3], 15));
+    TEST_ASSERT_EQUAL_INT(2, frames_received);
+    TEST_ASSERT_EQUAL_MEMORY(&stream[5], frame_buffer[0], 4);
+    TEST_ASSERT_EQUAL_MEMORY(&stream[13], frame_buffer[1], 4);
+
+    // Without a callback, frames are looped back into the receive buffer
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_close(0));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_init(0, &config, NULL));
+    framing.sync_marker = 0xEB90EB90;
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_framing(0, &framing));
+    TEST_ASSERT_EQUAL_INT(9, simulith_uart_send(0, custom, 9));
+    TEST_ASSERT_EQUAL_INT(4, simulith_uart_receive(0, data, sizeof(data)));
+    TEST_ASSERT_EQUAL_MEMORY("abcd", data, 4);
+
+    // A marker alone is a partial frame after the idle time
+    TEST_ASSERT_EQUAL_INT(3, simulith_uart_send(0, &custom[9], 3));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_advance(0, 0));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_advance(0, 1000000));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(1, stats.rx_frames);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.rx_frames_dropped);
+
+    // Frames with a FECF are checked on delivery
+    uint8_t fecf_frame[] = {0xEB, 0x90, 0xEB, 0x90, 'o', 'k', 0, 0, 0xEB, 0x90, 0xEB, 0x90, 'o', 'k', 0, 0};
+    framing.crc          = SIMULITH_CRC_CRC16_CCITT;
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_framing(0, &framing));
+    simulith_crc_stamp(SIMULITH_CRC_CRC16_CCITT, &fecf_frame[4], 2);
+    memcpy(&fecf_frame[12], &fecf_frame[4], 4);
+    fecf_frame[13] = 'K';
+    TEST_ASSERT_EQUAL_INT(16, simulith_uart_send(0, fecf_frame, sizeof(fecf_frame)));
+    TEST_ASSERT_EQUAL_INT(4, simulith_uart_receive(0, data, sizeof(data)));
+    TEST_ASSERT_EQUAL_MEMORY(&fecf_frame[4], data, 4);
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(1, stats.rx_frames);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.rx_crc_errors);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_close(0));
+}
+
+static int endpoint_frames[3];
+
+static int test_uart_endpoint0_cb(uint8_t port_id, const uint8_t *data, size_t len)
+{
+    endpoint_frames[0]++;
+    return len;
+}
+
+static int test_uart_endpoint1_cb(uint8_t port_id, const uint8_t *data, size_t len)
+{
+    endpoint_frames[1]++;
+    return len;
+}
+
+static int test_uart_endpoint2_cb(uint8_t port_id, const uint8_t *data, size_t len)
+{
+    endpoint_frames[2]++;
+    return len;
+}
+
+void test_uart_multidrop(void)
+{
+    simulith_uart_config_t  config  = {.baud_rate    = 115200,
+                                       .data_bits    = 8,
+                                       .stop_bits    = 1,
+                                       .parity       = SIMULITH_UART_PARITY_NONE,
+                                       .flow_control = SIMULITH_UART_FLOW_NONE};
+    simulith_uart_framing_t framing = {.type = SIMULITH_UART_FRAMING_SLIP};
+    simulith_uart_stats_t   stats;
+    uint8_t                 reply[4];
+
+    // Frames for address 0x10, 0x21, the broadcast address and 0x30
+    const uint8_t stream[] = {0x10, 0xAA, 0xC0, 0x21, 0xBB, 0xC0, 0xFF, 0xCC, 0xC0, 0x30, 0xDD, 0xC0};
+
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_attach(0, 0x10, 0xFF, test_uart_endpoint0_cb));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_init(0, &config, test_uart_rx_cb));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_attach(0, 0x10, 0xFF, NULL));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_set_framing(0, &framing));
+
+    // Exact address, any address 0x2X, and a sniffer
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_attach(0, 0x10, 0xFF, test_uart_endpoint0_cb));
+    TEST_ASSERT_EQUAL_INT(1, simulith_uart_attach(0, 0x20, 0xF0, test_uart_endpoint1_cb));
+    TEST_ASSERT_EQUAL_INT(2, simulith_uart_attach(0, 0x00, 0x00, test_uart_endpoint2_cb));
+
+    memset(endpoint_frames, 0, sizeof(endpoint_frames));
+    rx_data_received = 0;
+    TEST_ASSERT_EQUAL_INT(12, simulith_uart_send(0, stream, sizeof(stream)));
+    TEST_ASSERT_EQUAL_INT(2, endpoint_frames[0]);
+    TEST_ASSERT_EQUAL_INT(2, endpoint_frames[1]);
+    TEST_ASSERT_EQUAL_INT(4, endpoint_frames[2]);
+    TEST_ASSERT_EQUAL_INT(0, rx_data_received);
+
+    // Without the sniffer, the frame for 0x30 reaches nobody
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_detach(0, 2));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_detach(0, 2));
+    TEST_ASSERT_EQUAL_INT(-1, simulith_uart_detach(0, SIMULITH_UART_MAX_ENDPOINTS));
+    TEST_ASSERT_EQUAL_INT(12, simulith_uart_send(0, stream, sizeof(stream)));
+    TEST_ASSERT_EQUAL_INT(4, endpoint_frames[0]);
+    TEST_ASSERT_EQUAL_INT(4, endpoint_frames[2]);
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_get_stats(0, &stats));
+    TEST_ASSERT_EQUAL_UINT64(1, stats.rx_unaddressed);
+
+    // Endpoints reply into the receive buffer
+    TEST_ASSERT_EQUAL_INT(2, simulith_uart_inject(0, (const uint8_t *)"\x10\x01", 2));
+    TEST_ASSERT_EQUAL_INT(2, simulith_uart_receive(0, reply, sizeof(reply)));
+
+    // With no endpoints left, the receive callback is back
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_detach(0, 0));
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_detach(0, 1));
+    TEST_ASSERT_EQUAL_INT(12, simulith_uart_send(0, stream, sizeof(stream)));
+    TEST_ASSERT_EQUAL_INT(2, rx_data_received);
+
+    TEST_ASSERT_EQUAL_INT(0, simulith_uart_close(0));
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -148,6 +589,13 @@ int main(void)
     RUN_TEST(test_uart_send_receive);
     RUN_TEST(test_uart_invalid_operations);
     RUN_TEST(test_uart_multiple_ports);
+    RUN_TEST(test_uart_ring_buffer);
+    RUN_TEST(test_uart_pacing);
+    RUN_TEST(test_uart_inject);
+    RUN_TEST(test_uart_concurrent_inject);
+    RUN_TEST(test_uart_framing);
+    RUN_TEST(test_uart_framing_asm);
+    RUN_TEST(test_uart_multidrop);
 
     return UNITY_END();
 }
\ No newline at end of file
@@ -0,0 +1,540 @@
+/*
+ * Generate a C header from a DBC file.
+ *
+ * Usage: simulith_dbc <input.dbc> <output.h> [prefix]
+ *
+ * For every message the header contains a struct of raw signal values, inline pack and
+ * unpack functions that only use constant shifts and masks, and inline conversions between
+ * raw and physical values. A perfect hash of the message IDs indexes a dispatch table, and
+ * <prefix>_dispatch matches simulith_can_filter_callback so it can be registered with
+ * simulith_can_add_filter_callback, with a <prefix>_handlers_t as context.
+ */
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_MESSAGES    256
+#define MAX_SIGNALS     64  // Per message
+#define MAX_NAME        64
+#define MAX_LINE        1024
+#define MAX_PAYLOAD     64  // CAN FD
+#define DBC_EXTENDED_ID 0x80000000u
+
+typedef struct
+{
+    char     name[MAX_NAME];
+    uint16_t start;
+    uint8_t  length;
+    bool     big_endian; // Motorola byte order, start is the MSB
+    bool     is_signed;
+    double   factor;
+    double   offset;
+    double   min;
+    double   max;
+    char     unit[MAX_NAME];
+} dbc_signal_t;
+
+typedef struct
+{
+    char         name[MAX_NAME];
+    uint32_t     key; // ID with DBC_EXTENDED_ID for extended frames
+    uint8_t      dlc;
+    dbc_signal_t signals[MAX_SIGNALS];
+    int          signal_count;
+} dbc_message_t;
+
+static dbc_message_t  messages[MAX_MESSAGES];
+static int            message_count = 0;
+static dbc_message_t *current       = NULL; // Message the following signals belong to, NULL to skip them
+
+// CamelCase DBC names to snake_case, "ADCSAttitude" becomes "adcs_attitude"
+static void to_lower(char *dst, const char *src)
+{
+    char *end = dst + MAX_NAME - 1;
+
+    for (int i = 0; src[i] && dst < end; i++)
+    {
+        bool upper       = isupper((unsigned char)src[i]);
+        bool after_lower = i > 0 && (islower((unsigned char)src[i - 1]) || isdigit((unsigned char)src[i - 1]));
+        bool word_start  = i > 0 && isupper((unsigned char)src[i - 1]) && islower((unsigned char)src[i + 1]);
+
+        if (upper && (after_lower || word_start) && dst[-1] != '_' && dst + 1 < end)
+            *dst++ = '_';
+        *dst++ = (char)tolower((unsigned char)src[i]);
+    }
+    *dst = '\0';
+}
+
+static void to_upper(char *dst, const char *src)
+{
+    to_lower(dst, src);
+    for (; *dst; dst++)
+        *dst = (char)toupper((unsigned char)*dst);
+}
+
+// BO_ <id> <name>: <dlc> <transmitter>
+static int parse_message(const char *line, int line_no)
+{
+    unsigned long id;
+    unsigned      dlc;
+    char          name[MAX_NAME];
+
+    if (sscanf(line, " BO_ %lu %63[A-Za-z0-9_]: %u", &id, name, &dlc) != 3)
+    {
+        fprintf(stderr, "line %d: malformed message\n", line_no);
+        return -1;
+    }
+    // Holds the signals that are not sent in any message
+    if (strcmp(name, "VECTOR__INDEPENDENT_SIG_MSG") == 0)
+    {
+        current = NULL;
+        return 0;
+    }
+    if (dlc > MAX_PAYLOAD)
+    {
+        fprintf(stderr, "line %d: message %s is longer than %d bytes\n", line_no, name, MAX_PAYLOAD);
+        return -1;
+    }
+    if (message_count == MAX_MESSAGES)
+    {
+        fprintf(stderr, "line %d: more than %d messages\n", line_no, MAX_MESSAGES);
+        return -1;
+    }
+
+    for (int i = 0; i < message_count; i++)
+    {
+        if (messages[i].key == (uint32_t)id)
+        {
+            fprintf(stderr, "line %d: %s has the same ID as %s\n", line_no, name, messages[i].name);
+            return -1;
+        }
+    }
+
+    current = &messages[message_count++];
+    memset(current, 0, sizeof(*current));
+    strcpy(current->name, name);
+    current->key = (uint32_t)id;
+    current->dlc = (uint8_t)dlc;
+    return 0;
+}
+
+// SG_ <name> [M|m<n>] : <start>|<length>@<order><sign> (<factor>,<offset>) [<min>|<max>] "<unit>" <receivers>
+static int parse_signal(const char *line, int line_no)
+{
+    dbc_signal_t sig = {0};
+    char         mux[MAX_NAME] = "";
+    unsigned     start, length;
+    char         order, sign;
+    const char  *layout;
+
+    if (!current)
+        return 0;
+
+    layout = strchr(line, ':');
+    if (!layout || sscanf(line, " SG_ %63[A-Za-z0-9_] %63[^: ]", sig.name, mux) < 1)
+    {
+        fprintf(stderr, "line %d: malformed signal\n", line_no);
+        return -1;
+    }
+    if (sscanf(layout, ": %u|%u@%c%c (%lf,%lf) [%lf|%lf] \"%63[^\"]", &start, &length, &order, &sign, &sig.factor,
+               &sig.offset, &sig.min, &sig.max, sig.unit) < 8)
+    {
+        fprintf(stderr, "line %d: malformed signal %s\n", line_no, sig.name);
+        return -1;
+    }
+
+    dbc_message_t *msg = current;
+
+    // Multiplexed signals share bits with each other, only the multiplexor is decoded
+    if (mux[0] == 'm')
+    {
+        fprintf(stderr, "line %d: skipping multiplexed signal %s.%s\n", line_no, msg->name, sig.name);
+        return 0;
+    }
+    if (length == 0 || length > 64 || (order != '0' && order != '1') || (sign != '+' && sign != '-') ||
+        sig.factor == 0.0)
+    {
+        fprintf(stderr, "line %d: invalid layout for signal %s\n", line_no, sig.name);
+        return -1;
+    }
+    if (msg->signal_count == MAX_SIGNALS)
+    {
+        fprintf(stderr, "line %d: more than %d signals in %s\n", line_no, MAX_SIGNALS, msg->name);
+        return -1;
+    }
+
+    sig.start      = (uint16_t)start;
+    sig.length     = (uint8_t)length;
+    sig.big_endian = (order == '0');
+    sig.is_signed  = (sign == '-');
+    msg->signals[msg->signal_count++] = sig;
+    return 0;
+}
+
+static int parse_dbc(FILE *in)
+{
+    char line[MAX_LINE];
+    int  line_no = 0;
+
+    while (fgets(line, sizeof(line), in))
+    {
+        const char *p = line;
+        line_no++;
+
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (strncmp(p, "BO_ ", 4) == 0)
+        {
+            if (parse_message(p, line_no) < 0)
+                return -1;
+        }
+        else if (strncmp(p, "SG_ ", 4) == 0)
+        {
+            if (parse_signal(p, line_no) < 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+// Payload bit (byte * 8 + bit in byte) holding bit n of the raw value, -1 if outside the payload
+static int payload_bit(const dbc_signal_t *sig, int n, int dlc)
+{
+    int pos;
+
+    if (!sig->big_endian)
+    {
+        pos = sig->start + n;
+    }
+    else
+    {
+        // Walk from the MSB at the start bit down to bit n, continuing in the next byte
+        pos = sig->start;
+        for (int i = sig->length - 1; i > n; i--)
+            pos = (pos % 8 == 0) ? pos + 15 : pos - 1;
+    }
+    return (pos < dlc * 8) ? pos : -1;
+}
+
+static const char *raw_type(const dbc_signal_t *sig)
+{
+    static const char *types[2][4] = {{"uint8_t", "uint16_t", "uint32_t", "uint64_t"},
+                                      {"int8_t", "int16_t", "int32_t", "int64_t"}};
+    int                size        = sig->length <= 8 ? 0 : sig->length <= 16 ? 1 : sig->length <= 32 ? 2 : 3;
+    return types[sig->is_signed][size];
+}
+
+// Call emit for each byte the signal touches, with the raw bits it holds. Within a byte, raw
+// bits are contiguous and in the same order for both byte orders.
+typedef void (*span_fn)(FILE *out, int byte, int bit, int raw_bit, int count);
+
+static int for_each_span(FILE *out, const dbc_signal_t *sig, int dlc, span_fn emit)
+{
+    int n = 0;
+
+    while (n < sig->length)
+    {
+        int pos = payload_bit(sig, n, dlc);
+        int count = 1;
+
+        if (pos < 0)
+            return -1;
+        while (n + count < sig->length && payload_bit(sig, n + count, dlc) == pos + count && (pos + count) % 8 != 0)
+            count++;
+        emit(out, pos / 8, pos % 8, n, count);
+        n += count;
+    }
+    return 0;
+}
+
+static void emit_pack_span(FILE *out, int byte, int bit, int raw_bit, int count)
+{
+    fprintf(out, "    data[%d] |= (uint8_t)(((raw >> %d) & 0x%xu) << %d);\n", byte, raw_bit, (1u << count) - 1, bit);
+}
+
+static void emit_unpack_span(FILE *out, int byte, int bit, int raw_bit, int count)
+{
+    fprintf(out, "    raw |= (uint64_t)((data[%d] >> %d) & 0x%xu) << %d;\n", byte, bit, (1u << count) - 1, raw_bit);
+}
+
+static bool hash_is_perfect(uint32_t mult, int shift, uint8_t *used, size_t size)
+{
+    memset(used, 0, size);
+    for (int i = 0; i < message_count; i++)
+    {
+        uint32_t slot = (uint32_t)(messages[i].key * mult) >> shift;
+        if (used[slot])
+            return false;
+        used[slot] = 1;
+    }
+    return true;
+}
+
+// Multiplicative hash (key * mult) >> shift without collisions, growing the table if needed
+static int find_hash(uint32_t *mult, int *shift)
+{
+    int bits = 1;
+
+    while ((1 << bits) < message_count)
+        bits++;
+
+    for (int extra = 0; extra < 4; extra++, bits++)
+    {
+        size_t   size  = (size_t)1 << bits;
+        uint8_t *used  = malloc(size);
+        uint32_t state = 0x9E3779B9u;
+
+        if (!used)
+            return -1;
+        for (int attempt = 0; attempt < 100000; attempt++)
+        {
+            uint32_t candidate = state | 1;
+            state              = state * 1664525u + 1013904223u;
+            if (hash_is_perfect(candidate, 32 - bits, used, size))
+            {
+                free(used);
+                *mult  = candidate;
+                *shift = 32 - bits;
+                return bits;
+            }
+        }
+        free(used);
+    }
+    return -1;
+}
+
+static void emit_message(FILE *out, const char *prefix, const char *macro, const dbc_message_t *msg)
+{
+    char name[MAX_NAME], upper[MAX_NAME];
+    to_lower(name, msg->name);
+    to_upper(upper, msg->name);
+
+    fprintf(out, "// %s\n", msg->name);
+    fprintf(out, "#define %s_%s_ID          0x%xu\n", macro, upper, msg->key & ~DBC_EXTENDED_ID);
+    fprintf(out, "#define %s_%s_IS_EXTENDED %d\n", macro, upper, (msg->key & DBC_EXTENDED_ID) ? 1 : 0);
+    fprintf(out, "#define %s_%s_LEN         %u\n\n", macro, upper, msg->dlc);
+
+    fprintf(out, "typedef struct\n{\n");
+    for (int i = 0; i < msg->signal_count; i++)
+    {
+        const dbc_signal_t *sig = &msg->signals[i];
+        char                sig_name[MAX_NAME];
+        to_lower(sig_name, sig->name);
+        fprintf(out, "    %s %s; /**< Raw value%s%s */\n", raw_type(sig), sig_name, sig->unit[0] ? ", " : "", sig->unit);
+    }
+    if (msg->signal_count == 0)
+        fprintf(out, "    uint8_t unused;\n");
+    fprintf(out, "} %s_%s_t;\n\n", prefix, name);
+
+    // Physical value conversions
+    for (int i = 0; i < msg->signal_count; i++)
+    {
+        const dbc_signal_t *sig = &msg->signals[i];
+        char                sig_name[MAX_NAME];
+        to_lower(sig_name, sig->name);
+
+        fprintf(out, "static inline double %s_%s_%s_decode(%s raw)\n{\n", prefix, name, sig_name, raw_type(sig));
+        fprintf(out, "    return (double)raw * %.17g + (%.17g);\n}\n\n", sig->factor, sig->offset);
+        fprintf(out, "static inline %s %s_%s_%s_encode(double value)\n{\n", raw_type(sig), prefix, name, sig_name);
+        fprintf(out, "    double scaled = (value - (%.17g)) / %.17g;\n", sig->offset, sig->factor);
+        fprintf(out, "    return (%s)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);\n}\n\n", raw_type(sig));
+    }
+
+    // Pack
+    fprintf(out, "static inline void %s_%s_pack(uint8_t *data, const %s_%s_t *msg)\n{\n", prefix, name, prefix, name);
+    fprintf(out, "    uint64_t raw;\n\n");
+    fprintf(out, "    memset(data, 0, %u);\n", msg->dlc);
+    for (int i = 0; i < msg->signal_count; i++)
+    {
+        const dbc_signal_t *sig = &msg->signals[i];
+        char                sig_name[MAX_NAME];
+        to_lower(sig_name, sig->name);
+        fprintf(out, "    raw = (uint64_t)msg->%s;\n", sig_name);
+        for_each_span(out, sig, msg->dlc, emit_pack_span);
+    }
+    fprintf(out, "    (void)raw;\n}\n\n");
+
+    // Unpack
+    fprintf(out, "static inline void %s_%s_unpack(%s_%s_t *msg, const uint8_t *data)\n{\n", prefix, name, prefix, name);
+    fprintf(out, "    uint64_t raw;\n\n");
+    if (msg->signal_count == 0)
+        fprintf(out, "    memset(msg, 0, sizeof(*msg));\n");
+    for (int i = 0; i < msg->signal_count; i++)
+    {
+        const dbc_signal_t *sig = &msg->signals[i];
+        char                sig_name[MAX_NAME];
+        to_lower(sig_name, sig->name);
+        fprintf(out, "    raw = 0;\n");
+        for_each_span(out, sig, msg->dlc, emit_unpack_span);
+        if (sig->is_signed && sig->length < 64)
+        {
+            // Sign extend from the top bit of the signal
+            fprintf(out, "    msg->%s = (%s)(int64_t)((raw ^ 0x%llxull) - 0x%llxull);\n", sig_name, raw_type(sig),
+                    1ULL << (sig->length - 1), 1ULL << (sig->length - 1));
+        }
+        else
+        {
+            fprintf(out, "    msg->%s = (%s)raw;\n", sig_name, raw_type(sig));
+        }
+    }
+    fprintf(out, "    (void)raw;\n}\n\n");
+}
+
+static int emit_header(FILE *out, const char *prefix)
+{
+    char     macro[MAX_NAME];
+    uint32_t mult;
+    int      shift;
+    int      bits = find_hash(&mult, &shift);
+
+    if (bits < 0)
+    {
+        fprintf(stderr, "no perfect hash found for %d message IDs\n", message_count);
+        return -1;
+    }
+
+    to_upper(macro, prefix);
+
+    fprintf(out, "// Generated by simulith_dbc, do not edit\n\n");
+    fprintf(out, "#ifndef %s_DBC_H\n#define %s_DBC_H\n\n", macro, macro);
+    fprintf(out, "#include <stdint.h>\n#include <string.h>\n\n#include \"simulith_can.h\"\n\n");
+
+    for (int i = 0; i < message_count; i++)
+        emit_message(out, prefix, macro, &messages[i]);
+
+    // Handlers, one per message
+    fprintf(out, "/**\n * @brief Message handlers, the context of %s_dispatch (NULL entries are ignored)\n */\n", prefix);
+    fprintf(out, "typedef struct\n{\n");
+    for (int i = 0; i < message_count; i++)
+    {
+        char name[MAX_NAME];
+        to_lower(name, messages[i].name);
+        fprintf(out, "    int (*on_%s)(uint8_t bus_id, const %s_%s_t *msg, void *ctx);\n", name, prefix, name);
+    }
+    fprintf(out, "    void *ctx; /**< Passed to every handler */\n");
+    fprintf(out, "} %s_handlers_t;\n\n", prefix);
+
+    // Per message thunks referenced by the dispatch table
+    for (int i = 0; i < message_count; i++)
+    {
+        char name[MAX_NAME], upper[MAX_NAME];
+        to_lower(name, messages[i].name);
+        to_upper(upper, messages[i].name);
+
+        fprintf(out, "static inline int %s_%s_thunk(uint8_t bus_id, const simulith_can_fd_message_t *frame, const %s_handlers_t *handlers)\n{\n",
+                prefix, name, prefix);
+        fprintf(out, "    %s_%s_t msg;\n\n", prefix, name);
+        fprintf(out, "    if (!handlers->on_%s)\n        return 0;\n", name);
+        fprintf(out, "    if (frame->len < %s_%s_LEN)\n        return -1;\n", macro, upper);
+        fprintf(out, "    %s_%s_unpack(&msg, frame->data);\n", prefix, name);
+        fprintf(out, "    return handlers->on_%s(bus_id, &msg, handlers->ctx);\n}\n\n", name);
+    }
+
+    fprintf(out, "typedef struct\n{\n    uint32_t key;\n");
+    fprintf(out, "    int (*thunk)(uint8_t bus_id, const simulith_can_fd_message_t *frame, const %s_handlers_t *handlers);\n",
+            prefix);
+    fprintf(out, "} %s_dispatch_entry_t;\n\n", prefix);
+
+    fprintf(out, "#define %s_HASH_MULT  0x%08xu\n", macro, mult);
+    fprintf(out, "#define %s_HASH_SHIFT %d\n\n", macro, shift);
+
+    fprintf(out, "static const %s_dispatch_entry_t %s_dispatch_table[%d] = {\n", prefix, prefix, 1 << bits);
+    for (int i = 0; i < message_count; i++)
+    {
+        char name[MAX_NAME];
+        to_lower(name, messages[i].name);
+        fprintf(out, "    [%u] = {0x%08xu, %s_%s_thunk},\n", (uint32_t)(messages[i].key * mult) >> shift, messages[i].key,
+                prefix, name);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "/**\n");
+    fprintf(out, " * @brief Decode a frame and call its handler, a simulith_can_filter_callback\n");
+    fprintf(out, " * @param bus_id Bus identifier\n");
+    fprintf(out, " * @param frame Received frame\n");
+    fprintf(out, " * @param ctx Pointer to a %s_handlers_t\n", prefix);
+    fprintf(out, " * @return Handler result, 0 for unknown IDs, -1 if the frame is too short\n");
+    fprintf(out, " */\n");
+    fprintf(out, "static inline int %s_dispatch(uint8_t bus_id, const simulith_can_fd_message_t *frame, void *ctx)\n{\n",
+            prefix);
+    fprintf(out, "    uint32_t key = frame->id | (frame->is_extended ? 0x%08xu : 0);\n", DBC_EXTENDED_ID);
+    fprintf(out, "    const %s_dispatch_entry_t *entry = &%s_dispatch_table[(uint32_t)(key * %s_HASH_MULT) >> %s_HASH_SHIFT];\n\n",
+            prefix, prefix, macro, macro);
+    fprintf(out, "    if (!entry->thunk || entry->key != key)\n        return 0;\n");
+    fprintf(out, "    return entry->thunk(bus_id, frame, (const %s_handlers_t *)ctx);\n}\n\n", prefix);
+
+    fprintf(out, "#endif // %s_DBC_H\n", macro);
+    return 0;
+}
+
+// Reject signals that do not fit their message before anything is written
+static int check_layouts(void)
+{
+    for (int i = 0; i < message_count; i++)
+    {
+        for (int j = 0; j < messages[i].signal_count; j++)
+        {
+            const dbc_signal_t *sig = &messages[i].signals[j];
+            for (int n = 0; n < sig->length; n++)
+            {
+                if (payload_bit(sig, n, messages[i].dlc) < 0)
+                {
+                    fprintf(stderr, "signal %s.%s does not fit in %u bytes\n", messages[i].name, sig->name,
+                            messages[i].dlc);
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *prefix = (argc > 3) ? argv[3] : "dbc";
+    FILE       *in, *out;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <input.dbc> <output.h> [prefix]\n", argv[0]);
+        return 1;
+    }
+
+    in = fopen(argv[1], "r");
+    if (!in)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    if (parse_dbc(in) < 0 || check_layouts() < 0)
+    {
+        fclose(in);
+        return 1;
+    }
+    fclose(in);
+
+    if (message_count == 0)
+    {
+        fprintf(stderr, "%s: no messages\n", argv[1]);
+        return 1;
+    }
+
+    out = fopen(argv[2], "w");
+    if (!out)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+    if (emit_header(out, prefix) < 0)
+    {
+        fclose(out);
+        remove(argv[2]);
+        return 1;
+    }
+    fclose(out);
+    return 0;
+}